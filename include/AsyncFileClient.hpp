@@ -0,0 +1,97 @@
+#ifndef ASYNC_FILE_CLIENT_HPP
+#define ASYNC_FILE_CLIENT_HPP
+
+#include "MuxClient.hpp"
+
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+// Client library for programs that embed netcopy instead of driving the interactive
+// FileClient. Every call starts a transfer on a protocol v2 stream and returns right
+// away; the outcome arrives through a future or a callback. Any number of transfers
+// may be outstanding. They are pipelined over a pool of connections, and each new
+// transfer goes to the connection with the fewest transfers in flight. A connection
+// that drops is replaced the next time a transfer needs one.
+//
+// Callbacks run on an internal thread and may start more transfers, but must not
+// call waitAll() or destroy the client. Writes to a closed connection raise SIGPIPE
+// as with any socket, so the embedding program should ignore it.
+class AsyncFileClient {
+public:
+    using Result = MuxClient::Result;
+    using Callback = MuxClient::Callback;
+
+    struct Transfer {
+        std::string remote_name;
+        std::string local_path;
+    };
+
+    AsyncFileClient(const std::string& host, int port, size_t pool_size = 1);
+    AsyncFileClient(const std::string& dest_ip, int dest_port,
+                    const std::string& proxy_ip, int proxy_port, size_t pool_size = 1);
+    ~AsyncFileClient(); // Transfers still running fail with ERROR
+
+    // Open the pool, true if at least one connection could be made
+    bool connect();
+    void close();
+
+    std::future<Result> get(const std::string& remote_name, const std::string& local_path);
+    void get(const std::string& remote_name, const std::string& local_path, Callback on_done);
+
+    std::future<Result> put(const std::string& local_path, const std::string& remote_name);
+    void put(const std::string& local_path, const std::string& remote_name, Callback on_done);
+
+    // Result.data holds a serialized Protocol::Listing
+    std::future<Result> list(const std::string& remote_dir);
+    void list(const std::string& remote_dir, Callback on_done);
+
+    // Start a whole batch at once, spread across the pool
+    std::vector<std::future<Result>> getAll(const std::vector<Transfer>& transfers);
+    std::vector<std::future<Result>> putAll(const std::vector<Transfer>& transfers);
+
+    // Block until every transfer started so far has completed
+    void waitAll();
+
+    size_t inFlight();
+
+private:
+    struct Connection {
+        int socket_fd = -1;
+        std::unique_ptr<MuxClient> mux;
+        bool connecting = false;    // A caller is replacing it, outside the lock
+    };
+
+    std::string server_ip;
+    int server_port;
+    bool use_proxy = false;
+    std::string proxy_ip;
+    int proxy_port = -1;
+    size_t pool_size;
+
+    std::mutex mutex;
+    std::condition_variable idle_cv;
+    std::vector<Connection> pool;
+    std::vector<Connection> retired; // Dropped connections, kept until close() since a callback may be running on one
+    size_t in_flight = 0;
+
+    // Connect, send the proxy header if needed, and switch to protocol v2
+    bool open(Connection& connection);
+    void release(Connection& connection);
+
+    // Least loaded live connection, reconnecting dropped ones without holding the
+    // mutex, so other callers keep using the live connections meanwhile
+    MuxClient* pick();
+
+    using Starter = std::function<void(MuxClient&, Callback)>;
+    void submit(const Starter& start, Callback on_done);
+
+    // Callback that fulfils future
+    static Callback promise(std::future<Result>& future);
+};
+
+#endif // ASYNC_FILE_CLIENT_HPP
@@ -0,0 +1,77 @@
+#ifndef BACKEND_POOL_HPP
+#define BACKEND_POOL_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <netinet/in.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+// Replicated servers a proxy spreads its sessions over, in place of the destination
+// a client names. A backend is picked either by fewest sessions in progress or by a
+// consistent hash of the path asked for, so one file keeps going to the same server
+// (and its page cache) while backends come and go. Health is judged passively from
+// the sessions themselves: after `max_failures` failed connects in a row a backend
+// is left out for `cooldown`, then given another chance.
+class BackendPool {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Policy {
+        LEAST_OUTSTANDING,  // Fewest sessions in progress
+        PATH_HASH           // Consistent hash of the path
+    };
+
+    struct Config {
+        std::vector<sockaddr_in> backends;
+        Policy policy = Policy::LEAST_OUTSTANDING;
+        unsigned max_failures = 3;                  // Failures in a row before a backend is left out
+        std::chrono::seconds cooldown{10};          // How long it is left out
+    };
+
+    explicit BackendPool(const Config& config);
+
+    BackendPool(const BackendPool&) = delete;
+    BackendPool& operator=(const BackendPool&) = delete;
+
+    // Backend for a session about path, counted as outstanding until release(). Backends in
+    // avoid are skipped while any other is left. -1 once every backend has been avoided
+    int acquire(const std::string& path, const std::vector<int>& avoid = {});
+
+    // The session on index is over, healthy = the backend did its part (false counts as a failure)
+    void release(int index, bool healthy);
+
+    const sockaddr_in& address(int index) const { return backends[index].addr; }
+    std::string name(int index) const;
+    size_t size() const { return backends.size(); }
+    Policy policy() const { return config.policy; }
+
+    // "address:port,address:port", false with nothing added if any entry doesn't parse
+    static bool parseList(const std::string& list, std::vector<sockaddr_in>& out);
+
+private:
+    static constexpr int VIRTUAL_NODES = 160; // Points per backend on the hash ring
+
+    struct Backend {
+        sockaddr_in addr{};
+        size_t outstanding = 0;
+        unsigned failures = 0;
+        Clock::time_point down_until;
+    };
+
+    Config config;
+    std::vector<Backend> backends;
+    std::vector<std::pair<uint64_t, int>> ring; // (point, backend), sorted by point
+    std::mutex mutex;
+    size_t next_tie = 0;
+
+    bool usable(int index, const std::vector<int>& avoid, Clock::time_point now, bool allow_down) const;
+    int pickLeast(const std::vector<int>& avoid, Clock::time_point now, bool allow_down);
+    int pickHashed(const std::string& path, const std::vector<int>& avoid, Clock::time_point now, bool allow_down) const;
+    static uint64_t hash(const std::string& text);
+};
+
+#endif // BACKEND_POOL_HPP
@@ -1,22 +1,33 @@
 #ifndef BASE_SERVER_HPP
 #define BASE_SERVER_HPP
 
+#include <string>
+
 
 class BaseServer{
 public:
     BaseServer(int port);
     ~BaseServer();
 
+    // Also accept same-host clients on a Unix domain socket, call before start()
+    void listenLocal(const std::string& path);
+
     bool start();
 
-    int acceptConnection();
+    int acceptConnection(int listen_fd);
 
 protected:
     int socket_fd;
     int server_port;
+    int local_fd = -1;
+    std::string local_path;
 
     virtual void handleRequest(int client_fd) = 0;
 
+    // Called from handleRequest() once the connection has been handed to someone
+    // else (e.g. RelayEngine), it is then left open when handleRequest() returns
+    static void releaseClient();
+
 private:
     static void* threadEntry(void* arg);
     void threadHandler(int client_fd);
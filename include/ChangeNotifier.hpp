@@ -0,0 +1,79 @@
+#ifndef CHANGE_NOTIFIER_HPP
+#define CHANGE_NOTIFIER_HPP
+
+#include "Protocol.hpp"
+
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// Watches the server's directory tree and hands file change events to SUBSCRIBE
+// sessions. One inotify instance and one thread serve every subscriber; the
+// watches are set up by the first subscribe() call. Linux only, subscribe()
+// returns nullptr elsewhere.
+class ChangeNotifier {
+public:
+    // Events for one subscriber. Repeated changes to the same path are coalesced
+    // until they are taken, eg. created + modified is reported once as created.
+    // If the kernel dropped events, what is waiting is replaced by one OVERFLOW.
+    class Subscription {
+    public:
+        Subscription(std::string prefix);
+        ~Subscription();
+
+        // Readable while events are waiting, for poll()
+        int fd() const { return pipe_fds[0]; }
+
+        // Take every waiting event
+        std::vector<Protocol::ChangeEvent> take();
+
+    private:
+        friend class ChangeNotifier;
+
+        std::string prefix;
+        std::mutex mutex;
+        std::vector<Protocol::ChangeEvent> pending;
+        std::map<std::string, size_t> pending_index; // path -> position in pending
+        int pipe_fds[2] = {-1, -1};
+
+        bool matches(const std::string& path) const;
+        void push(Protocol::ChangeType type, const std::string& path);
+        void overflow();
+    };
+
+    explicit ChangeNotifier(std::filesystem::path root);
+    ~ChangeNotifier();
+
+    // Events for every file at or below prefix, relative to root
+    std::shared_ptr<Subscription> subscribe(const std::string& prefix);
+    void unsubscribe(const std::shared_ptr<Subscription>& subscription);
+
+private:
+    std::filesystem::path root;
+    std::mutex mutex;
+    std::vector<std::shared_ptr<Subscription>> subscriptions;
+
+    // inotify state, owned by the watcher thread once started
+    bool started = false;
+    int inotify_fd = -1;
+    int stop_fds[2] = {-1, -1};
+    std::map<int, std::string> watches; // watch descriptor -> directory relative to root
+    std::map<uint32_t, std::string> moved_dirs; // rename cookie -> directory moved away, until it reappears
+    std::thread watcher;
+
+    bool start(); // Caller holds mutex
+    void watchTree(const std::string& dir, bool report_files);
+    void watchLoop();
+    void publish(Protocol::ChangeType type, const std::string& path);
+    void publishOverflow();
+
+    // Point the watches on dir and below at their new path after a rename, or drop them ("")
+    void moveWatches(const std::string& from, const std::string& to);
+};
+
+#endif // CHANGE_NOTIFIER_HPP
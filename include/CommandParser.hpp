@@ -0,0 +1,48 @@
+#ifndef COMMAND_PARSER_HPP
+#define COMMAND_PARSER_HPP
+
+#include "Protocol.hpp"
+#include "RingBuffer.hpp"
+
+#include <cstdint>
+#include <string>
+
+
+// Resumable parser for command messages and file headers. Fields are taken out of
+// the ring as soon as they are complete and the parse position is kept between
+// calls, so a message split across any number of reads is never re-parsed.
+class CommandParser {
+public:
+    struct Command {
+        Protocol::CommandHeader header;
+        std::string path; // Pathname, or client id for IDENTIFY
+        std::string target; // Destination pathname for COPY / MOVE
+        std::string tail; // Fixed-size fields after the path, see tailSize()
+    };
+
+    // Returns true once a whole command has been parsed into out
+    bool parseCommand(RingBuffer& ring, Command& out);
+
+    // Returns true once a whole FileHeader has been parsed into out
+    bool parseFileHeader(RingBuffer& ring, Protocol::FileHeader& out);
+
+private:
+    enum class State { HEADER, LENGTH, STRING, TARGET_LENGTH, TARGET, TAIL };
+
+    // Command state
+    State command_state = State::HEADER;
+    uint16_t command_string_left = 0;
+    Command command;
+
+    // FileHeader state
+    State file_state = State::HEADER;
+    uint16_t file_string_left = 0;
+    Protocol::FileHeader file_header{};
+
+    static bool hasBody(Protocol::CommandID command);
+    static bool hasTarget(Protocol::CommandID command);
+    static size_t tailSize(Protocol::CommandID command);
+    static bool takeString(RingBuffer& ring, uint16_t& left, std::string& out);
+};
+
+#endif // COMMAND_PARSER_HPP
@@ -2,6 +2,7 @@
 #define CONTENT_FILTER_HPP
 
 #include <string>
+#include <string_view>
 #include <vector>
 
 /**
@@ -11,9 +12,68 @@
  * - Load forbidden words from configuration file
  * - Check text content for forbidden words (case-insensitive)
  * - Report which words were matched
+ * - Scan content incrementally as it streams through (Scanner)
  */
 class ContentFilter {
 public:
+    /**
+     * Scanner - Incremental forbidden word check over a stream
+     *
+     * Content is fed piece by piece and released once it is known to be
+     * clean. Only the trailing bytes that could still turn out to be the
+     * start of a forbidden word are held back (never more than the longest
+     * word - 1), so nothing released is ever part of a match and a piece
+     * ending between words goes out whole. Finds exactly what
+     * containsForbiddenContent() would find in the whole content.
+     *
+     * Bytes that carry no content (eg. chunk framing passed through as it
+     * is) can be interleaved with pass(), they are not scanned but keep
+     * their place among the released bytes.
+     */
+    class Scanner {
+    public:
+        /**
+         * @param filter Filter whose words to look for, must outlive the scanner
+         */
+        explicit Scanner(const ContentFilter& filter);
+
+        /**
+         * Scan the next piece of content
+         *
+         * @param data Next bytes of the stream
+         * @param release Output, bytes now known to be clean are appended
+         * @param matches Output vector of matched forbidden words (original casing)
+         * @return true if a forbidden word was found, nothing more should be sent
+         */
+        bool feed(std::string_view data, std::string& release, std::vector<std::string>& matches);
+
+        /**
+         * Queue bytes that are not content, released along with the content around them
+         *
+         * @param data Bytes to pass through unscanned
+         * @param release Output, bytes now known to be clean are appended
+         */
+        void pass(std::string_view data, std::string& release);
+
+        /**
+         * End of the stream: the held back bytes are clean too
+         *
+         * @param release Output, the held back bytes are appended
+         */
+        void finish(std::string& release);
+
+    private:
+        const ContentFilter& filter;
+        std::vector<std::string> lower_words;
+        size_t holdback = 0;
+        std::string held;                                       // Scanned or passed, not yet released
+        std::string held_content;                               // The content bytes in held
+        std::vector<std::pair<size_t, size_t>> passed;          // Offset and length in held of passed bytes
+
+        // Whether the tail could be the start of a word split across pieces
+        bool startsWord(std::string_view lower_tail) const;
+    };
+
     /**
      * Constructor - loads forbidden words from default file
      * @param filename Path to forbidden words file (default: "forbidden.txt")
@@ -50,6 +50,15 @@ public:
      */
     static std::string build400BadRequest(const std::string& reason = "");
 
+    /**
+     * Build 504 Gateway Timeout response
+     * Used when a request allows only cached responses and none is usable
+     * 
+     * @param reason Optional reason for failure
+     * @return Complete HTTP response (headers + body)
+     */
+    static std::string build504GatewayTimeout(const std::string& reason = "");
+
 private:
     /**
      * Generate styled HTML error page
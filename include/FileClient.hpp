@@ -3,7 +3,11 @@
 
 #include "Protocol.hpp"
 #include "BaseClient.hpp"
+#include "MetadataIndex.hpp"
+#include "MuxClient.hpp"
+#include "SharedRingSession.hpp"
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -27,9 +31,36 @@ protected:
     void makeRequest() override;
 
 private:
-    void identify();
-    void getFile(const std::string& file_name);
-    void putFile(const std::string& file_name);
+    // Identify, measure RTT and bandwidth, then TUNE both ends of the connection
+    void identify(const std::string& client_id);
+    // Conditional transfers are skipped when the other side has the same contents
+    void getFile(const std::string& file_name, bool conditional = false);
+    void getLocalFile(const std::string& file_name); // OPEN_FILE, copy from the server's own descriptor
+    void putFile(const std::string& file_name, bool conditional = false);
+    void copyRemote(const std::string& src, const std::string& dst, bool move); // Server-side COPY / MOVE
+    void getSparse(const std::string& file_name);
+    void putSparse(const std::string& file_name);
+
+    // Protocol v2: run several transfers concurrently over this connection
+    std::unique_ptr<MuxClient> mux;
+    bool enableMultiplex();
+    void multiGet(const std::vector<std::string>& file_names);
+    void multiPut(const std::vector<std::string>& file_names);
+
+    // Same host only: move the connection into shared memory, then get/put run through the rings
+    std::unique_ptr<SharedRingClient> shared_ring;
+    bool enableSharedRing();
+    void ringTransfer(bool get, const std::string& file_name);
+
+    size_t chunk_size = 4096; // recv size, raised by identify()
+    bool local = false;       // Unix domain socket, the server can pass open files
+    MetadataIndex metadata;   // Versions of local files for cget/cput
+
+    // Directory sync: compare listings and transfer only new or changed files
+    bool fetchListing(const std::string& dir, Protocol::Listing& out);
+    void listRemote(const std::string& dir);
+    bool watch(const std::string& prefix); // SUBSCRIBE, prints change events until disconnected
+    void sync(const std::string& direction, const std::string& dir, size_t concurrency);
 
     void sendCommand(Protocol::CommandID command_id, const std::vector<char>& data);
     Protocol::ReplyStatus receiveReply();
@@ -0,0 +1,27 @@
+#ifndef FILE_COPY_HPP
+#define FILE_COPY_HPP
+
+#include <cstdint>
+#include <string>
+
+// Server-local file copies for COPY / MOVE. The data never leaves the kernel where
+// the platform allows it: a reflink shares the blocks outright, copy_file_range()
+// lets the filesystem copy (or offload) them, and read/write is the last resort.
+namespace FileCopy {
+
+    enum class Method { CLONE, COPY_FILE_RANGE, READ_WRITE };
+
+    // Copy all of src_fd into the empty dst_fd, method reports how it was done
+    bool copy(int src_fd, int dst_fd, uint64_t size, Method& method);
+
+    // Copy the file at src to dst, creating dst's parent directories and keeping the permissions
+    bool copyPath(const std::string& src, const std::string& dst, Method& method);
+
+    // Rename, falling back to copy and unlink when src and dst are on different filesystems
+    bool move(const std::string& src, const std::string& dst, Method& method, bool& renamed);
+
+    const char* methodName(Method method);
+
+} // namespace FileCopy
+
+#endif // FILE_COPY_HPP
@@ -2,7 +2,13 @@
 #define FILE_SERVER_HPP
 
 #include "BaseServer.hpp"
+#include "ChangeNotifier.hpp"
+#include "CommandParser.hpp"
+#include "MessageBuilder.hpp"
+#include "MetadataIndex.hpp"
 #include "Protocol.hpp"
+#include "RingBuffer.hpp"
+#include "TransferScheduler.hpp"
 
 #include <string>
 #include <vector>
@@ -10,23 +16,47 @@
 
 class FileServer : public BaseServer {
 public:
-    FileServer(int port);
+    FileServer(int port, const TransferScheduler::Config& scheduler_config = {});
     ~FileServer() = default;
 
 protected:
     void handleRequest(int client_fd) override;
 
 private:
-    bool parseCommand(int client_fd, Protocol::CommandHeader& command_header, std::vector<char>& buffer);
+    // Per-connection state
+    struct Session {
+        int client_fd;
+        TransferScheduler::FlowID flow;
+        RingBuffer ring;        // Received bytes not yet parsed
+        CommandParser parser;   // Parse position within ring
+    };
+
+    TransferScheduler scheduler;
+    MetadataIndex metadata; // Versions of served files for GET/PUT_IF_CHANGED
+    ChangeNotifier notifier; // File change events for SUBSCRIBE
+
+    bool fillRing(Session& session);
+    void handleCommand(Session& session, const CommandParser::Command& command);
     void acknowledgeCommand(int client_fd);
 
-    void handleIdentify(const std::vector<char>& data);
-    void handleGetFile(int client_fd, const std::string& path);
-    void handlePutFile(int client_fd, const std::vector<char>& file_data,
-                       uint16_t permissions, const std::string& dest_path);
-
-    bool readFile(const std::string& file_path, std::vector<char>& buffer);
-    bool writeFile(const std::string& file_path, const std::vector<char>& buffer);
+    void handleIdentify(Session& session, const CommandParser::Command& command);
+    void handleTune(Session& session, const std::string& body);
+    // With a version, the transfer is skipped (NOT_MODIFIED) if the contents match
+    void handleGetFile(Session& session, const std::string& path, const Protocol::FileVersion* known = nullptr);
+    void handlePutFile(Session& session, const std::string& dest_path, const Protocol::FileVersion* offered = nullptr);
+    void handlePutIfChanged(Session& session, const CommandParser::Command& command);
+    void handleEnumerate(Session& session, const std::string& dir);
+    void handleCopy(Session& session, const CommandParser::Command& command); // COPY and MOVE
+    void handleSubscribe(Session& session, const std::string& prefix);
+    void handleOpenFile(Session& session, const std::string& path); // Pass the descriptor, Unix sockets only
+    void handleSharedRing(Session& session, const CommandParser::Command& command);
+    void handleGetSparse(Session& session, const std::string& path);
+    void handlePutSparse(Session& session, const std::string& dest_path);
+
+    // Send a range of an open file through the scheduler, one quantum at a time.
+    // Anything queued in message goes out in front of the first quantum.
+    bool sendFileRange(Session& session, int file_fd, uint64_t offset, uint64_t length,
+                       MessageBuilder& message, bool more_after = false);
 };
 
 #endif // FILE_SERVER_HPP
\ No newline at end of file
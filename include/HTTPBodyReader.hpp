@@ -0,0 +1,71 @@
+#ifndef HTTP_BODY_READER_HPP
+#define HTTP_BODY_READER_HPP
+
+#include "HTTPChunkDecoder.hpp"
+
+#include <cstdint>
+#include <string>
+
+/**
+ * HTTPBodyReader - Reads a message body from a socket piece by piece
+ *
+ * Shared by requests and responses, the body is handed out as it arrives
+ * and exactly as it was sent, whatever its framing:
+ * - Content-Length: up to the length, never reading past it
+ * - Transfer-Encoding: chunked: framing and chunk data in separate pieces,
+ *   told apart by an HTTPChunkDecoder, so the content can be looked at
+ *   while the frames are passed through unchanged
+ * - Until the connection closes (responses only)
+ *
+ * Bytes received after the end of the body belong to the next message and
+ * are kept for it (see leftover()).
+ */
+class HTTPBodyReader {
+public:
+    enum class Framing {
+        NONE,       // No body
+        LENGTH,     // Content-Length
+        CHUNKED,    // Transfer-Encoding: chunked
+        CLOSE       // Until the connection closes
+    };
+
+    /**
+     * @param fd Socket file descriptor
+     * @param framing How the body is delimited
+     * @param length LENGTH: body size
+     * @param buffered Bytes already received after the header section
+     */
+    explicit HTTPBodyReader(int fd = -1, Framing framing = Framing::NONE, uint64_t length = 0,
+                            std::string buffered = "");
+
+    /**
+     * Next piece of the body
+     *
+     * @param data Output, replaced with the bytes received (empty at the end of a body read until close)
+     * @param content Set to true if data is body content, false if it is chunk framing
+     * @return true on success, false if the connection failed first or the framing was invalid
+     */
+    bool next(std::string& data, bool& content);
+
+    // The whole body has been handed out
+    bool done() const { return finished; }
+
+    Framing framing() const { return mode; }
+
+    // Bytes received after the body, the start of the next message
+    std::string leftover() const { return buffer.substr(position); }
+    bool hasLeftover() const { return position < buffer.size(); }
+
+private:
+    static constexpr size_t PIECE_BYTES = 64 * 1024;
+
+    int fd;
+    Framing mode;
+    uint64_t remaining;         // LENGTH: body bytes still to hand out
+    std::string buffer;         // Received, handed out up to position
+    size_t position = 0;
+    bool finished;
+    HTTPChunkDecoder decoder;
+};
+
+#endif // HTTP_BODY_READER_HPP
@@ -0,0 +1,212 @@
+#ifndef HTTP_CACHE_HPP
+#define HTTP_CACHE_HPP
+
+#include "HTTPDiskCache.hpp"
+#include "HTTPResponseParser.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * HTTPCache - Shared in-memory HTTP response cache (RFC 9111)
+ *
+ * Stores GET responses that a shared cache may keep and answers later requests
+ * with them while they are fresh, without contacting the origin:
+ * - Freshness from Cache-Control s-maxage / max-age, then Expires, then a
+ *   heuristic of 10% of the time since Last-Modified
+ * - no-store, private, no-cache, must-revalidate and Authorization honored
+ * - Request max-age, min-fresh, no-cache, no-store and only-if-cached honored
+ * - One stored response per Vary variant of a URI, Vary: * is never stored
+ * - Only complete final responses: no 1xx, 206 or 304, and no body that
+ *   ended with the connection rather than its own framing
+ * - Stale responses with an ETag or Last-Modified are revalidated with a
+ *   conditional request, a 304 refreshes the stored headers
+ * - Unsafe methods invalidate what is stored for their URI
+ *
+ * Entries are spread over shards by URI, each with its own lock, LRU order and
+ * share of the byte budget, so threads serving different URIs rarely contend.
+ *
+ * With a disk directory configured, every stored response is also written to
+ * an HTTPDiskCache that outlives the process. A memory miss falls back to it:
+ * a fresh object is sent straight from its slab file, and one found there
+ * promote_after times is read back into memory, hot objects stay in RAM.
+ * An object larger than a memory shard's budget is always sent from disk.
+ */
+class HTTPCache {
+public:
+    using Clock = std::chrono::system_clock;
+
+    struct Config {
+        size_t max_bytes = 64 * 1024 * 1024;    // Headers and bodies of all stored responses
+        size_t shards = 16;
+        std::string disk_dir;                   // Second tier on disk, none if empty
+        size_t disk_bytes = 1024UL * 1024 * 1024;
+        uint64_t disk_tag = 0;                  // Disk contents from a run with another tag are dropped
+        uint32_t promote_after = 2;             // Disk hits before an object is kept in memory too
+    };
+
+    /**
+     * Counters since startup
+     */
+    struct Stats {
+        uint64_t lookups = 0;       // GET requests the cache could have answered
+        uint64_t hits = 0;          // Answered from the cache without the origin
+        uint64_t disk_hits = 0;     // Of those, sent from the disk tier
+        uint64_t promotions = 0;    // Read back from disk into memory
+        uint64_t revalidated = 0;   // Answered from the cache after a 304
+        uint64_t misses = 0;
+        uint64_t stores = 0;
+        uint64_t evictions = 0;     // Dropped for space
+        uint64_t bytes_saved = 0;   // Response bytes the origin did not have to send
+        size_t bytes_stored = 0;
+        size_t disk_objects = 0;
+    };
+
+    /**
+     * What a lookup found
+     */
+    struct Lookup {
+        enum class Result {
+            MISS,           // Forward the request
+            HIT,            // Send response, nothing else to do
+            VALIDATE,       // Forward the request with validators added, then call revalidated()
+            UNAVAILABLE     // only-if-cached with nothing usable, answer 504
+        };
+
+        Result result = Result::MISS;
+        HTTPResponseParser::ParsedResponse response;  // HIT: stored response with Age, VALIDATE: stored response
+        std::string request;                          // VALIDATE: request with validators
+
+        // HIT from the disk tier: response.full is the header section only, the body is
+        // body_length bytes of body_fd from body_offset. The caller closes body_fd
+        int body_fd = -1;
+        uint64_t body_offset = 0;
+        uint64_t body_length = 0;
+    };
+
+    explicit HTTPCache(const Config& config);
+
+    HTTPCache(const HTTPCache&) = delete;
+    HTTPCache& operator=(const HTTPCache&) = delete;
+
+    /**
+     * Cache key of a request: host:port and the path, whatever form the request target had
+     */
+    static std::string keyFor(const std::string& request, const std::string& host, int port);
+
+    /**
+     * Look for a stored response to a request
+     *
+     * @param key From keyFor()
+     * @param request Complete client request
+     */
+    Lookup lookup(const std::string& key, const std::string& request);
+
+    /**
+     * Finish a revalidation
+     *
+     * @param key From keyFor()
+     * @param request The client request (without the added validators)
+     * @param response The origin's answer to the conditional request
+     * @param stored Lookup::response, its headers are refreshed when the origin answered 304
+     * @return true if stored is now the response to send, false to send (and store) response
+     */
+    bool revalidated(const std::string& key, const std::string& request,
+                     const HTTPResponseParser::ParsedResponse& response,
+                     HTTPResponseParser::ParsedResponse& stored);
+
+    /**
+     * Offer a response from the origin, kept if it may be stored
+     * Responses to unsafe methods invalidate the URI instead.
+     *
+     * @param key From keyFor()
+     * @param request Complete client request
+     * @param response Response that is being sent to the client
+     * @param request_time When the request was sent to the origin
+     */
+    void store(const std::string& key, const std::string& request,
+               const HTTPResponseParser::ParsedResponse& response, Clock::time_point request_time);
+
+    /**
+     * How much of a response body is worth keeping for store(), decided from the
+     * headers alone so the body can be forwarded while it arrives
+     *
+     * @param request Complete client request
+     * @param response_headers Header section of the response
+     * @return Largest body either tier would take, 0 if the response cannot be stored
+     */
+    size_t storableBody(const std::string& request, const std::string& response_headers) const;
+
+    Stats stats() const;
+
+    /**
+     * Plain text summary of stats(), for logs and the stats page
+     */
+    std::string report() const;
+
+private:
+    struct Entry {
+        std::string key;
+        std::vector<std::pair<std::string, std::string>> vary;  // Request header name (lower case), value
+        HTTPResponseParser::ParsedResponse response;
+        Clock::time_point request_time;
+        Clock::time_point response_time;
+        size_t size = 0;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::list<Entry> lru;  // Most recently used first
+        std::unordered_map<std::string, std::vector<std::list<Entry>::iterator>> index;
+        size_t bytes = 0;
+    };
+
+    Config config;
+    size_t shard_budget;
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::unique_ptr<HTTPDiskCache> disk;
+
+    std::atomic<uint64_t> lookups{0}, hits{0}, revalidations{0}, misses{0}, stores{0}, evictions{0};
+    std::atomic<uint64_t> disk_hits{0}, promotions{0};
+    std::atomic<uint64_t> bytes_saved{0};
+
+    Shard& shardFor(const std::string& key);
+
+    // Stored variant matching the request's Vary headers, or lru.end(). Caller holds the lock
+    std::list<Entry>::iterator findVariant(Shard& shard, const std::string& key, const std::string& request);
+    // Add an entry in place of the variant request selects, evicting as needed. Caller holds the lock
+    void insert(Shard& shard, const std::string& request, Entry&& entry);
+    void erase(Shard& shard, std::list<Entry>::iterator entry);
+
+    /**
+     * Try the disk tier after a memory miss
+     * A fresh object that is cold, or too large for a shard, becomes a HIT sent
+     * from disk; a hot or stale one that fits is read into memory, for lookup()
+     * to carry on with as if it had been there.
+     *
+     * @return true if lookup was filled in with a disk HIT
+     */
+    bool lookupDisk(const std::string& key, const std::string& request, Lookup& lookup);
+
+    // Copy an entry to the disk tier, false if there is none or it would not take it
+    bool writeThrough(const Entry& entry);
+
+    // Fresh and allowed by the request's Cache-Control, age set either way
+    static bool usable(const Entry& entry, const std::string& request, Clock::time_point now, std::chrono::seconds& age);
+
+    static bool storable(const std::string& request, const HTTPResponseParser::ParsedResponse& response);
+    // storable() without looking at the body
+    static bool cacheable(const std::string& request, const HTTPResponseParser::ParsedResponse& response);
+    static std::chrono::seconds freshnessLifetime(const Entry& entry);
+    static std::chrono::seconds currentAge(const Entry& entry, Clock::time_point now);
+    static HTTPResponseParser::ParsedResponse withAge(const Entry& entry, std::chrono::seconds age);
+};
+
+#endif // HTTP_CACHE_HPP
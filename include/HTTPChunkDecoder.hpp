@@ -0,0 +1,63 @@
+#ifndef HTTP_CHUNK_DECODER_HPP
+#define HTTP_CHUNK_DECODER_HPP
+
+#include <cstdint>
+#include <string_view>
+
+/**
+ * HTTPChunkDecoder - Incremental decoder for Transfer-Encoding: chunked
+ *
+ * Fed the raw body as it arrives, in pieces of any size, it tells apart
+ * chunk framing (size lines, extensions, CRLFs, trailers) and chunk data
+ * without copying or buffering anything, so a chunked body can be passed
+ * through unchanged while its content is looked at. Every byte is examined
+ * once. It stops at the end of the trailer section: what follows is the
+ * next message.
+ *
+ * Format: <hex-size>[;ext]\r\n<data>\r\n ... 0\r\n[trailers]\r\n
+ */
+class HTTPChunkDecoder {
+public:
+    /**
+     * Consume the next run of the body from the start of data
+     *
+     * A run is either all chunk data or all framing, never both, so the
+     * bytes consumed can be handled as one piece.
+     *
+     * @param data Raw body bytes not yet consumed
+     * @param content Set to true if the run is chunk data, false if framing
+     * @return Bytes consumed, 0 if data is empty, the body is complete or invalid
+     */
+    size_t next(std::string_view data, bool& content);
+
+    // The last chunk and the trailer section have been consumed
+    bool done() const { return state == State::DONE; }
+
+    // The framing was invalid, nothing more is consumed
+    bool failed() const { return state == State::ERROR; }
+
+private:
+    enum class State {
+        SIZE,           // Hex digits of the chunk size
+        EXTENSION,      // After ';' up to the end of the size line
+        SIZE_LF,        // '\n' ending the size line
+        DATA,           // Chunk data
+        DATA_CR,        // '\r' after chunk data
+        DATA_LF,        // '\n' after chunk data
+        TRAILER,        // Start of a trailer line, or the empty line ending the body
+        TRAILER_LINE,   // Inside a trailer field
+        END_LF,         // '\n' of the empty line ending the body
+        DONE,
+        ERROR
+    };
+
+    State state = State::SIZE;
+    uint64_t size = 0;          // Chunk size being parsed, then data left in the chunk
+    bool has_digits = false;
+
+    // Advance over one framing byte
+    void frame(char c);
+    void endSizeLine();
+};
+
+#endif // HTTP_CHUNK_DECODER_HPP
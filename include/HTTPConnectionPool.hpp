@@ -0,0 +1,80 @@
+#ifndef HTTP_CONNECTION_POOL_HPP
+#define HTTP_CONNECTION_POOL_HPP
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/**
+ * HTTPConnectionPool - Idle keep-alive connections to origin servers
+ *
+ * Shared by every client connection of the proxy, so a request to an origin
+ * another client has just used skips DNS, the TCP handshake and slow start.
+ *
+ * - Connections are kept per host:port, newest first
+ * - At most max_idle_per_host wait per origin, max_idle_total overall
+ * - A connection idle longer than idle_timeout is closed rather than reused
+ * - Before reuse, a connection the server has closed (or sent anything on
+ *   unprompted) is detected and dropped
+ */
+class HTTPConnectionPool {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Config {
+        size_t max_idle_per_host = 8;
+        size_t max_idle_total = 256;
+        std::chrono::seconds idle_timeout{30};  // Below the usual server keep-alive timeouts
+    };
+
+    explicit HTTPConnectionPool(const Config& config);
+    ~HTTPConnectionPool();
+
+    HTTPConnectionPool(const HTTPConnectionPool&) = delete;
+    HTTPConnectionPool& operator=(const HTTPConnectionPool&) = delete;
+
+    /**
+     * Get a connection to an origin server
+     *
+     * @param host Hostname or IP address
+     * @param port Port number
+     * @param reused Set to true if an idle connection was taken from the pool
+     * @return Socket file descriptor, or -1 on failure
+     */
+    int acquire(const std::string& host, int port, bool& reused);
+
+    /**
+     * Return a connection after a complete response
+     *
+     * Only call this when the response was fully read and the server
+     * agreed to keep the connection open; otherwise close it.
+     *
+     * @param host Hostname the connection was acquired for
+     * @param port Port number
+     * @param fd Socket file descriptor, kept or closed
+     */
+    void release(const std::string& host, int port, int fd);
+
+private:
+    struct Idle {
+        int fd;
+        Clock::time_point since;
+    };
+
+    Config config;
+    std::mutex mutex;
+    std::unordered_map<std::string, std::deque<Idle>> idle;
+    size_t idle_count = 0;
+
+    // Close connections past idle_timeout, caller holds the lock
+    void prune(Clock::time_point now);
+
+    // Whether the server closed the connection or sent something nobody asked for
+    static bool isStale(int fd);
+
+    static std::string key(const std::string& host, int port);
+};
+
+#endif // HTTP_CONNECTION_POOL_HPP
@@ -0,0 +1,169 @@
+#ifndef HTTP_DISK_CACHE_HPP
+#define HTTP_DISK_CACHE_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * HTTPDiskCache - Persistent second tier behind HTTPCache
+ *
+ * Responses are appended to a ring of large slab files, and a fixed size
+ * index file maps the hash of each cache key to where its object lives:
+ * - The index is mapped into memory and used in place, so a restart only
+ *   maps the file again instead of reading back every stored object
+ * - Bodies are sent from the slab with sendfile, never copied into the proxy
+ * - When the ring wraps, the oldest slab is recreated and everything in it
+ *   is dropped at once by bumping the slab's generation
+ * - One stored response per key; Vary is checked by the caller
+ * - The lock only covers the index: a writer reserves its range of the slab
+ *   under it and does the I/O after, readers read through their own
+ *   descriptor, so slow disks don't serialize every request
+ * - The index file is flock()ed, a second process can't share the directory
+ *
+ * Objects are written before the index slot naming them, and a slot is only
+ * believed once the key stored next to the object matches, so an index
+ * written by a killed process at worst loses the last objects.
+ * A tag (eg. a fingerprint of the content filter) is kept in the index and
+ * a different tag at startup discards everything stored.
+ */
+class HTTPDiskCache {
+public:
+    using Clock = std::chrono::system_clock;
+
+    struct Config {
+        std::string dir;
+        size_t max_bytes = 1024UL * 1024 * 1024;   // All slabs together
+        size_t slab_bytes = 64 * 1024 * 1024;      // Largest object that can be stored
+        size_t slots = 65536;                      // Most objects the index can name
+        uint64_t tag = 0;
+    };
+
+    /**
+     * A stored response as found on disk, the body is left in its slab
+     */
+    struct Object {
+        std::vector<std::pair<std::string, std::string>> vary;  // Request header name (lower case), value
+        std::string headers;
+        int status_code = 0;
+        Clock::time_point request_time;
+        Clock::time_point response_time;
+        uint32_t hits = 0;          // Times found, this one included
+        int fd = -1;                // Slab holding the body, the caller closes it
+        uint64_t body_offset = 0;
+        uint64_t body_length = 0;
+    };
+
+    explicit HTTPDiskCache(const Config& config);
+    ~HTTPDiskCache();
+
+    HTTPDiskCache(const HTTPDiskCache&) = delete;
+    HTTPDiskCache& operator=(const HTTPDiskCache&) = delete;
+
+    /**
+     * Whether the directory and index could be opened, nothing is stored otherwise
+     */
+    bool ready() const { return index != nullptr; }
+
+    /**
+     * Find the object stored for a key
+     *
+     * @param key Cache key
+     * @param object Filled in when found, object.fd stays readable even if the slab is reused
+     * @return true if found
+     */
+    bool find(const std::string& key, Object& object);
+
+    /**
+     * Read an object's body into memory
+     *
+     * @param object From find()
+     * @param body Output body
+     * @return true if the whole body was read
+     */
+    static bool readBody(const Object& object, std::string& body);
+
+    /**
+     * Store a response for a key, replacing what was stored for it
+     *
+     * @param key Cache key
+     * @param object Response to store, fd and offsets are ignored
+     * @param body Response body
+     * @return true if stored
+     */
+    bool put(const std::string& key, const Object& object, const std::string& body);
+
+    /**
+     * Drop what is stored for a key
+     */
+    void erase(const std::string& key);
+
+    /**
+     * Largest object (key, headers and body) that can be stored
+     */
+    size_t maxObjectBytes() const { return config.slab_bytes; }
+
+    /**
+     * Number of objects the index names
+     */
+    size_t objects();
+
+    /**
+     * Stable 64-bit hash (FNV-1a), never 0, for keys and tags
+     */
+    static uint64_t hash(std::string_view data);
+
+private:
+    static constexpr size_t MAX_SLABS = 256;
+    static constexpr size_t PROBES = 8;
+
+    struct IndexHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t slot_count;
+        uint32_t slab_count;
+        uint32_t current_slab;
+        uint64_t slab_bytes;
+        uint64_t tag;
+        uint64_t write_offset;          // Next free byte in the current slab
+        uint32_t generations[MAX_SLABS];
+    };
+
+    struct Slot {
+        uint64_t hash;                  // 0 when empty
+        uint32_t slab;
+        uint32_t generation;            // The slab's when written, stale once it is reused
+        uint64_t offset;                // Object start in the slab
+        uint32_t meta_length;           // Key and Vary fields before the headers
+        uint32_t header_length;
+        uint64_t body_length;
+        int64_t request_time;           // Nanoseconds since the epoch
+        int64_t response_time;
+        uint32_t hits;
+        int32_t status_code;
+    };
+
+    Config config;
+    std::mutex mutex;                   // Guards the index, never held across slab I/O
+    int index_fd = -1;                  // Kept open for the flock
+    IndexHeader* index = nullptr;       // Mapped index file
+    Slot* slots = nullptr;
+    size_t map_bytes = 0;
+    std::vector<int> slabs;
+
+    // Map the index, reusing it when it was written with the same geometry and tag
+    bool open();
+    // Names an object of the slab's current generation that lies wholly inside the slab
+    bool live(const Slot& slot) const;
+
+    // Start the next slab of the ring over, dropping the objects in it. Caller holds the lock
+    bool rotate();
+
+    std::string slabPath(size_t slab) const;
+};
+
+#endif // HTTP_DISK_CACHE_HPP
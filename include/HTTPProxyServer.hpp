@@ -3,6 +3,10 @@
 
 #include "BaseServer.hpp"
 #include "ContentFilter.hpp"
+#include "HTTPCache.hpp"
+#include "HTTPConnectionPool.hpp"
+#include "HTTPRequestParser.hpp"
+#include "HTTPResponseParser.hpp"
 #include <string>
 
 /**
@@ -12,7 +16,9 @@
  * - HTTP proxying (GET, POST, etc.)
  * - HTTPS tunneling (CONNECT method)
  * - Request and response filtering based on forbidden words
- * - Persistent connections (HTTP/1.1 keep-alive)
+ * - Request and response bodies forwarded as they arrive (chunked request
+ *   bodies included), filtered incrementally on the way
+ * - Persistent connections (HTTP/1.1 keep-alive), to clients and to servers
  * 
  * Architecture:
  * This class orchestrates the proxy workflow by delegating to specialized components:
@@ -21,6 +27,9 @@
  * - ContentFilter: Checks for forbidden content
  * - ErrorResponseBuilder: Generates error pages
  * - HTTPSTunnel: Handles HTTPS CONNECT tunneling
+ * - HTTPConnectionPool: Keeps idle server connections for reuse across clients
+ * - HTTPCache: Answers repeated requests for cacheable responses, from memory
+ *   or from an optional disk tier that survives restarts
  * 
  * The result is a clean, maintainable orchestration layer with single responsibility.
  */
@@ -30,8 +39,10 @@ public:
      * Constructor
      * @param port Port to listen on
      * @param forbidden_file Path to forbidden words file (default: "forbidden.txt")
+     * @param cache_dir Directory for the persistent cache tier (default: none, memory only)
      */
-    explicit HTTPProxyServer(int port, const std::string& forbidden_file = "forbidden.txt");
+    explicit HTTPProxyServer(int port, const std::string& forbidden_file = "forbidden.txt",
+                             const std::string& cache_dir = "");
 
 protected:
     /**
@@ -43,7 +54,18 @@ protected:
     void handleRequest(int client_fd) override;
 
 private:
+    enum class ForwardResult {
+        COMPLETE,   // Whole message sent
+        BLOCKED,    // Forbidden content, the client got the error page or the message was cut off
+        CUT_SHORT,  // The sending side's connection failed before the end of the message
+        FAILED      // Sending to the receiving side failed
+    };
+
+    static constexpr size_t REPLAY_BYTES = 64 * 1024;  // Most request body kept for a retry
+
     ContentFilter filter;  // Content filtering component
+    HTTPConnectionPool upstreams;  // Idle server connections, shared by all clients
+    HTTPCache cache;               // Stored responses, shared by all clients
 
     // === Networking Utilities ===
     
@@ -64,6 +86,75 @@ private:
      * @return true on success, false on failure
      */
     bool sendData(int fd, const std::string& data);
+
+    /**
+     * Send a request to the server, its body forwarded as it arrives
+     *
+     * The body is scanned for forbidden words on the way and a chunked body
+     * is passed through frame by frame. The head waits for the first piece
+     * of the body to be scanned, so a match in it never reaches the server.
+     * A match sends the client a 403 page.
+     *
+     * @param client_fd Client socket file descriptor
+     * @param server_fd Server socket file descriptor
+     * @param head Request head to send
+     * @param incoming Client request, head already read
+     * @param scanner Body scanner, kept across a retry
+     * @param replay Body bytes sent so far, sent again first on a retry
+     * @param replayable Cleared once the body outgrows REPLAY_BYTES
+     * @return How forwarding ended
+     */
+    ForwardResult forwardRequest(int client_fd, int server_fd, const std::string& head,
+                                 HTTPRequestParser::Stream& incoming, ContentFilter::Scanner& scanner,
+                                 std::string& replay, bool& replayable);
+
+    /**
+     * Forward a response body to the client as it arrives
+     *
+     * The body is scanned for forbidden words on the way, and no byte of a
+     * match ever reaches the client. The headers leave once the first piece
+     * has been scanned, so a match in it still gets the 503 page; a later
+     * one cuts the response off.
+     *
+     * @param client_fd Client socket file descriptor
+     * @param stream Server response, headers already read
+     * @param body Output: a copy of the body for the cache
+     * @param body_limit Most body bytes to copy, 0 for none
+     * @param body_kept Set to true if body holds the whole body
+     * @return How forwarding ended
+     */
+    ForwardResult forwardResponse(int client_fd, HTTPResponseParser::Stream& stream,
+                                  std::string& body, size_t body_limit, bool& body_kept);
+
+    /**
+     * Check whether a request may be sent again after a failure
+     * A reused connection the server closed just as the request went out
+     * fails without any response, and only idempotent methods can be retried.
+     *
+     * @param method Request method
+     * @return true for GET, HEAD, OPTIONS, TRACE, PUT and DELETE
+     */
+    static bool isIdempotent(const std::string& method);
+
+    /**
+     * Check whether a request asks for the proxy's cache statistics
+     * Only a request sent to the proxy itself (origin-form "/cache-stats")
+     * qualifies, a proxied request always names its server.
+     *
+     * @param request HTTP request string
+     * @return true for GET /cache-stats
+     */
+    static bool isStatsRequest(const std::string& request);
+
+    /**
+     * Cache settings for this proxy
+     * The disk tier is tagged with the forbidden words, so bodies stored
+     * under another word list are dropped instead of served unchecked.
+     *
+     * @param cache_dir Directory for the disk tier, empty for none
+     * @return Cache configuration
+     */
+    HTTPCache::Config cacheConfig(const std::string& cache_dir) const;
 };
 
 #endif // HTTP_PROXY_SERVER_HPP
\ No newline at end of file
@@ -1,15 +1,19 @@
 #ifndef HTTP_REQUEST_PARSER_HPP
 #define HTTP_REQUEST_PARSER_HPP
 
+#include "HTTPBodyReader.hpp"
+
 #include <string>
 
 /**
  * HTTPRequestParser - Handles reading and parsing HTTP requests from client sockets
  * 
  * Responsibilities:
- * - Read complete HTTP request (headers + body if present)
+ * - Read the request head and work out how its body is delimited
  * - Parse destination host and port
  * - Determine request type (GET, POST, CONNECT, etc.)
+ * - Hand out the body piece by piece as it arrives (Stream), for forwarding
+ *   large uploads without holding them
  */
 class HTTPRequestParser {
 public:
@@ -26,12 +30,55 @@ public:
     };
 
     /**
-     * Read a complete HTTP request from the client socket
-     * 
-     * @param client_fd Socket file descriptor
-     * @return Complete HTTP request as string (headers + body), or empty string on error
+     * A request read incrementally: the head (request line and headers)
+     * first, then the body as it arrives, Content-Length or chunked.
+     * Bytes of a pipelined next request are kept for it (see leftover()).
      */
-    static std::string readRequest(int client_fd);
+    class Stream {
+    public:
+        /**
+         * @param client_fd Socket file descriptor (-1 for an empty stream)
+         * @param buffered Bytes already received, left over from the previous request
+         */
+        explicit Stream(int client_fd = -1, std::string buffered = "");
+
+        /**
+         * Read the head and work out how the body is delimited
+         *
+         * @return true on success, false if the connection closed or failed first
+         */
+        bool readHead();
+
+        const std::string& head() const { return head_section; }
+
+        // Content-Length and Transfer-Encoding can't be read one way only: answer 400 and close
+        bool badFraming() const { return bad_framing; }
+
+        // The request has a body (it may already be fully read)
+        bool hasBody() const { return body.framing() != HTTPBodyReader::Framing::NONE; }
+
+        // The whole body has been handed out
+        bool done() const { return body.done(); }
+
+        /**
+         * Next piece of the body, as received
+         *
+         * @param data Output, replaced with the bytes received
+         * @param content Set to true if data is body content, false if it is chunk framing
+         * @return true on success, false if the connection failed before the body was complete
+         */
+        bool next(std::string& data, bool& content) { return body.next(data, content); }
+
+        // Bytes received after this request, once its body is done
+        std::string leftover() const { return body.leftover(); }
+
+    private:
+        int fd;
+        std::string buffered;
+        std::string head_section;
+        bool bad_framing = false;
+        HTTPBodyReader body;
+    };
 
     /**
      * Parse the destination host and port from an HTTP request
@@ -80,30 +127,16 @@ public:
 
 private:
     /**
-     * Helper: Read until we have complete headers (ending with \r\n\r\n)
-     * 
-     * @param client_fd Socket file descriptor
-     * @param headers Output parameter for headers
-     * @return true on success, false on connection error
-     */
-    static bool readHeaders(int client_fd, std::string& headers);
-
-    /**
-     * Helper: Read exactly n bytes from socket
-     * 
-     * @param fd Socket file descriptor
-     * @param n Number of bytes to read
-     * @return Data read, or shorter string if connection closed
-     */
-    static std::string readExact(int fd, size_t n);
-
-    /**
-     * Helper: Parse Content-Length from headers
-     * 
+     * Helper: Work out how the body of a request is delimited
+     * Every field line is looked at, so a second Content-Length or one
+     * the server would read differently can't slip past.
+     *
      * @param headers HTTP headers string
-     * @return Content length, or 0 if not present
+     * @param framing Output, NONE, LENGTH or CHUNKED
+     * @param content_length Output, the body size for LENGTH
+     * @return false if the framing fields are malformed or contradict each other
      */
-    static size_t parseContentLength(const std::string& headers);
+    static bool parseFraming(const std::string& headers, HTTPBodyReader::Framing& framing, size_t& content_length);
 };
 
 #endif // HTTP_REQUEST_PARSER_HPP
\ No newline at end of file
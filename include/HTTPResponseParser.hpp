@@ -1,18 +1,21 @@
 #ifndef HTTP_RESPONSE_PARSER_HPP
 #define HTTP_RESPONSE_PARSER_HPP
 
+#include "HTTPBodyReader.hpp"
+
 #include <string>
 
 /**
  * HTTPResponseParser - Handles reading and parsing HTTP responses from server sockets
  * 
  * Responsibilities:
- * - Read complete HTTP response (headers + body)
- * - Handle different body encoding methods:
+ * - Read the header section and work out how the body is delimited:
  *   - Content-Length (fixed size)
  *   - Transfer-Encoding: chunked
  *   - Connection close (read until EOF)
  * - Parse response status and headers
+ * - Hand out the body piece by piece as it arrives (Stream), for forwarding
+ *   without holding the whole response
  */
 class HTTPResponseParser {
 public:
@@ -25,22 +28,66 @@ public:
         std::string full;         // headers + body
         int status_code;          // HTTP status code (200, 404, etc.)
         bool valid;               // Whether parsing succeeded
+        bool delimited;           // Body ended by its framing, not by EOF: the connection can carry another
         
-        ParsedResponse() : status_code(0), valid(false) {}
+        ParsedResponse() : status_code(0), valid(false), delimited(false) {}
     };
 
     /**
-     * Read a complete HTTP response from the server socket
-     * 
-     * This handles all three methods of specifying body length:
-     * 1. Content-Length header
-     * 2. Transfer-Encoding: chunked
-     * 3. Read until connection closes (HTTP/1.0 style)
-     * 
-     * @param server_fd Socket file descriptor
-     * @return ParsedResponse object with headers, body, and metadata
+     * A response read incrementally: headers first, then the body in pieces
+     * of at most one receive each, so it can be forwarded while it arrives.
+     *
+     * Chunked bodies are handed out as they were sent, frame by frame, with
+     * chunk data and framing in separate pieces.
      */
-    static ParsedResponse readResponse(int server_fd);
+    class Stream {
+    public:
+        /**
+         * @param server_fd Socket file descriptor (-1 for an empty stream)
+         * @param head_request The request was HEAD, so no body follows whatever the headers say
+         */
+        explicit Stream(int server_fd = -1, bool head_request = false);
+
+        /**
+         * Read the header section and work out how the body is delimited
+         * Interim (1xx) responses before the final one are skipped.
+         *
+         * @return true on success, false if the connection failed first
+         */
+        bool readHeaders();
+
+        /**
+         * Next piece of the body, as received
+         *
+         * @param data Output, replaced with the bytes received (empty at the end of a body read until close)
+         * @param content Set to true if data is body content, false if it is chunk framing
+         * @return true on success, false if the connection failed before the body was complete
+         */
+        bool next(std::string& data, bool& content) { return body.next(data, content); }
+
+        const std::string& headers() const { return header_section; }
+        int statusCode() const { return status_code; }
+
+        // The whole body has been handed out
+        bool done() const { return body.done(); }
+
+        // Body ended by its framing, nothing extra followed: the connection can carry another response
+        bool delimited() const {
+            return body.done() && !body.hasLeftover() && body.framing() != HTTPBodyReader::Framing::CLOSE;
+        }
+
+        // The body's end is marked in the message, a client can tell where it stops without a close
+        bool framed() const { return body.framing() != HTTPBodyReader::Framing::CLOSE; }
+
+        bool chunked() const { return body.framing() == HTTPBodyReader::Framing::CHUNKED; }
+
+    private:
+        int fd;
+        bool head_request;
+        std::string header_section;
+        int status_code = 0;
+        HTTPBodyReader body;
+    };
 
     /**
      * Extract the value of a specific header (case-insensitive)
@@ -70,7 +117,8 @@ public:
 private:
     /**
      * Read headers with overflow handling
-     * Returns headers and any extra bytes that were read (part of body)
+     * Starts with the bytes already in overflow (left after an interim response),
+     * then replaces it with any extra bytes that were read (part of body)
      */
     static bool readHeaders(int fd, std::string& headers, std::string& overflow);
 
@@ -87,28 +135,9 @@ private:
 
     /**
      * Parse Content-Length header value
+     * Returns false if the header is missing or invalid
      */
-    static size_t parseContentLength(const std::string& headers);
-
-    /**
-     * Read fixed-length body (when Content-Length is specified)
-     */
-    static std::string readFixedLengthBody(int fd, size_t length, const std::string& overflow);
-
-    /**
-     * Read chunked-encoded body
-     * Format: <hex-size>\r\n<data>\r\n ... 0\r\n\r\n
-     */
-    static std::string readChunkedBody(int fd, std::string& buffer);
-
-    /**
-     * Read body until connection closes (HTTP/1.0 style)
-     */
-    static std::string readUntilClose(int fd, const std::string& overflow);
-
-    // Buffered reading helpers for chunked encoding
-    static bool readLine(int fd, std::string& buffer, std::string& line);
-    static std::string readExactFromBuffer(int fd, std::string& buffer, size_t n);
+    static bool parseContentLength(const std::string& headers, size_t& length);
 };
 
 #endif // HTTP_RESPONSE_PARSER_HPP
\ No newline at end of file
@@ -16,7 +16,8 @@
  * primarily used for HTTPS connections where the proxy cannot
  * decrypt or inspect the traffic.
  * 
- * Uses NetworkUtils for connection establishment and data transmission.
+ * Uses NetworkUtils for connection establishment. Forwarding runs on
+ * the shared RelayEngine, so an open tunnel does not hold a thread.
  */
 class HTTPSTunnel {
 public:
@@ -26,12 +27,14 @@ public:
      * This method:
      * 1. Connects to the destination server (via NetworkUtils)
      * 2. Sends "200 Connection Established" to client
-     * 3. Forwards data bidirectionally until either side closes
+     * 3. Hands both sockets to RelayEngine, which forwards data until
+     *    both sides are done and then closes them
      * 
      * @param client_fd Client socket file descriptor
      * @param host Destination hostname
      * @param port Destination port (typically 443 for HTTPS)
-     * @return true if tunnel was established successfully, false on connection failure
+     * @return true if the tunnel was established; client_fd then belongs to
+     *         RelayEngine. false on connection failure, client_fd stays with the caller
      */
     static bool establish(int client_fd, const std::string& host, int port);
 
@@ -44,24 +47,12 @@ public:
      * @param host Destination hostname
      * @param port Destination port
      * @param success_response Response to send to client (default: "HTTP/1.1 200 Connection Established\r\n\r\n")
-     * @return true if tunnel was established successfully, false on connection failure
+     * @return true if the tunnel was established (client_fd now belongs to RelayEngine), false on connection failure
      */
     static bool establish(int client_fd, 
                          const std::string& host, 
                          int port,
                          const std::string& success_response);
-
-private:
-    /**
-     * Perform bidirectional forwarding between client and server
-     * 
-     * Uses select() for efficient multiplexing.
-     * Continues until either side closes the connection.
-     * 
-     * @param client_fd Client socket
-     * @param server_fd Server socket
-     */
-    static void forwardTraffic(int client_fd, int server_fd);
 };
 
 #endif // HTTPS_TUNNEL_HPP
\ No newline at end of file
@@ -0,0 +1,37 @@
+#ifndef LOCAL_SOCKET_HPP
+#define LOCAL_SOCKET_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Unix domain socket transport for clients on the same host as the server. The
+// protocol is the same as over TCP, but the connection can also carry open file
+// descriptors (SCM_RIGHTS), which lets OPEN_FILE hand the client the server's file
+// instead of streaming its contents.
+namespace LocalSocket {
+
+    // Hosts written as "unix:/path/to/socket" name a Unix domain socket
+    constexpr const char* PREFIX = "unix:";
+    bool isLocalAddress(const std::string& host);
+    std::string socketPath(const std::string& host); // Strips PREFIX
+
+    // Listening socket at path, replacing a stale socket file. -1 on failure.
+    int listen(const std::string& path);
+    int connect(const std::string& path);
+
+    // True if fd is a Unix domain socket, ie. the peer shares our kernel
+    bool isLocal(int socket_fd);
+
+    // Send length bytes with file_fds attached. The receiver gets its own descriptors
+    // for the same open files.
+    bool sendFds(int socket_fd, const std::vector<int>& file_fds, const char* data, size_t length);
+    bool sendFd(int socket_fd, int file_fd, const char* data, size_t length);
+
+    // Receive exactly length bytes and the descriptors attached to them, in the order sent
+    std::vector<int> receiveFds(int socket_fd, char* data, size_t length, bool& ok);
+    int receiveFd(int socket_fd, char* data, size_t length, bool& ok); // -1 if none came
+
+} // namespace LocalSocket
+
+#endif // LOCAL_SOCKET_HPP
@@ -0,0 +1,58 @@
+#ifndef MESSAGE_BUILDER_HPP
+#define MESSAGE_BUILDER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <sys/socket.h>
+#include <vector>
+
+// MSG_MORE tells the kernel more data follows right away, so a header is held back
+// and goes out in the same segment as the data after it. Not available everywhere.
+#ifdef MSG_MORE
+constexpr int SEND_MORE = MSG_MORE;
+#else
+constexpr int SEND_MORE = 0;
+#endif
+
+
+// Collects the pieces of one or more protocol messages and sends them with a single
+// sendmsg() call. Small fields are copied into the builder, payloads are only
+// referenced and must stay valid until flush() returns.
+class MessageBuilder {
+public:
+    void appendUint8(uint8_t value);
+    void appendUint16(uint16_t value);
+    void appendUint32(uint32_t value);
+    void appendUint64(uint64_t value);
+    void appendBytes(const void* data, size_t length);          // Copied
+    void appendBytes(const std::vector<char>& data);            // Copied
+    void appendRef(const void* data, size_t length);            // Referenced
+
+    // Encode a schema message (MessageSchema.hpp) directly into the builder
+    template<typename Schema, typename... Values>
+    void append(const Values&... values) {
+        Schema::write(reserve(Schema::size(values...)), values...);
+    }
+
+    // Send everything, more = the caller will send again right after
+    bool flush(int socket_fd, bool more = false);
+
+    size_t size() const { return total; }
+    bool empty() const { return total == 0; }
+    void clear();
+
+private:
+    struct Segment {
+        const char* ref;    // nullptr for bytes held in storage
+        size_t offset;
+        size_t length;
+    };
+
+    std::vector<char> storage;
+    std::vector<Segment> segments;
+    size_t total = 0;
+
+    char* reserve(size_t length);
+};
+
+#endif // MESSAGE_BUILDER_HPP
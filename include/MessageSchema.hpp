@@ -0,0 +1,195 @@
+#ifndef MESSAGE_SCHEMA_HPP
+#define MESSAGE_SCHEMA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Protocol.hpp"
+
+
+// Compile-time description of the wire messages. A message is a list of field
+// codecs; Message<...> generates its size, a serializer that writes straight into
+// a caller's buffer and a bounds-checked parser. Everything is inline, so a
+// fixed-size message compiles down to a handful of loads and stores.
+//
+// A field codec provides:
+//   In, Out          the type written from / parsed into
+//   MIN_SIZE, FIXED  encoded size (the smallest possible one if not fixed)
+//   size(in)         encoded size of a value
+//   write(dest, in)  encode at dest, return the end of the field
+//   read(data, end, out)  decode, nullptr if [data, end) is too short
+namespace Protocol::Schema {
+
+    // Little-Endian Integer
+    template<typename T>
+    struct Int {
+        using In = T;
+        using Out = T;
+        static constexpr size_t MIN_SIZE = sizeof(T);
+        static constexpr bool FIXED = true;
+
+        static constexpr size_t size(In) { return sizeof(T); }
+
+        static char* write(char* dest, In value) {
+            store(dest, value);
+            return dest + sizeof(T);
+        }
+
+        static const char* read(const char* data, const char* end, Out& out) {
+            if (end - data < static_cast<ptrdiff_t>(sizeof(T))) return nullptr;
+            out = load<T>(data);
+            return data + sizeof(T);
+        }
+    };
+
+    using U8 = Int<uint8_t>;
+    using U16 = Int<uint16_t>;
+    using U32 = Int<uint32_t>;
+    using U64 = Int<uint64_t>;
+
+    // One-byte enumeration
+    template<typename E>
+    struct Enum8 {
+        using In = E;
+        using Out = E;
+        static constexpr size_t MIN_SIZE = 1;
+        static constexpr bool FIXED = true;
+
+        static constexpr size_t size(In) { return 1; }
+
+        static char* write(char* dest, In value) {
+            *dest = static_cast<char>(value);
+            return dest + 1;
+        }
+
+        static const char* read(const char* data, const char* end, Out& out) {
+            if (data == end) return nullptr;
+            out = static_cast<E>(static_cast<uint8_t>(*data));
+            return data + 1;
+        }
+    };
+
+    // Command header: command ID and 3 reserved bytes, sent as zeros and ignored on read
+    struct Command {
+        using In = CommandID;
+        using Out = CommandID;
+        static constexpr size_t MIN_SIZE = COMMAND_HEADER_SIZE;
+        static constexpr bool FIXED = true;
+
+        static constexpr size_t size(In) { return COMMAND_HEADER_SIZE; }
+
+        static char* write(char* dest, In value) {
+            dest[0] = static_cast<char>(value);
+            dest[1] = dest[2] = dest[3] = 0;
+            return dest + COMMAND_HEADER_SIZE;
+        }
+
+        static const char* read(const char* data, const char* end, Out& out) {
+            if (end - data < static_cast<ptrdiff_t>(COMMAND_HEADER_SIZE)) return nullptr;
+            out = static_cast<CommandID>(static_cast<uint8_t>(data[0]));
+            return data + COMMAND_HEADER_SIZE;
+        }
+    };
+
+    // uint16 length, then that many bytes
+    struct String16 {
+        using In = std::string_view;
+        using Out = std::string;
+        static constexpr size_t MIN_SIZE = 2;
+        static constexpr bool FIXED = false;
+
+        static constexpr size_t size(In value) { return 2 + value.size(); }
+
+        static char* write(char* dest, In value) {
+            store(dest, static_cast<uint16_t>(value.size()));
+            std::memcpy(dest + 2, value.data(), value.size());
+            return dest + 2 + value.size();
+        }
+
+        static const char* read(const char* data, const char* end, Out& out) {
+            if (end - data < 2) return nullptr;
+            size_t length = load<uint16_t>(data);
+            if (static_cast<size_t>(end - data - 2) < length) return nullptr;
+            out.assign(data + 2, length);
+            return data + 2 + length;
+        }
+    };
+
+
+    template<typename... Fields>
+    struct Message {
+        static constexpr size_t MIN_SIZE = (Fields::MIN_SIZE + ...);
+        static constexpr bool FIXED = (Fields::FIXED && ...);
+
+        static constexpr size_t size(typename Fields::In... values) {
+            return (Fields::size(values) + ...);
+        }
+
+        // Encode at dest, which must hold size(values...) bytes; returns the end
+        static char* write(char* dest, typename Fields::In... values) {
+            ((dest = Fields::write(dest, values)), ...);
+            return dest;
+        }
+
+        // Encode at the end of out
+        static void append(std::vector<char>& out, typename Fields::In... values) {
+            size_t start = out.size();
+            out.resize(start + size(values...));
+            write(out.data() + start, values...);
+        }
+
+        // Decode one whole message from the start of [data, data + length). False
+        // if it isn't all there yet; consumed is the encoded size otherwise.
+        static bool read(const char* data, size_t length, size_t& consumed, typename Fields::Out&... out) {
+            const char* end = data + length;
+            const char* position = data;
+            if (!(((position = Fields::read(position, end, out)) != nullptr) && ...)) return false;
+            consumed = static_cast<size_t>(position - data);
+            return true;
+        }
+
+        static bool read(const std::vector<char>& buffer, size_t offset, size_t& out_next_offset, typename Fields::Out&... out) {
+            if (buffer.size() < offset + MIN_SIZE) return false;
+            size_t consumed;
+            if (!read(buffer.data() + offset, buffer.size() - offset, consumed, out...)) return false;
+            out_next_offset = offset + consumed;
+            return true;
+        }
+    };
+
+
+    // Command Messages
+    using PathCommand = Message<Command, String16>;                 // GET_FILE, PUT_FILE, ENUMERATE, *_SPARSE, SUBSCRIBE, OPEN_FILE
+    using IdentifyCommand = Message<Command, String16, U32>;        // client ID, probe_bytes
+    using TuneCommand = Message<Command, U32, U64, U32, U32>;       // rtt_us, bandwidth, buffer_size, chunk_size
+    using ConditionalCommand = Message<Command, String16, U64, U64, U64>; // path, FileVersion
+    using CopyCommand = Message<Command, String16, String16>;       // COPY, MOVE: source, destination
+    using SharedRingCommand = Message<Command, U32>;                // ring capacity
+
+    // Bodies
+    using FileVersion = Message<U64, U64, U64>;                     // size, mtime_ns, hash
+    using FileHeader = Message<U16, String16, U64>;                 // permissions, path, file_size
+    using ListingEntry = Message<U16, String16, U64, U64, U64>;     // permissions, path, FileVersion
+    using ChangeEvent = Message<Enum8<ChangeType>, String16>;       // type, path
+    using Extent = Message<U64, U64>;                               // offset, length
+    using Count = Message<U32>;                                     // Listing, ChangeBatch and ExtentMap entry count
+
+    // Tails That Follow the Path, Read by CommandParser
+    using IdentifyTail = Message<U32>;
+    using TuneBody = Message<U32, U64, U32, U32>;
+    using SharedRingTail = Message<U32>;
+
+    static_assert(IdentifyTail::MIN_SIZE == IDENTIFY_TAIL_SIZE);
+    static_assert(TuneBody::MIN_SIZE == TUNE_SIZE);
+    static_assert(SharedRingTail::MIN_SIZE == SHARED_RING_TAIL_SIZE);
+    static_assert(FileVersion::FIXED && FileVersion::MIN_SIZE == FILE_VERSION_SIZE);
+    static_assert(Extent::FIXED && Extent::MIN_SIZE == EXTENT_SIZE);
+    static_assert(TuneCommand::FIXED && TuneCommand::MIN_SIZE == COMMAND_HEADER_SIZE + TUNE_SIZE);
+
+} // namespace Protocol::Schema
+
+#endif // MESSAGE_SCHEMA_HPP
@@ -0,0 +1,61 @@
+#ifndef METADATA_INDEX_HPP
+#define METADATA_INDEX_HPP
+
+#include "Protocol.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+
+
+// Persistent map of file name -> FileVersion for conditional transfers. A file is
+// only re-hashed when its size or modification time no longer match the entry,
+// so answering "has this changed?" usually costs a stat() and no reads. Changes
+// are appended to the index file as they happen; it is only rewritten once most
+// of its lines are stale.
+class MetadataIndex {
+public:
+    static constexpr const char* DEFAULT_NAME = ".netcopy-index";
+
+    explicit MetadataIndex(std::filesystem::path index_path);
+
+    // Current version of the file at path, recorded under key. False if the file
+    // is missing or not a regular file.
+    bool version(const std::filesystem::path& path, const std::string& key, Protocol::FileVersion& out);
+
+    // Versions of every regular file below root/dir, recursively, with paths
+    // relative to root/dir. The index files themselves are left out.
+    bool list(const std::filesystem::path& root, const std::string& dir, Protocol::Listing& out);
+
+    // Record a version whose hash is already known, eg. from a verified transfer
+    void record(const std::string& key, const Protocol::FileVersion& version);
+    void forget(const std::string& key);
+    void rename(const std::string& from, const std::string& to); // After the file itself was moved
+
+    // FNV-1a 64, feed data in any number of pieces starting from FNV_OFFSET
+    static constexpr uint64_t FNV_OFFSET = 0xcbf29ce484222325ull;
+    static uint64_t hash(uint64_t state, const char* data, size_t length);
+    static bool hashFile(int file_fd, uint64_t& out);
+
+    // Set the modification time of an open file, mtime_ns since the epoch
+    static bool setMtime(int file_fd, uint64_t mtime_ns);
+
+private:
+    std::filesystem::path index_path;
+    std::mutex mutex;
+    std::map<std::string, Protocol::FileVersion> entries;
+    std::ofstream journal;      // Index file, opened for appending
+    size_t journal_lines = 0;   // Lines in the index file, live or not
+
+    void load();
+
+    // Append an entry, or its removal, to the index file. Caller holds mutex
+    void append(const std::string& key, const Protocol::FileVersion* version);
+    void save(); // Rewrite with only the live entries. Caller holds mutex
+};
+
+#endif // METADATA_INDEX_HPP
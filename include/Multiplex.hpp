@@ -0,0 +1,92 @@
+#ifndef MULTIPLEX_HPP
+#define MULTIPLEX_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+// Protocol v2 framing. After a MULTIPLEX command is acknowledged, every message on
+// the connection is a frame tagged with a stream ID, so many GET_FILE and PUT_FILE
+// transfers can run over one connection at the same time. Each stream has its own
+// credit window so a large transfer can't starve the others.
+namespace Multiplex {
+
+    constexpr uint8_t VERSION = 2;
+    constexpr size_t FRAME_HEADER_SIZE = 12;
+    constexpr uint32_t MAX_FRAME_PAYLOAD = 16 * 1024;
+    constexpr uint32_t INITIAL_WINDOW = 256 * 1024;
+
+    enum class FrameType : uint8_t {
+        OPEN   = 1, // Client opens a stream, payload is a v1 command message
+        REPLY  = 2, // Payload is a 1-byte ReplyStatus
+        DATA   = 3, // Stream data (FileHeader followed by file contents)
+        END    = 4, // Sender has no more data for this stream
+        WINDOW = 5, // Payload is a uint32 credit increment for the stream
+        RESET  = 6  // Abort the stream
+    };
+
+    struct FrameHeader {
+        uint8_t version = VERSION;
+        FrameType type;
+        uint16_t flags = 0;
+        uint32_t stream_id;
+        uint32_t length;
+
+        static bool parse(const char* data, FrameHeader& out);
+        void serialize(char* dest) const;
+    };
+
+    // A multiplexed connection. Frames are read by a single reader thread, while any
+    // thread may write frames. Stream data sent through sendData() is limited by the
+    // credit the peer has granted for that stream.
+    class Connection {
+    public:
+        explicit Connection(int socket_fd);
+
+        // Bytes received before the upgrade that belong to the framed stream
+        void prime(const char* data, size_t length);
+
+        // Blocking read of the next frame, only called from the reader thread
+        bool readFrame(FrameHeader& header, std::vector<char>& payload);
+
+        bool writeFrame(FrameType type, uint32_t stream_id, const char* data = nullptr, size_t length = 0);
+        bool sendData(uint32_t stream_id, const char* data, size_t length);
+        bool sendReply(uint32_t stream_id, uint8_t status);
+
+        // Account for data consumed by the receiving side, returns credit to the
+        // peer in batches
+        bool consumed(uint32_t stream_id, size_t length);
+
+        // Send credit management
+        void openStream(uint32_t stream_id);
+        void addCredit(uint32_t stream_id, uint32_t increment);
+        void closeStream(uint32_t stream_id);
+
+        // Wake every thread blocked on credit, used when the connection is going away
+        void shutdown();
+        bool isClosed();
+
+        int fd() const { return socket_fd; }
+
+    private:
+        int socket_fd;
+
+        std::mutex write_mutex;
+
+        std::vector<char> read_buffer;
+        size_t read_offset = 0;
+
+        std::mutex credit_mutex;
+        std::condition_variable credit_cv;
+        std::map<uint32_t, uint64_t> send_credit;
+        std::map<uint32_t, uint64_t> unacked;  // Consumed bytes not yet returned as credit
+        bool closed = false;
+
+        bool fill(size_t needed);
+    };
+
+} // namespace Multiplex
+
+#endif // MULTIPLEX_HPP
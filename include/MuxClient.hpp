@@ -0,0 +1,100 @@
+#ifndef MUX_CLIENT_HPP
+#define MUX_CLIENT_HPP
+
+#include "Multiplex.hpp"
+#include "Protocol.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// Client side of a protocol v2 connection. Any number of GETs and PUTs can be
+// started at once; each runs on its own stream and is collected with wait(), or
+// handed to a completion callback when one is given.
+class MuxClient {
+public:
+    using StreamID = uint32_t;
+
+    struct Result {
+        Protocol::ReplyStatus status = Protocol::ReplyStatus::ERROR;
+        uint64_t bytes = 0;
+        std::vector<char> data; // Listing returned by an ENUMERATE stream
+    };
+
+    // Runs on the client's dispatch thread, never with internal locks held, so it
+    // may start further streams. A stream with a callback can't be wait()ed on.
+    using Callback = std::function<void(Result)>;
+
+    // Send the MULTIPLEX command on a v1 connection and wait for the server to accept it
+    static bool upgrade(int socket_fd);
+
+    explicit MuxClient(int socket_fd);
+    ~MuxClient();
+
+    StreamID startGet(const std::string& remote_name, const std::string& local_path, Callback on_done = {});
+    StreamID startPut(const std::string& local_path, const std::string& remote_name, Callback on_done = {});
+    StreamID startList(const std::string& remote_dir, Callback on_done = {});
+
+    // Block until the stream finishes
+    Result wait(StreamID stream_id);
+
+    // Streams started and not yet collected
+    size_t pending();
+    bool isClosed() { return conn.isClosed(); }
+
+private:
+    enum class Kind { GET, PUT, LIST };
+
+    struct Stream {
+        StreamID id;
+        Kind kind;
+        std::string local_path;
+        std::string remote_name;
+        int file_fd = -1;
+        bool acked = false;
+
+        // Download state, LIST collects everything in header_buffer
+        std::vector<char> header_buffer;
+        bool header_done = false;
+        Protocol::FileHeader header{};
+        uint64_t received = 0;
+
+        bool done = false;
+        Result result;
+        Callback on_done;
+    };
+
+    Multiplex::Connection conn;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::map<StreamID, Stream> streams;
+    StreamID next_stream = 1;
+    size_t active_uploads = 0;
+    std::thread reader;
+
+    // Finished streams with callbacks, delivered by the dispatcher thread
+    std::deque<StreamID> completed;
+    std::thread dispatcher;
+    bool stopping = false;
+
+    StreamID open(Kind kind, Protocol::CommandID command, const std::string& local_path,
+                  const std::string& remote_name, int file_fd, Callback on_done);
+    void readLoop();
+    void dispatchLoop();
+    void handleReply(StreamID stream_id, Protocol::ReplyStatus status);
+    void handleData(StreamID stream_id, const std::vector<char>& payload);
+    void handleEnd(StreamID stream_id);
+    void upload(StreamID stream_id);
+
+    // Mark a stream finished, caller holds mutex
+    void finish(Stream& stream, Protocol::ReplyStatus status);
+};
+
+#endif // MUX_CLIENT_HPP
@@ -0,0 +1,81 @@
+#ifndef MUX_SERVER_SESSION_HPP
+#define MUX_SERVER_SESSION_HPP
+
+#include "MetadataIndex.hpp"
+#include "Multiplex.hpp"
+#include "Protocol.hpp"
+#include "TransferScheduler.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+
+// Server side of a protocol v2 connection. The connection thread reads frames and
+// writes uploads to disk, while GET_FILE and ENUMERATE streams are sent by a small
+// pool of workers so a large download doesn't hold up the others. Streams beyond
+// the pool wait their turn, and a session can only have so many streams open.
+class MuxServerSession {
+public:
+    MuxServerSession(int client_fd, TransferScheduler& scheduler, TransferScheduler::FlowID flow,
+                     MetadataIndex& metadata);
+
+    // Serve streams until the client disconnects. pending holds bytes already
+    // received after the MULTIPLEX command.
+    void run(const std::vector<char>& pending);
+
+private:
+    static constexpr size_t MAX_WORKERS = 8;        // Downloads and listings sent at once
+    static constexpr size_t MAX_STREAMS = 1024;     // Open streams, queued ones and uploads included
+
+    struct Job {
+        uint32_t stream_id;
+        Protocol::CommandID command;
+        std::string path;
+    };
+
+    struct Upload {
+        std::string file_name;
+        std::vector<char> header_buffer;
+        bool header_done = false;
+        Protocol::FileHeader header{};
+        int file_fd = -1;
+        uint64_t received = 0;
+    };
+
+    Multiplex::Connection conn;
+    TransferScheduler& scheduler;
+    TransferScheduler::FlowID flow;
+    MetadataIndex& metadata;
+
+    std::map<uint32_t, Upload> uploads;
+
+    std::mutex worker_mutex;
+    std::condition_variable worker_cv;
+    size_t active_workers = 0;
+    std::deque<Job> jobs;               // Streams waiting for a worker
+    std::set<uint32_t> streams;         // Every open stream, to refuse a reused ID
+    std::set<uint32_t> cancelled;
+
+    void handleOpen(uint32_t stream_id, const std::vector<char>& payload);
+    void handleData(uint32_t stream_id, const std::vector<char>& payload);
+    void handleEnd(uint32_t stream_id);
+    void handleReset(uint32_t stream_id);
+
+    // Worker thread, runs queued jobs until there are none left
+    void work();
+    void sendFile(uint32_t stream_id, const std::string& file_name);
+    void sendListing(uint32_t stream_id, const std::string& dir);
+    bool isCancelled(uint32_t stream_id);
+
+    // Take a stream ID into use, false if it is already open or too many are
+    bool addStream(uint32_t stream_id);
+    void removeStream(uint32_t stream_id);
+};
+
+#endif // MUX_SERVER_SESSION_HPP
@@ -1,6 +1,7 @@
 #ifndef NETWORK_UTILS_HPP
 #define NETWORK_UTILS_HPP
 
+#include <cstdint>
 #include <string>
 
 /**
@@ -51,6 +52,20 @@ public:
      */
     static bool sendData(int fd, const std::string& data);
 
+    /**
+     * Send part of a file to socket
+     * 
+     * Uses sendfile() where available so the data goes from the page
+     * cache to the socket without a copy through user space.
+     * 
+     * @param fd Socket file descriptor
+     * @param file_fd File to read from, its file offset is left unchanged
+     * @param offset Position of the first byte in the file
+     * @param length Number of bytes to send
+     * @return true on success, false on failure (including a short file)
+     */
+    static bool sendFile(int fd, int file_fd, uint64_t offset, uint64_t length);
+
     /**
      * Receive up to max_length bytes from socket
      * 
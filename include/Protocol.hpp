@@ -1,7 +1,10 @@
 #ifndef PROTOCOL_HPP
 #define PROTOCOL_HPP
 
+#include <bit>
+#include <concepts>
 #include <cstdint>
+#include <cstring>
 #include <string>
 #include <vector>
 #include <arpa/inet.h>
@@ -13,7 +16,18 @@ namespace Protocol {
         IDENTIFY  = 0,
         GET_FILE  = 1,
         PUT_FILE  = 2,
-        ENUMERATE = 3
+        ENUMERATE = 3,
+        GET_SPARSE = 4,
+        PUT_SPARSE = 5,
+        MULTIPLEX = 6,
+        TUNE      = 7,
+        GET_IF_CHANGED = 8,
+        PUT_IF_CHANGED = 9,
+        COPY      = 10,
+        MOVE      = 11,
+        SUBSCRIBE = 12,
+        OPEN_FILE = 13, // Unix domain socket only, the reply carries the open file
+        SHARED_RING = 14 // Unix domain socket only, moves the connection into shared memory
     };
 
     struct ProxyHeader {
@@ -30,29 +44,146 @@ namespace Protocol {
         static bool parse(const std::vector<char>& buffer, CommandHeader& out);
     };
 
+    // Fixed-size fields following the command header (and path, if any)
+    constexpr size_t IDENTIFY_TAIL_SIZE = 4;    // uint32 probe_bytes
+    constexpr size_t TUNE_SIZE = 20;            // rtt_us, bandwidth, buffer_size, chunk_size
+    constexpr size_t SHARED_RING_TAIL_SIZE = 4; // uint32 ring capacity
+    constexpr size_t FILE_VERSION_SIZE = 24;    // FileVersion, after the path of *_IF_CHANGED
+
     struct FileHeader {
         uint16_t permissions;
         std::string path;
         uint64_t file_size;
 
         static bool parse(const std::vector<char>& buffer, size_t offset, FileHeader& out, size_t& out_next_offset);
+        void serialize(std::vector<char>& out) const;
+    };
+
+    // Identifies one version of a file's contents for conditional transfers
+    struct FileVersion {
+        uint64_t size = 0;
+        uint64_t mtime_ns = 0;  // Modification time, nanoseconds since the epoch
+        uint64_t hash = 0;      // FNV-1a 64 of the contents
+
+        static FileVersion parse(const char* data);
+        void serialize(char* dest) const;
+
+        // Same contents, the modification time is informational
+        bool sameContents(const FileVersion& other) const { return size == other.size && hash == other.hash; }
+    };
+
+    // One regular file in an ENUMERATE listing, path relative to the listed directory
+    struct ListingEntry {
+        uint16_t permissions;
+        std::string path;
+        FileVersion version;
+    };
+
+    struct Listing {
+        std::vector<ListingEntry> entries;
+
+        static bool parse(const std::vector<char>& buffer, size_t offset, Listing& out, size_t& out_next_offset);
+        void serialize(std::vector<char>& out) const;
+    };
+
+    // Pushed to SUBSCRIBE clients, path relative to the server's root
+    enum class ChangeType : uint8_t {
+        CREATED  = 1,
+        MODIFIED = 2,
+        DELETED  = 3,
+        OVERFLOW = 4    // Events were lost, everything under path has to be looked at again
+    };
+
+    struct ChangeEvent {
+        ChangeType type;
+        std::string path;
+    };
+
+    struct ChangeBatch {
+        std::vector<ChangeEvent> events;
+
+        static bool parse(const std::vector<char>& buffer, size_t offset, ChangeBatch& out, size_t& out_next_offset);
+        void serialize(std::vector<char>& out) const;
+    };
+
+    // A range of file data, everything outside the listed extents is a hole
+    struct Extent {
+        uint64_t offset;
+        uint64_t length;
+    };
+
+    constexpr size_t EXTENT_SIZE = 16;
+    constexpr size_t MAX_EXTENTS = 1 << 20;     // Longest map a receiver accepts (16 MB)
+
+    struct ExtentMap {
+        std::vector<Extent> extents;
+
+        static bool parse(const std::vector<char>& buffer, size_t offset, ExtentMap& out, size_t& out_next_offset);
+        void serialize(std::vector<char>& out) const;
+        uint64_t dataSize() const;
     };
 
     enum class ReplyStatus : uint8_t {
         ACK   =   0,
         NACK  =   1,
+        NOT_MODIFIED = 2, // Conditional transfer skipped, both sides have the same contents
         INVALID = 254, //Use for when the user tries to do something invalid, like GET_FILE on a non-existent file
         ERROR = 255
     };
 
     void sendReply(int socket_fd, ReplyStatus status);
 
+    /** reverses the byte order (polyfill for std::byteswap from C++23) */
+    template<typename T> requires std::integral<T>
+    constexpr T byteswap(T value) noexcept {
+        if constexpr (sizeof(T) == 1) {
+            return value;
+        } else if constexpr (sizeof(T) == 2) {
+            return static_cast<T>((value >> 8) | (value << 8));
+        } else if constexpr (sizeof(T) == 4) {
+            value = ((value >> 8) & 0x00FF00FF) | ((value << 8) & 0xFF00FF00);
+            return (value >> 16) | (value << 16);
+        } else if constexpr (sizeof(T) == 8) {
+            value = ((value >> 8) & 0x00FF00FF00FF00FF) | ((value << 8) & 0xFF00FF00FF00FF00);
+            value = ((value >> 16) & 0x0000FFFF0000FFFF) | ((value << 16) & 0xFFFF0000FFFF0000);
+            return (value >> 32) | (value << 32);
+        }
+    }
+
+    /** Convert an integral value between native and little endian */
+    template<typename T> requires std::integral<T>
+    constexpr T le_convert(T value) {
+        if constexpr (std::endian::native == std::endian::little) {
+            return value; // Do nothing on little endian
+        } else {
+            return byteswap(value); // Swap the bytes on big endian
+        }
+    }
+
+    // Little-endian load/store at any alignment. Fields sit at arbitrary offsets in
+    // receive buffers, so they are copied out rather than dereferenced in place;
+    // the memcpy compiles to a single (unaligned) move.
+    template<typename T> requires std::integral<T>
+    inline T load(const char* data) {
+        T raw;
+        std::memcpy(&raw, data, sizeof(T));
+        return le_convert(raw);
+    }
+
+    template<typename T> requires std::integral<T>
+    inline void store(char* dest, T value) {
+        value = le_convert(value);
+        std::memcpy(dest, &value, sizeof(T));
+    }
+
     // Integer Parsing / Writing
-    uint16_t parse_uint16(const char* data);
-    uint64_t parse_uint64(const char* data);
+    inline uint16_t parse_uint16(const char* data) { return load<uint16_t>(data); }
+    inline uint32_t parse_uint32(const char* data) { return load<uint32_t>(data); }
+    inline uint64_t parse_uint64(const char* data) { return load<uint64_t>(data); }
 
-    void write_uint16(char* dest, uint16_t value);
-    void write_uint64(char* dest, uint64_t value);
+    inline void write_uint16(char* dest, uint16_t value) { store(dest, value); }
+    inline void write_uint32(char* dest, uint32_t value) { store(dest, value); }
+    inline void write_uint64(char* dest, uint64_t value) { store(dest, value); }
 
 } // namespace Protocol
 
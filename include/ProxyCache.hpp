@@ -0,0 +1,99 @@
+#ifndef PROXY_CACHE_HPP
+#define PROXY_CACHE_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "Protocol.hpp"
+
+
+// File contents a proxy has fetched from its destinations, kept in files under one
+// directory (and so in the page cache while they are hot) up to a byte budget, the
+// least recently used going first. A cached copy is checked with the server before
+// it is served again, unless it was checked less than `fresh_for` ago; while one
+// request is asking the server about a key, others for the same key wait for its
+// answer instead of asking again.
+class ProxyCache {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Config {
+        std::filesystem::path dir;                  // Holds the cached contents, made if missing
+        uint64_t max_bytes = 1ull << 30;            // Contents kept, least recently used are dropped past this
+        std::chrono::milliseconds fresh_for{0};     // Served without asking the server this long after a check
+    };
+
+    // What the server sent along with new contents
+    struct Origin {
+        Protocol::FileVersion version;
+        Protocol::FileHeader header;
+    };
+
+    // Asks the server about a key given the version held (zeros if none). ACK = new contents were
+    // written to `temp` and described in `origin`, NOT_MODIFIED = the held copy is current
+    using Fetch = std::function<Protocol::ReplyStatus(const Protocol::FileVersion& held,
+                                                      const std::filesystem::path& temp, Origin& origin)>;
+
+    // How a request was answered
+    enum class Source {
+        CACHE,      // Checked recently enough, the server wasn't asked
+        VALIDATED,  // The server confirmed the cached copy
+        FETCHED,    // New contents came from the server
+        SHARED      // Another request for the same key asked the server
+    };
+
+    // A copy ready to send, fd is the caller's to close
+    struct Hit {
+        int fd = -1;
+        Protocol::FileVersion version;
+        Protocol::FileHeader header;
+        Source source = Source::CACHE;
+    };
+
+    explicit ProxyCache(const Config& config);
+    ~ProxyCache();
+
+    ProxyCache(const ProxyCache&) = delete;
+    ProxyCache& operator=(const ProxyCache&) = delete;
+
+    // ACK with hit filled in, otherwise what the server answered (ERROR if it couldn't be asked)
+    Protocol::ReplyStatus get(const std::string& key, const Fetch& fetch, Hit& hit);
+
+    static const char* sourceName(Source source);
+
+private:
+    struct Entry {
+        std::filesystem::path file;
+        Protocol::FileVersion version;
+        Protocol::FileHeader header;
+        Clock::time_point checked;
+        uint64_t last_used = 0;
+    };
+
+    struct Flight {
+        bool done = false;
+        Protocol::ReplyStatus status = Protocol::ReplyStatus::ERROR;
+    };
+
+    Config config;
+    std::mutex mutex;
+    std::condition_variable landed;
+    std::unordered_map<std::string, Entry> entries;
+    std::unordered_map<std::string, std::shared_ptr<Flight>> flights;
+    uint64_t total_bytes = 0;
+    uint64_t use_counter = 0;
+    uint64_t next_file = 0;
+
+    Protocol::ReplyStatus open(Entry& entry, Source source, Hit& hit);
+    void drop(const std::string& key);
+    void evict(const std::string& keep);
+};
+
+#endif // PROXY_CACHE_HPP
@@ -1,15 +1,60 @@
 #ifndef PROXY_SERVER_HPP
 #define PROXY_SERVER_HPP
 
+#include <filesystem>
+#include <memory>
+#include <netinet/in.h>
+#include <string>
+
+#include "BackendPool.hpp"
 #include "BaseServer.hpp"
+#include "CommandParser.hpp"
+#include "ProxyCache.hpp"
+#include "RingBuffer.hpp"
+#include "UpstreamPool.hpp"
 
 
 class ProxyServer : public BaseServer {
 public:
-    using BaseServer::BaseServer; // Inherit constructor
+    // warm_connections: idle connections kept open to each destination seen, 0 = connect per session
+    // cache: when cache.dir is set, GET_FILE / GET_IF_CHANGED are answered from a shared cache
+    // backends: when any are listed, sessions go to one of them instead of the client's destination
+    explicit ProxyServer(int port, size_t warm_connections = 0, const ProxyCache::Config& cache = {},
+                         const BackendPool::Config& backends = {});
 
 protected:
     void handleRequest(int client_fd) override;
+
+private:
+    // A connection for one session or fetch, to the destination or a backend picked for it
+    struct Upstream {
+        int fd = -1;
+        sockaddr_in addr{};
+        int backend = -1;
+        bool warm = false;
+    };
+
+    UpstreamPool upstreams;
+    std::unique_ptr<ProxyCache> cache;
+    std::unique_ptr<BackendPool> backends;
+
+    Upstream connectUpstream(const sockaddr_in& dest, const std::string& path);
+    void finishUpstream(const Upstream& upstream, bool healthy);
+
+    // Plain relay to the destination, starting with anything already read from the client
+    void relay(int client_fd, const sockaddr_in& dest, RingBuffer* buffered = nullptr, const std::string& path = "");
+
+    // Parsed sessions (caching, or backends picked by path): answers what the proxy can itself and
+    // hands the session to a relay at the first other command
+    void serveCommands(int client_fd, const sockaddr_in& dest);
+    bool answersLocally(Protocol::CommandID command) const;
+    static bool peekPath(const RingBuffer& ring, std::string& path);
+    bool answer(int client_fd, const sockaddr_in& dest, const CommandParser::Command& command);
+    bool answerIdentify(int client_fd, const CommandParser::Command& command);
+    bool answerTune(int client_fd, const std::string& body);
+    bool answerGet(int client_fd, const sockaddr_in& dest, const std::string& path, const Protocol::FileVersion* known);
+    Protocol::ReplyStatus fetch(const sockaddr_in& dest, const std::string& path, const Protocol::FileVersion& held,
+                                const std::filesystem::path& temp, ProxyCache::Origin& origin);
 };
 
-#endif // PROXY_SERVER_HPP
\ No newline at end of file
+#endif // PROXY_SERVER_HPP
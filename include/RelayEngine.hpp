@@ -0,0 +1,46 @@
+#ifndef RELAY_ENGINE_HPP
+#define RELAY_ENGINE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "SocketRelay.hpp"
+
+
+// Runs socket relays on a few event loop threads (epoll on Linux, poll elsewhere)
+// instead of one blocked thread per connection. Each loop only waits for what a
+// relay can act on: readability while a Direction is empty, writability while it
+// holds data, so a slow side pushes back on a fast one. A relay owns both sockets
+// from add() on and closes them once both directions have finished or either side
+// fails.
+class RelayEngine {
+public:
+    using Finished = std::function<void(bool ok, const SocketRelay::Stats& stats)>;
+
+    explicit RelayEngine(size_t threads);
+    ~RelayEngine();
+
+    RelayEngine(const RelayEngine&) = delete;
+    RelayEngine& operator=(const RelayEngine&) = delete;
+
+    // Engine shared by the proxies, one loop per core up to four
+    static RelayEngine& shared();
+
+    // Hand both sockets over, on_finished runs on a loop thread after they are closed
+    void add(int a_fd, int b_fd, Finished on_finished = {});
+
+    size_t active() const { return active_relays; }
+
+private:
+    struct Relay;
+    class Loop;
+
+    std::vector<std::unique_ptr<Loop>> loops;
+    std::atomic<size_t> next_loop{0};
+    std::atomic<size_t> active_relays{0};
+};
+
+#endif // RELAY_ENGINE_HPP
@@ -0,0 +1,42 @@
+#ifndef RING_BUFFER_HPP
+#define RING_BUFFER_HPP
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+
+// Fixed-capacity byte ring. Data is received directly into writable() and parsed
+// in place through readable(), so nothing is ever shifted to the front.
+class RingBuffer {
+public:
+    explicit RingBuffer(size_t capacity); // Rounded up to a power of two
+
+    size_t size() const { return tail - head; }
+    size_t capacity() const { return storage.size(); }
+    size_t space() const { return capacity() - size(); }
+    bool empty() const { return head == tail; }
+    bool full() const { return size() == capacity(); }
+
+    // Contiguous free space after the last byte, fill it and then commit()
+    std::span<char> writable();
+    void commit(size_t n);
+
+    // Contiguous data from the first byte, use it and then consume()
+    std::span<const char> readable() const;
+    void consume(size_t n);
+    void clear() { head = tail = 0; }
+
+    // Copy bytes out (peek leaves them in the ring) or in, across the wrap point
+    size_t peek(char* dest, size_t n) const;
+    size_t read(char* dest, size_t n);
+    size_t write(const char* src, size_t n);
+
+private:
+    std::vector<char> storage;
+    size_t mask;
+    size_t head = 0; // Total bytes consumed
+    size_t tail = 0; // Total bytes committed
+};
+
+#endif // RING_BUFFER_HPP
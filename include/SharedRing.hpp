@@ -0,0 +1,87 @@
+#ifndef SHARED_RING_HPP
+#define SHARED_RING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+
+// Shared-memory transport for a client on the same host as the server. Both sides
+// map one memfd holding two single-producer single-consumer byte rings, one per
+// direction, and exchange ordinary protocol messages through them. Data is copied
+// once into the ring and read in place by the other side; no system call is made
+// while a ring has data or space. A side only sleeps (on its eventfd) when it has to
+// wait, and the other side wakes it only then. Linux only, create() and attach()
+// fail elsewhere.
+class SharedRing {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 4 * 1024 * 1024;
+    static constexpr size_t MIN_CAPACITY = 64 * 1024;
+    static constexpr size_t MAX_CAPACITY = 64 * 1024 * 1024;
+
+    // One direction. Positions count bytes ever written / read, so the ring is
+    // empty when they are equal and full when they are capacity apart. The peer
+    // can write anything here, so each side keeps the capacity and its own
+    // position privately and only takes the peer's position, bounded, from it.
+    struct Control {
+        alignas(64) std::atomic<uint64_t> head; // Producer's write position
+        alignas(64) std::atomic<uint64_t> tail; // Consumer's read position
+        alignas(64) std::atomic<uint32_t> consumer_waiting;
+        std::atomic<uint32_t> producer_waiting;
+        uint64_t capacity;
+    };
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "Ring positions must be lock free to be shared");
+
+    SharedRing() = default;
+    ~SharedRing();
+    SharedRing(const SharedRing&) = delete;
+    SharedRing& operator=(const SharedRing&) = delete;
+
+    // Server: a new memfd with both rings, and an eventfd for each side to sleep on
+    bool create(size_t capacity, int socket_fd);
+    // Client: map what the server created. Takes ownership of the descriptors.
+    bool attach(int memory_fd, int server_event, int client_event, int socket_fd);
+
+    // Descriptors to pass to the client: memfd, server eventfd, client eventfd
+    int memoryFd() const { return memory_fd; }
+    int serverEvent() const { return server_event; }
+    int clientEvent() const { return client_event; }
+
+    // Contiguous space to produce into / bytes to consume, blocking until there is
+    // some. Empty once the peer has gone away (its end of socket_fd closed).
+    std::span<char> writable();
+    void commit(size_t length);
+    std::span<const char> readable();
+    void consume(size_t length);
+
+    // Copying helpers, all or nothing
+    bool write(const char* data, size_t length);
+    bool read(char* data, size_t length);
+
+private:
+    // Direction this side produces into, and the one it consumes from
+    Control* out = nullptr;
+    Control* in = nullptr;
+    char* out_data = nullptr;
+    char* in_data = nullptr;
+    uint64_t capacity = 0;  // Checked once when mapped, never read back from shared memory
+    uint64_t produced = 0;  // Our head in out
+    uint64_t consumed = 0;  // Our tail in in
+
+    void* mapping = nullptr;
+    size_t mapping_size = 0;
+    int memory_fd = -1;
+    int server_event = -1;
+    int client_event = -1;
+    int own_event = -1;  // Slept on
+    int peer_event = -1; // Signalled
+    int socket_fd = -1;  // Watched for the peer going away
+    bool closed = false;
+
+    bool map(size_t capacity, bool server);
+    bool sleep();
+    void wake();
+};
+
+#endif // SHARED_RING_HPP
@@ -0,0 +1,51 @@
+#ifndef SHARED_RING_SESSION_HPP
+#define SHARED_RING_SESSION_HPP
+
+#include "Protocol.hpp"
+#include "SharedRing.hpp"
+
+#include <memory>
+#include <string>
+
+
+// Server side of a shared-memory connection, set up by a SHARED_RING command on a
+// Unix domain socket. From then on command messages arrive through the ring and
+// replies go back through it. GET_FILE and PUT_FILE are served with the same
+// messages as over TCP; file data is read from disk straight into the ring.
+class SharedRingSession {
+public:
+    explicit SharedRingSession(std::unique_ptr<SharedRing> ring);
+
+    // Serve commands until the client disconnects
+    void run();
+
+private:
+    std::unique_ptr<SharedRing> ring;
+
+    bool handleGet(const std::string& file_name);
+    bool handlePut(const std::string& file_name);
+    bool sendReply(Protocol::ReplyStatus status);
+};
+
+
+// Client side of a shared-memory connection
+class SharedRingClient {
+public:
+    // Send SHARED_RING on a Unix domain socket connection and map the rings the
+    // server passes back. nullptr if the server or platform can't do it.
+    static std::unique_ptr<SharedRingClient> upgrade(int socket_fd, size_t capacity = SharedRing::DEFAULT_CAPACITY);
+
+    // Download into out_fd, or only count the bytes if out_fd is -1. Returns the
+    // server's final status; bytes holds the amount received.
+    Protocol::ReplyStatus get(const std::string& remote_name, int out_fd, uint64_t& bytes);
+    Protocol::ReplyStatus put(int in_fd, const std::string& remote_name, uint64_t& bytes);
+
+private:
+    std::unique_ptr<SharedRing> ring;
+
+    explicit SharedRingClient(std::unique_ptr<SharedRing> ring);
+    bool sendCommand(Protocol::CommandID command, const std::string& path);
+    Protocol::ReplyStatus receiveReply();
+};
+
+#endif // SHARED_RING_SESSION_HPP
@@ -0,0 +1,77 @@
+#ifndef SOCKET_RELAY_HPP
+#define SOCKET_RELAY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <sys/types.h>
+#include <vector>
+
+// Forwarding between two connected sockets, one Direction per way. On Linux the
+// bytes go socket -> pipe -> socket with splice() and never enter user space;
+// elsewhere, or when splice() refuses the sockets, they are copied through a
+// buffer. Both sockets must be non-blocking; RelayEngine drives the Directions.
+namespace SocketRelay {
+
+    enum class Method { SPLICE, COPY };
+
+    struct Stats {
+        uint64_t a_to_b = 0;
+        uint64_t b_to_a = 0;
+        Method method = Method::COPY;
+    };
+
+    // Pipe or buffer size bounds. A Direction starts small and grows each time a
+    // read fills it, so idle connections stay cheap and bulk transfers move in
+    // large steps.
+    constexpr size_t MIN_BUFFER = 64 * 1024;
+    constexpr size_t MAX_BUFFER = 1024 * 1024;
+
+    // One way of a relay. Bytes read from `from` wait in the pipe (or buffer) until
+    // `to` has taken all of them, only then is `from` read again, so a slow reader
+    // holds back a fast writer instead of growing memory. At end of stream the
+    // write half of `to` is shut down and the Direction is done.
+    class Direction {
+    public:
+        Direction(int from, int to);
+        ~Direction();
+
+        Direction(const Direction&) = delete;
+        Direction& operator=(const Direction&) = delete;
+
+        // poll() events this Direction waits for on fd (POLLIN on from, POLLOUT on to)
+        short events(int fd) const;
+
+        // Move as much as the sockets allow without blocking
+        void pump();
+
+        bool done() const { return finished; }
+        bool failed() const { return error; }
+        uint64_t bytes() const { return total; }
+        Method method() const { return use_copy ? Method::COPY : Method::SPLICE; }
+
+    private:
+        int from;
+        int to;
+        int pipe_fds[2] = {-1, -1};
+        std::vector<char> buffer;
+        size_t capacity = MIN_BUFFER;
+        size_t buffer_offset = 0;
+        size_t pending = 0;
+        uint64_t total = 0;
+        bool eof = false;
+        bool finished = false;
+        bool error = false;
+        bool use_copy = true;
+
+        bool hasPipe() const { return pipe_fds[0] >= 0; }
+        ssize_t readSome();
+        ssize_t writeSome();
+        void grow();
+        void closePipe();
+    };
+
+    const char* methodName(Method method);
+
+} // namespace SocketRelay
+
+#endif // SOCKET_RELAY_HPP
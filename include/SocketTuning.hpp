@@ -0,0 +1,40 @@
+#ifndef SOCKET_TUNING_HPP
+#define SOCKET_TUNING_HPP
+
+#include <cstdint>
+#include <string>
+
+// Socket buffer and chunk size tuning from a measured round trip time and bandwidth.
+// The client measures both during IDENTIFY and sends the result to the server in a
+// TUNE command so both ends of the session use the same parameters.
+namespace SocketTuning {
+
+    struct Parameters {
+        uint32_t rtt_us = 0;        // Round trip time in microseconds
+        uint64_t bandwidth = 0;     // Bytes per second
+        uint32_t buffer_size = 0;   // SO_SNDBUF / SO_RCVBUF
+        uint32_t chunk_size = 0;    // Application read/write size
+
+        uint64_t bdp() const { return bandwidth * rtt_us / 1000000; }
+    };
+
+    // Size the buffers to hold two bandwidth-delay products and the chunks to a
+    // quarter of one, within sane limits
+    Parameters fromMeasurement(uint32_t rtt_us, uint64_t bandwidth);
+
+    // Whether parameters received from a peer stay within the limits fromMeasurement() uses
+    bool withinLimits(const Parameters& params);
+
+    // Raise the socket buffers to the tuned size. Buffers are never shrunk, since
+    // setting them also turns off the kernel's own auto-tuning.
+    bool apply(int socket_fd, const Parameters& params);
+
+    // Smoothed RTT from the kernel (TCP_INFO), 0 if not available
+    uint32_t kernelRtt(int socket_fd);
+
+    // One-line summary including the buffer sizes the kernel actually granted
+    std::string report(int socket_fd, const Parameters& params);
+
+} // namespace SocketTuning
+
+#endif // SOCKET_TUNING_HPP
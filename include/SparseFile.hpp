@@ -0,0 +1,31 @@
+#ifndef SPARSE_FILE_HPP
+#define SPARSE_FILE_HPP
+
+#include "Protocol.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// Helpers for the GET_SPARSE / PUT_SPARSE transfer mode. Only the data extents
+// of a file are sent; the receiver recreates the holes by writing each extent at
+// its offset and truncating the file to its full size.
+namespace SparseFile {
+
+    // Find the data extents of an open file with SEEK_DATA/SEEK_HOLE. Falls back
+    // to a single extent covering the whole file when the filesystem can't report holes.
+    bool mapExtents(int file_fd, uint64_t file_size, std::vector<Protocol::Extent>& out);
+
+    // Send the data of each extent, in order, straight from the file
+    bool sendExtentData(int socket_fd, int file_fd, const Protocol::ExtentMap& map);
+
+    // Receive an ExtentMap followed by its extent data and write it into file_fd.
+    // Bytes already received are taken from pending first; any bytes read past the
+    // end of the transfer are left in pending.
+    bool receive(int socket_fd, int file_fd, uint64_t file_size, std::vector<char>& pending);
+
+    // recv() into pending until it holds at least `needed` bytes
+    bool fill(int socket_fd, std::vector<char>& pending, size_t needed);
+
+} // namespace SparseFile
+
+#endif // SPARSE_FILE_HPP
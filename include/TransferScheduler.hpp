@@ -0,0 +1,82 @@
+#ifndef TRANSFER_SCHEDULER_HPP
+#define TRANSFER_SCHEDULER_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+
+
+// Server-wide scheduler for outgoing file data. Transfers are split into quanta and
+// every quantum has to be acquired before it is read from disk, and released before
+// it is sent, so a client that stops reading only holds up its own transfer. Clients
+// waiting for a quantum are served with deficit round robin, so a small GET only
+// waits for one quantum of each active transfer instead of for the whole transfer.
+class TransferScheduler {
+public:
+    using FlowID = uint64_t;
+
+    struct Config {
+        size_t quantum = 64 * 1024;     // Bytes credited to a flow per round, scaled by its weight
+        uint64_t global_rate = 0;       // Bytes/s across all clients, 0 = unlimited
+        uint64_t client_rate = 0;       // Bytes/s per client, 0 = unlimited
+        size_t max_concurrent = 4;      // Quanta that may be read from disk at the same time
+        std::map<std::string, unsigned> weights; // IDENTIFY client id -> weight
+    };
+
+    explicit TransferScheduler(const Config& config);
+
+    FlowID addClient(unsigned weight = 1);
+    void removeClient(FlowID flow);
+    void setWeight(FlowID flow, unsigned weight);
+    void setWeight(FlowID flow, const std::string& client_id); // Look up weight from Config::weights
+
+    // Largest request a flow should make, its quantum unless a chunk size was set
+    size_t quantumFor(FlowID flow);
+    void setChunkSize(FlowID flow, size_t bytes); // 0 = back to the quantum
+
+    // Block until the flow may send `bytes`, then release() once they are read
+    void acquire(FlowID flow, size_t bytes);
+    void release(FlowID flow);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // Token bucket for the rate caps. Tokens may go negative so a quantum larger
+    // than the burst size is still granted, the debt is paid off before the next one.
+    struct Bucket {
+        uint64_t rate = 0;
+        double tokens = 0;
+        Clock::time_point last = Clock::now();
+
+        void refill(Clock::time_point now);
+        Clock::time_point readyAt() const;
+    };
+
+    struct Flow {
+        unsigned weight = 1;
+        size_t deficit = 0;
+        size_t chunk = 0;       // Request size from TUNE, 0 = quantum
+        size_t pending = 0;     // Bytes requested, 0 when not waiting
+        bool granted = false;
+        Bucket bucket;
+    };
+
+    Config config;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::map<FlowID, Flow> flows;
+    std::deque<FlowID> active;  // Flows with a pending request, in round order
+    Bucket global_bucket;
+    FlowID next_flow = 1;
+    size_t in_flight = 0;
+
+    // Grant as many pending requests as allowed. Returns the time at which a rate
+    // limited request becomes ready, or time_point::max() if nothing is waiting on a rate.
+    Clock::time_point dispatch();
+};
+
+#endif // TRANSFER_SCHEDULER_HPP
@@ -0,0 +1,17 @@
+#ifndef TRANSPORT_BENCH_HPP
+#define TRANSPORT_BENCH_HPP
+
+#include <string>
+
+// Compares GET_FILE throughput of the same-host transports against a running
+// server: TCP loopback, a Unix domain socket, and the shared-memory rings. The
+// received data is counted and dropped, so the figures measure the transport, not
+// the client's disk. The file is fetched once before timing to warm the page cache.
+namespace TransportBench {
+
+    // Returns the process exit code
+    int run(int port, const std::string& socket_path, const std::string& file_name, int rounds);
+
+} // namespace TransportBench
+
+#endif // TRANSPORT_BENCH_HPP
@@ -0,0 +1,75 @@
+#ifndef UPSTREAM_POOL_HPP
+#define UPSTREAM_POOL_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <netinet/in.h>
+#include <thread>
+#include <vector>
+
+
+// Pre-established connections to the destinations a proxy has seen, so a new
+// session can start relaying without waiting a round trip for connect(). Once a
+// destination has been asked for, a background thread keeps `warm` idle
+// connections open to it and checks them while they wait: one the far end has
+// closed or reset is dropped. A destination no one has asked for in
+// `forget_after` is let go.
+class UpstreamPool {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Config {
+        size_t warm = 0;                            // Idle connections kept per destination, 0 = connect on demand
+        std::chrono::seconds max_idle{120};         // Idle connections older than this are replaced
+        std::chrono::seconds forget_after{300};     // Destinations unused this long are dropped
+        std::chrono::seconds retry_after{5};        // Pause after a failed warming connect
+        std::chrono::milliseconds connect_timeout{2000}; // A warming connect not through by then counts as failed
+        size_t max_connecting = 64;                 // Warming connects in flight at once, across all destinations
+    };
+
+    explicit UpstreamPool(const Config& config);
+    ~UpstreamPool();
+
+    UpstreamPool(const UpstreamPool&) = delete;
+    UpstreamPool& operator=(const UpstreamPool&) = delete;
+
+    // A connected socket, warm if one was waiting, otherwise a fresh connect(). -1 on failure
+    int acquire(const sockaddr_in& dest, bool& warm);
+
+    // Give back a connection whose exchange is complete, kept idle if the destination is short of warm ones
+    void release(const sockaddr_in& dest, int fd);
+
+private:
+    struct Idle {
+        int fd;
+        Clock::time_point since;
+    };
+
+    struct Destination {
+        sockaddr_in addr{};
+        std::deque<Idle> idle;
+        size_t connecting = 0;
+        Clock::time_point last_used;
+        Clock::time_point retry_at;
+    };
+
+    Config config;
+    std::map<uint64_t, Destination> destinations;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stopping = false;
+    std::thread maintainer;
+
+    void maintain();
+    static uint64_t key(const sockaddr_in& dest);
+    static int connectTo(const sockaddr_in& dest);
+    static std::vector<int> connectAll(const std::vector<sockaddr_in>& dests, std::chrono::milliseconds timeout);
+    static void keepAlive(int fd);
+    static bool healthy(int fd);
+};
+
+#endif // UPSTREAM_POOL_HPP
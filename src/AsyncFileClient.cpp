@@ -0,0 +1,245 @@
+#include <algorithm>
+#include <arpa/inet.h>
+#include <iostream>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "AsyncFileClient.hpp"
+#include "LocalSocket.hpp"
+#include "NetworkUtils.hpp"
+#include "Protocol.hpp"
+
+
+AsyncFileClient::AsyncFileClient(const std::string& host, int port, size_t pool_size)
+    : server_ip{host}, server_port{port}, pool_size{std::max<size_t>(pool_size, 1)} {}
+
+
+AsyncFileClient::AsyncFileClient(const std::string& dest_ip, int dest_port,
+                                 const std::string& proxy_ip, int proxy_port, size_t pool_size)
+    : server_ip{dest_ip}, server_port{dest_port}, use_proxy{true},
+      proxy_ip{proxy_ip}, proxy_port{proxy_port}, pool_size{std::max<size_t>(pool_size, 1)} {}
+
+
+AsyncFileClient::~AsyncFileClient() {
+    close();
+}
+
+
+bool AsyncFileClient::connect() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!pool.empty()) return true;
+
+    pool.resize(pool_size);
+    size_t connected = 0;
+    for (Connection& connection : pool) {
+        if (open(connection)) connected++;
+    }
+    return connected > 0;
+}
+
+
+void AsyncFileClient::close() {
+    // Tear Down Outside the Lock, the Failed Transfers' Callbacks Need It
+    std::vector<Connection> closing;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closing = std::move(pool);
+        pool.clear();
+        for (Connection& connection : retired) closing.push_back(std::move(connection));
+        retired.clear();
+    }
+    for (Connection& connection : closing) release(connection);
+}
+
+
+std::future<AsyncFileClient::Result> AsyncFileClient::get(const std::string& remote_name, const std::string& local_path) {
+    std::future<Result> future;
+    get(remote_name, local_path, promise(future));
+    return future;
+}
+
+
+void AsyncFileClient::get(const std::string& remote_name, const std::string& local_path, Callback on_done) {
+    submit([&](MuxClient& mux, Callback done) {
+        mux.startGet(remote_name, local_path, std::move(done));
+    }, std::move(on_done));
+}
+
+
+std::future<AsyncFileClient::Result> AsyncFileClient::put(const std::string& local_path, const std::string& remote_name) {
+    std::future<Result> future;
+    put(local_path, remote_name, promise(future));
+    return future;
+}
+
+
+void AsyncFileClient::put(const std::string& local_path, const std::string& remote_name, Callback on_done) {
+    submit([&](MuxClient& mux, Callback done) {
+        mux.startPut(local_path, remote_name, std::move(done));
+    }, std::move(on_done));
+}
+
+
+std::future<AsyncFileClient::Result> AsyncFileClient::list(const std::string& remote_dir) {
+    std::future<Result> future;
+    list(remote_dir, promise(future));
+    return future;
+}
+
+
+void AsyncFileClient::list(const std::string& remote_dir, Callback on_done) {
+    submit([&](MuxClient& mux, Callback done) {
+        mux.startList(remote_dir, std::move(done));
+    }, std::move(on_done));
+}
+
+
+std::vector<std::future<AsyncFileClient::Result>> AsyncFileClient::getAll(const std::vector<Transfer>& transfers) {
+    std::vector<std::future<Result>> futures;
+    futures.reserve(transfers.size());
+    for (const Transfer& transfer : transfers) futures.push_back(get(transfer.remote_name, transfer.local_path));
+    return futures;
+}
+
+
+std::vector<std::future<AsyncFileClient::Result>> AsyncFileClient::putAll(const std::vector<Transfer>& transfers) {
+    std::vector<std::future<Result>> futures;
+    futures.reserve(transfers.size());
+    for (const Transfer& transfer : transfers) futures.push_back(put(transfer.local_path, transfer.remote_name));
+    return futures;
+}
+
+
+void AsyncFileClient::waitAll() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle_cv.wait(lock, [&] { return in_flight == 0; });
+}
+
+
+size_t AsyncFileClient::inFlight() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return in_flight;
+}
+
+
+bool AsyncFileClient::open(Connection& connection) {
+    // Connect Directly, Through the Proxy, or to a Unix Domain Socket
+    int socket_fd;
+    if (LocalSocket::isLocalAddress(server_ip) && !use_proxy) {
+        socket_fd = LocalSocket::connect(LocalSocket::socketPath(server_ip));
+    } else if (use_proxy) {
+        socket_fd = NetworkUtils::connectToHost(proxy_ip, proxy_port);
+    } else {
+        socket_fd = NetworkUtils::connectToHost(server_ip, server_port);
+    }
+    if (socket_fd < 0) return false;
+
+    if (use_proxy) {
+        sockaddr_in dest_addr{};
+        Protocol::ProxyHeader header;
+        bool ok = inet_pton(AF_INET, server_ip.c_str(), &dest_addr.sin_addr) > 0;
+        header.dest_addr = dest_addr.sin_addr;
+        header.dest_port = htons(server_port);
+        if (!ok || send(socket_fd, &header, sizeof(header), 0) != sizeof(header)) {
+            std::cerr << "AsyncFileClient: Failed to send proxy header\n";
+            ::close(socket_fd);
+            return false;
+        }
+    }
+
+    // Every Transfer Runs on a Stream of a Multiplexed Connection
+    if (!MuxClient::upgrade(socket_fd)) {
+        std::cerr << "AsyncFileClient: Server does not support multiplexed transfers\n";
+        ::close(socket_fd);
+        return false;
+    }
+    connection.socket_fd = socket_fd;
+    connection.mux = std::make_unique<MuxClient>(socket_fd);
+    return true;
+}
+
+
+void AsyncFileClient::release(Connection& connection) {
+    connection.mux.reset();
+    if (connection.socket_fd >= 0) ::close(connection.socket_fd);
+    connection.socket_fd = -1;
+}
+
+
+MuxClient* AsyncFileClient::pick() {
+    // Claim Dropped Connections for Replacement, Nobody Else Will Try the Same Ones
+    std::vector<size_t> claimed;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < pool.size(); i++) {
+            Connection& connection = pool[i];
+            if (connection.mux && connection.mux->isClosed()) {
+                retired.push_back(std::move(connection));
+                connection = {};
+            }
+            if (!connection.mux && !connection.connecting) {
+                connection.connecting = true;
+                claimed.push_back(i);
+            }
+        }
+    }
+
+    // Connect Outside the Lock, a Slow Server Only Holds Up This Caller
+    for (size_t i : claimed) {
+        Connection fresh;
+        bool opened = open(fresh);
+        bool kept = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (i < pool.size() && pool[i].connecting) {
+                pool[i] = std::move(fresh); // Clears connecting
+                kept = true;
+            }
+        }
+        if (opened && !kept) release(fresh); // The pool was closed meanwhile
+    }
+
+    // Least Loaded Live Connection
+    std::lock_guard<std::mutex> lock(mutex);
+    MuxClient* best = nullptr;
+    size_t best_load = 0;
+    for (Connection& connection : pool) {
+        if (!connection.mux || connection.mux->isClosed()) continue;
+        size_t load = connection.mux->pending();
+        if (!best || load < best_load) {
+            best = connection.mux.get();
+            best_load = load;
+        }
+    }
+    return best;
+}
+
+
+void AsyncFileClient::submit(const Starter& start, Callback on_done) {
+    // The Transfer Counts as in Flight Until Its Callback Has Returned
+    Callback done = [this, on_done = std::move(on_done)](Result result) {
+        if (on_done) on_done(std::move(result));
+        std::lock_guard<std::mutex> lock(mutex);
+        in_flight--;
+        idle_cv.notify_all();
+    };
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        in_flight++;
+    }
+    MuxClient* mux = pick();
+
+    if (!mux) {
+        done(Result{}); // No connection, fails with ERROR
+        return;
+    }
+    start(*mux, std::move(done));
+}
+
+
+AsyncFileClient::Callback AsyncFileClient::promise(std::future<Result>& future) {
+    auto promise = std::make_shared<std::promise<Result>>();
+    future = promise->get_future();
+    return [promise](Result result) { promise->set_value(std::move(result)); };
+}
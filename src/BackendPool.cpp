@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <arpa/inet.h>
+#include <sstream>
+
+#include "BackendPool.hpp"
+#include "MetadataIndex.hpp"
+
+
+BackendPool::BackendPool(const Config& config)
+    : config{config} {
+    for (const sockaddr_in& addr : config.backends) {
+        Backend backend;
+        backend.addr = addr;
+        backends.push_back(backend);
+    }
+
+    // Each Backend Owns Many Points, So Losing One Spreads Its Paths over All the Others
+    for (int index = 0; index < static_cast<int>(backends.size()); index++) {
+        for (int node = 0; node < VIRTUAL_NODES; node++) {
+            ring.emplace_back(hash(name(index) + "#" + std::to_string(node)), index);
+        }
+    }
+    std::sort(ring.begin(), ring.end());
+}
+
+
+int BackendPool::acquire(const std::string& path, const std::vector<int>& avoid) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Clock::time_point now = Clock::now();
+
+    // Healthy Backends First, Then Any Not Yet Tried Rather Than None at All
+    int index = -1;
+    for (bool allow_down : {false, true}) {
+        index = config.policy == Policy::PATH_HASH ? pickHashed(path, avoid, now, allow_down)
+                                                   : pickLeast(avoid, now, allow_down);
+        if (index >= 0) break;
+    }
+    if (index >= 0) backends[index].outstanding++;
+    return index;
+}
+
+
+void BackendPool::release(int index, bool healthy) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Backend& backend = backends[index];
+    backend.outstanding--;
+
+    if (healthy) {
+        backend.failures = 0;
+    } else if (++backend.failures >= config.max_failures) {
+        backend.down_until = Clock::now() + config.cooldown;
+    }
+}
+
+
+bool BackendPool::usable(int index, const std::vector<int>& avoid, Clock::time_point now, bool allow_down) const {
+    if (std::find(avoid.begin(), avoid.end(), index) != avoid.end()) return false;
+    return allow_down || backends[index].failures < config.max_failures || now >= backends[index].down_until;
+}
+
+
+int BackendPool::pickLeast(const std::vector<int>& avoid, Clock::time_point now, bool allow_down) {
+    // Ties Rotate, So Idle Backends Share the Next Sessions
+    int best = -1;
+    size_t count = backends.size();
+    for (size_t i = 0; i < count; i++) {
+        int index = static_cast<int>((next_tie + i) % count);
+        if (!usable(index, avoid, now, allow_down)) continue;
+        if (best < 0 || backends[index].outstanding < backends[best].outstanding) best = index;
+    }
+    next_tie++;
+    return best;
+}
+
+
+int BackendPool::pickHashed(const std::string& path, const std::vector<int>& avoid, Clock::time_point now,
+                            bool allow_down) const {
+    if (ring.empty()) return -1;
+
+    // First Usable Point Clockwise from the Path's Own
+    auto start = std::lower_bound(ring.begin(), ring.end(), std::make_pair(hash(path), 0));
+    for (size_t i = 0; i < ring.size(); i++) {
+        auto point = start + static_cast<std::ptrdiff_t>(i);
+        if (point >= ring.end()) point -= static_cast<std::ptrdiff_t>(ring.size());
+        if (usable(point->second, avoid, now, allow_down)) return point->second;
+    }
+    return -1;
+}
+
+
+std::string BackendPool::name(int index) const {
+    const sockaddr_in& addr = backends[index].addr;
+    char ip[INET_ADDRSTRLEN] = {};
+    inet_ntop(AF_INET, &addr.sin_addr, ip, sizeof(ip));
+    return std::string(ip) + ":" + std::to_string(ntohs(addr.sin_port));
+}
+
+
+bool BackendPool::parseList(const std::string& list, std::vector<sockaddr_in>& out) {
+    std::vector<sockaddr_in> parsed;
+    std::stringstream entries(list);
+    std::string entry;
+    while (std::getline(entries, entry, ',')) {
+        size_t colon = entry.rfind(':');
+        if (colon == std::string::npos) return false;
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        if (inet_pton(AF_INET, entry.substr(0, colon).c_str(), &addr.sin_addr) != 1) return false;
+        try {
+            int port = std::stoi(entry.substr(colon + 1));
+            if (port <= 0 || port > 65535) return false;
+            addr.sin_port = htons(static_cast<uint16_t>(port));
+        } catch (const std::exception&) {
+            return false;
+        }
+        parsed.push_back(addr);
+    }
+    if (parsed.empty()) return false;
+
+    out.insert(out.end(), parsed.begin(), parsed.end());
+    return true;
+}
+
+
+uint64_t BackendPool::hash(const std::string& text) {
+    // FNV-1a Spreads Similar Short Names Poorly, a Final Mix Evens Out the Ring
+    uint64_t h = MetadataIndex::hash(MetadataIndex::FNV_OFFSET, text.data(), text.size());
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
@@ -4,6 +4,7 @@
 #include <unistd.h>
 
 #include "BaseClient.hpp"
+#include "LocalSocket.hpp"
 #include "Protocol.hpp"
 
 
@@ -23,6 +24,15 @@ BaseClient::~BaseClient() {
 
 
 void BaseClient::start() {
+    // Same-Host Server on a Unix Domain Socket, No Proxy Involved
+    if (LocalSocket::isLocalAddress(server_ip) && !use_proxy) {
+        socket_fd = LocalSocket::connect(LocalSocket::socketPath(server_ip));
+        if (socket_fd < 0) return;
+        std::cout << "Connected to server at " << server_ip << "\n";
+        makeRequest();
+        return;
+    }
+
     // Determine Connection Parameters (Proxy or Direct)
     std::string connect_ip = use_proxy ? proxy_ip : server_ip;
     int connect_port = use_proxy ? proxy_port : server_port;
@@ -1,22 +1,37 @@
 #include <iostream>
 #include <cstring>
 #include <arpa/inet.h>
+#include <poll.h>
 #include <unistd.h>
 #include <pthread.h>
 
 #include "BaseServer.hpp"
+#include "LocalSocket.hpp"
+
+
+namespace {
+    thread_local bool client_released = false;
+}
 
 
 BaseServer::BaseServer(int port)
     : socket_fd{-1}, server_port{port} {}
 
 BaseServer::~BaseServer() {
+    if (local_fd != -1) {
+        close(local_fd);
+        unlink(local_path.c_str());
+    }
     if (socket_fd != -1) {
         close(socket_fd);
         std::cout << "Server shut down.\n";
     }
 }
 
+void BaseServer::listenLocal(const std::string& path) {
+    local_path = path;
+}
+
 bool BaseServer::start() {
     // Create a TCP Socket
     socket_fd = socket(AF_INET, SOCK_STREAM, 0);
@@ -53,14 +68,28 @@ bool BaseServer::start() {
         return false;
     }
 
+    // Optional Unix Domain Socket for Clients on This Host
+    if (!local_path.empty()) {
+        local_fd = LocalSocket::listen(local_path);
+        if (local_fd < 0) {
+            close(socket_fd);
+            return false;
+        }
+    }
+
     // Accept Incoming Connections
     std::cout << "Server listening on port " << server_port << ".\n";
+    if (local_fd != -1) std::cout << "Server listening on " << LocalSocket::PREFIX << local_path << ".\n";
+    pollfd listeners[2] = {{socket_fd, POLLIN, 0}, {local_fd, POLLIN, 0}};
     while (true) {
-        int client_fd = acceptConnection();
+        if (poll(listeners, local_fd != -1 ? 2 : 1, -1) < 0) continue;
+        int listen_fd = (listeners[0].revents & POLLIN) ? socket_fd : local_fd;
+
+        int client_fd = acceptConnection(listen_fd);
         if (client_fd < 0) {
             continue; // Accept failed, try again
         }
-        std::cout << "Client connected.\n";
+        std::cout << "Client connected" << (listen_fd == local_fd ? " (local)" : "") << ".\n";
 
         // Create a New Thread for Each Client
         auto* args = new std::pair<BaseServer*, int>(this, client_fd);
@@ -78,13 +107,13 @@ bool BaseServer::start() {
     return true;
 }
 
-int BaseServer::acceptConnection() {
+int BaseServer::acceptConnection(int listen_fd) {
     // Prepare to Accept a Connection
-    sockaddr_in client_addr{};
+    sockaddr_storage client_addr{};
     socklen_t client_len = sizeof(client_addr);
 
     // Accept the Incoming Connection
-    int client_fd = accept(socket_fd, (struct sockaddr*)&client_addr, &client_len);
+    int client_fd = accept(listen_fd, (struct sockaddr*)&client_addr, &client_len);
     if (client_fd < 0) {
         std::cerr << "Error: Failed to accept connection\n";
         return -1;
@@ -104,8 +133,14 @@ void* BaseServer::threadEntry(void* arg) {
     return nullptr;
 }
 
+void BaseServer::releaseClient() {
+    client_released = true;
+}
+
 void BaseServer::threadHandler(int client_fd) {
+    client_released = false;
     handleRequest(client_fd);   // accessible (same class)
+    if (client_released) return; // Owned elsewhere now, the thread is free
     close(client_fd);
     std::cout << "Client disconnected.\n";
 }
\ No newline at end of file
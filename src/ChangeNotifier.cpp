@@ -0,0 +1,283 @@
+#include <fcntl.h>
+#include <iostream>
+#include <poll.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#include "ChangeNotifier.hpp"
+#include "MetadataIndex.hpp"
+
+
+ChangeNotifier::Subscription::Subscription(std::string prefix)
+    : prefix{std::move(prefix)} {
+    while (!this->prefix.empty() && this->prefix.back() == '/') this->prefix.pop_back();
+    if (this->prefix == ".") this->prefix.clear();
+
+    if (pipe(pipe_fds) == 0) {
+        fcntl(pipe_fds[0], F_SETFL, O_NONBLOCK);
+        fcntl(pipe_fds[1], F_SETFL, O_NONBLOCK);
+    }
+}
+
+
+ChangeNotifier::Subscription::~Subscription() {
+    for (int fd : pipe_fds) {
+        if (fd >= 0) close(fd);
+    }
+}
+
+
+std::vector<Protocol::ChangeEvent> ChangeNotifier::Subscription::take() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Drain the Wakeup Byte
+    char drain[64];
+    while (read(pipe_fds[0], drain, sizeof(drain)) > 0) {}
+
+    // Coalesced-Away Events Are Left with an Empty Path
+    std::vector<Protocol::ChangeEvent> events;
+    for (Protocol::ChangeEvent& event : pending) {
+        if (!event.path.empty()) events.push_back(std::move(event));
+    }
+    pending.clear();
+    pending_index.clear();
+    return events;
+}
+
+
+bool ChangeNotifier::Subscription::matches(const std::string& path) const {
+    if (prefix.empty()) return true;
+    return path.compare(0, prefix.size(), prefix) == 0
+        && (path.size() == prefix.size() || path[prefix.size()] == '/');
+}
+
+
+void ChangeNotifier::Subscription::push(Protocol::ChangeType type, const std::string& path) {
+    using Protocol::ChangeType;
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Wake the Session When the First Event Arrives
+    if (pending.empty()) {
+        char wake = 1;
+        [[maybe_unused]] ssize_t n = write(pipe_fds[1], &wake, 1);
+    }
+
+    auto it = pending_index.find(path);
+    if (it == pending_index.end()) {
+        pending_index[path] = pending.size();
+        pending.push_back({type, path});
+        return;
+    }
+
+    // Fold the New Event into the One Still Waiting
+    Protocol::ChangeEvent& waiting = pending[it->second];
+    if (waiting.type == ChangeType::CREATED && type == ChangeType::DELETED) {
+        waiting.path.clear(); // Came and went, nothing to report
+        pending_index.erase(it);
+    } else if (waiting.type == ChangeType::CREATED) {
+        // Still new
+    } else if (type == ChangeType::DELETED) {
+        waiting.type = ChangeType::DELETED;
+    } else {
+        waiting.type = ChangeType::MODIFIED; // Modified twice, or deleted and created again
+    }
+}
+
+
+void ChangeNotifier::Subscription::overflow() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (pending.empty()) {
+        char wake = 1;
+        [[maybe_unused]] ssize_t n = write(pipe_fds[1], &wake, 1);
+    }
+
+    // Whatever Was Waiting Is Incomplete, the Subscriber Has to Look Again
+    pending.clear();
+    pending_index.clear();
+    pending.push_back({Protocol::ChangeType::OVERFLOW, prefix.empty() ? "." : prefix});
+}
+
+
+ChangeNotifier::ChangeNotifier(std::filesystem::path root)
+    : root{std::move(root)} {}
+
+
+ChangeNotifier::~ChangeNotifier() {
+    if (!started) return;
+
+    // Wake the Watcher and Wait for It
+    char stop = 1;
+    [[maybe_unused]] ssize_t n = write(stop_fds[1], &stop, 1);
+    if (watcher.joinable()) watcher.join();
+
+    close(inotify_fd);
+    close(stop_fds[0]);
+    close(stop_fds[1]);
+}
+
+
+std::shared_ptr<ChangeNotifier::Subscription> ChangeNotifier::subscribe(const std::string& prefix) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!started && !start()) return nullptr;
+
+    auto subscription = std::make_shared<Subscription>(prefix);
+    if (subscription->fd() < 0) return nullptr;
+    subscriptions.push_back(subscription);
+    return subscription;
+}
+
+
+void ChangeNotifier::unsubscribe(const std::shared_ptr<Subscription>& subscription) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::erase(subscriptions, subscription);
+}
+
+
+bool ChangeNotifier::start() {
+#ifdef __linux__
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0) {
+        std::cerr << "ChangeNotifier: Failed to initialize inotify\n";
+        return false;
+    }
+    if (pipe(stop_fds) != 0) {
+        close(inotify_fd);
+        return false;
+    }
+
+    watchTree("", false);
+    watcher = std::thread(&ChangeNotifier::watchLoop, this);
+    started = true;
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+void ChangeNotifier::watchTree(const std::string& dir, bool report_files) {
+#ifdef __linux__
+    constexpr uint32_t MASK = IN_CREATE | IN_CLOSE_WRITE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+    std::filesystem::path path = dir.empty() ? root : root / dir;
+    int wd = inotify_add_watch(inotify_fd, path.c_str(), MASK);
+    if (wd < 0) {
+        std::cerr << "ChangeNotifier: Failed to watch " << path << "\n";
+        return;
+    }
+    watches[wd] = dir;
+
+    // Subdirectories Need Watches of Their Own. Files in a Directory That Just
+    // Appeared May Have Been Written Before Its Watch Existed, so Report Them.
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(path, error)) {
+        std::string child = dir.empty() ? entry.path().filename().string() : dir + "/" + entry.path().filename().string();
+        std::error_code entry_error;
+        if (entry.is_directory(entry_error) && !entry.is_symlink(entry_error)) {
+            watchTree(child, report_files);
+        } else if (report_files && entry.is_regular_file(entry_error)) {
+            publish(Protocol::ChangeType::CREATED, child);
+        }
+    }
+#endif
+}
+
+
+void ChangeNotifier::watchLoop() {
+#ifdef __linux__
+    alignas(inotify_event) char buffer[64 * 1024];
+    pollfd fds[2] = {{inotify_fd, POLLIN, 0}, {stop_fds[0], POLLIN, 0}};
+
+    while (true) {
+        if (poll(fds, 2, -1) < 0) continue;
+        if (fds[1].revents != 0) return;
+
+        ssize_t length = read(inotify_fd, buffer, sizeof(buffer));
+        if (length <= 0) continue;
+
+        for (ssize_t offset = 0; offset < length;) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            offset += sizeof(inotify_event) + event->len;
+
+            // The Kernel Queue Overflowed, Events Are Missing for Everyone
+            if (event->mask & IN_Q_OVERFLOW) {
+                std::cerr << "ChangeNotifier: Event queue overflowed, subscribers must resync\n";
+                publishOverflow();
+                continue;
+            }
+
+            auto watch = watches.find(event->wd);
+            if (watch == watches.end()) continue;
+            if (event->mask & IN_IGNORED) {
+                watches.erase(watch); // Directory is gone
+                continue;
+            }
+            if (event->len == 0) continue;
+
+            std::string name = event->name;
+            if (name.starts_with(MetadataIndex::DEFAULT_NAME)) continue;
+            std::string path = watch->second.empty() ? name : watch->second + "/" + name;
+
+            // New Directories Get Watched, Renamed Ones Keep Their Watches Under the New Path, Files Are Reported
+            if (event->mask & IN_ISDIR) {
+                if (event->mask & IN_MOVED_FROM) {
+                    moved_dirs[event->cookie] = path;
+                    publish(Protocol::ChangeType::DELETED, path);
+                } else if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    auto moved = moved_dirs.find(event->cookie);
+                    if ((event->mask & IN_MOVED_TO) && moved != moved_dirs.end()) {
+                        moveWatches(moved->second, path);
+                        moved_dirs.erase(moved);
+                    }
+                    watchTree(path, true);
+                }
+            } else if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                publish(Protocol::ChangeType::CREATED, path);
+            } else if (event->mask & IN_CLOSE_WRITE) {
+                publish(Protocol::ChangeType::MODIFIED, path);
+            } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                publish(Protocol::ChangeType::DELETED, path);
+            }
+        }
+
+        // Directories Moved Out of the Tree Aren't Ours to Watch Anymore
+        for (const auto& [cookie, dir] : moved_dirs) moveWatches(dir, "");
+        moved_dirs.clear();
+    }
+#endif
+}
+
+
+void ChangeNotifier::moveWatches(const std::string& from, const std::string& to) {
+#ifdef __linux__
+    for (auto it = watches.begin(); it != watches.end();) {
+        const std::string& dir = it->second;
+        bool below = dir.compare(0, from.size(), from) == 0 && (dir.size() == from.size() || dir[from.size()] == '/');
+        if (!below) {
+            ++it;
+        } else if (to.empty()) {
+            inotify_rm_watch(inotify_fd, it->first);
+            it = watches.erase(it);
+        } else {
+            it->second = to + dir.substr(from.size());
+            ++it;
+        }
+    }
+#endif
+}
+
+
+void ChangeNotifier::publishOverflow() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& subscription : subscriptions) subscription->overflow();
+}
+
+
+void ChangeNotifier::publish(Protocol::ChangeType type, const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& subscription : subscriptions) {
+        if (subscription->matches(path)) subscription->push(type, path);
+    }
+}
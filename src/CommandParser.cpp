@@ -0,0 +1,171 @@
+#include <algorithm>
+
+#include "CommandParser.hpp"
+
+
+bool CommandParser::parseCommand(RingBuffer& ring, Command& out) {
+    while (true) {
+        switch (command_state) {
+            case State::HEADER: {
+                // Command Header
+                if (ring.size() < Protocol::COMMAND_HEADER_SIZE) return false;
+                char header[Protocol::COMMAND_HEADER_SIZE];
+                ring.read(header, sizeof(header));
+                command.header.command_id = static_cast<Protocol::CommandID>(static_cast<uint8_t>(header[0]));
+                std::copy(header + 1, header + 4, command.header.reserved);
+                command.path.clear();
+                command.target.clear();
+                command.tail.clear();
+                command_state = hasBody(command.header.command_id) ? State::LENGTH : State::TAIL;
+                break;
+            }
+
+            case State::LENGTH: {
+                // Path / Client ID Length
+                if (ring.size() < 2) return false;
+                char length[2];
+                ring.read(length, sizeof(length));
+                command_string_left = Protocol::parse_uint16(length);
+                command.path.reserve(command_string_left);
+                command_state = State::STRING;
+                break;
+            }
+
+            case State::STRING:
+                // Path / Client ID, Taken as It Arrives
+                if (!takeString(ring, command_string_left, command.path)) return false;
+                command_state = hasTarget(command.header.command_id) ? State::TARGET_LENGTH : State::TAIL;
+                break;
+
+            case State::TARGET_LENGTH: {
+                // Destination Path Length
+                if (ring.size() < 2) return false;
+                char length[2];
+                ring.read(length, sizeof(length));
+                command_string_left = Protocol::parse_uint16(length);
+                command.target.reserve(command_string_left);
+                command_state = State::TARGET;
+                break;
+            }
+
+            case State::TARGET:
+                // Destination Path, Taken as It Arrives
+                if (!takeString(ring, command_string_left, command.target)) return false;
+                command_state = State::TAIL;
+                break;
+
+            case State::TAIL: {
+                // Fixed Fields After the Path
+                size_t tail_size = tailSize(command.header.command_id);
+                if (ring.size() < tail_size) return false;
+                command.tail.resize(tail_size);
+                ring.read(command.tail.data(), tail_size);
+
+                // Command Complete
+                out = std::move(command);
+                command = Command{};
+                command_state = State::HEADER;
+                return true;
+            }
+        }
+    }
+}
+
+
+bool CommandParser::parseFileHeader(RingBuffer& ring, Protocol::FileHeader& out) {
+    while (true) {
+        switch (file_state) {
+            case State::HEADER:
+            case State::LENGTH:
+            case State::TARGET_LENGTH:
+            case State::TARGET: {
+                // Permissions and Path Length
+                if (ring.size() < 4) return false;
+                char fixed[4];
+                ring.read(fixed, sizeof(fixed));
+                file_header.permissions = Protocol::parse_uint16(fixed);
+                file_string_left = Protocol::parse_uint16(fixed + 2);
+                file_header.path.clear();
+                file_header.path.reserve(file_string_left);
+                file_state = State::STRING;
+                break;
+            }
+
+            case State::STRING:
+                // Path, Taken as It Arrives
+                if (!takeString(ring, file_string_left, file_header.path)) return false;
+                file_state = State::TAIL;
+                break;
+
+            case State::TAIL: {
+                // File Size
+                if (ring.size() < 8) return false;
+                char size[8];
+                ring.read(size, sizeof(size));
+                file_header.file_size = Protocol::parse_uint64(size);
+
+                out = std::move(file_header);
+                file_header = Protocol::FileHeader{};
+                file_state = State::HEADER;
+                return true;
+            }
+        }
+    }
+}
+
+
+bool CommandParser::hasBody(Protocol::CommandID command) {
+    switch (command) {
+        case Protocol::CommandID::IDENTIFY:
+        case Protocol::CommandID::GET_FILE:
+        case Protocol::CommandID::PUT_FILE:
+        case Protocol::CommandID::ENUMERATE:
+        case Protocol::CommandID::GET_SPARSE:
+        case Protocol::CommandID::PUT_SPARSE:
+        case Protocol::CommandID::GET_IF_CHANGED:
+        case Protocol::CommandID::PUT_IF_CHANGED:
+        case Protocol::CommandID::COPY:
+        case Protocol::CommandID::MOVE:
+        case Protocol::CommandID::SUBSCRIBE:
+        case Protocol::CommandID::OPEN_FILE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+
+bool CommandParser::hasTarget(Protocol::CommandID command) {
+    return command == Protocol::CommandID::COPY || command == Protocol::CommandID::MOVE;
+}
+
+
+size_t CommandParser::tailSize(Protocol::CommandID command) {
+    switch (command) {
+        case Protocol::CommandID::IDENTIFY:
+            return Protocol::IDENTIFY_TAIL_SIZE;
+        case Protocol::CommandID::TUNE:
+            return Protocol::TUNE_SIZE;
+        case Protocol::CommandID::SHARED_RING:
+            return Protocol::SHARED_RING_TAIL_SIZE;
+        case Protocol::CommandID::GET_IF_CHANGED:
+        case Protocol::CommandID::PUT_IF_CHANGED:
+            return Protocol::FILE_VERSION_SIZE;
+        default:
+            return 0;
+    }
+}
+
+
+bool CommandParser::takeString(RingBuffer& ring, uint16_t& left, std::string& out) {
+    while (left > 0) {
+        std::span<const char> span = ring.readable();
+        if (span.empty()) return false;
+
+        size_t n = std::min<size_t>(span.size(), left);
+        out.append(span.data(), n);
+        ring.consume(n);
+        left -= static_cast<uint16_t>(n);
+    }
+    return true;
+}
@@ -1,5 +1,6 @@
 #include "ContentFilter.hpp"
 #include <fstream>
+#include <algorithm>
 #include <cctype>
 #include <iostream>
 
@@ -76,6 +77,89 @@ bool ContentFilter::containsForbiddenContent(const std::string& content,
     return !matches.empty();
 }
 
+// ====================================================================================================
+// Incremental Scanning
+// ====================================================================================================
+
+ContentFilter::Scanner::Scanner(const ContentFilter& filter) : filter(filter) {
+    for (const std::string& word : filter.forbidden_words) {
+        lower_words.push_back(toLower(word));
+        holdback = std::max(holdback, word.size() - 1);
+    }
+}
+
+bool ContentFilter::Scanner::feed(std::string_view data, std::string& release,
+                                  std::vector<std::string>& matches) {
+    matches.clear();
+
+    // Held content goes in front, a word split across pieces is whole again
+    std::string lower_window = toLower(held_content);
+    lower_window += toLower(data);
+
+    for (size_t i = 0; i < lower_words.size(); i++) {
+        if (lower_window.find(lower_words[i]) != std::string::npos) {
+            matches.push_back(filter.forbidden_words[i]);  // Store original casing
+        }
+    }
+    if (!matches.empty()) {
+        return true;
+    }
+
+    held_content += data;
+    held += data;
+
+    // Everything before the content that could still start a word is clean
+    size_t keep = std::min(holdback, held_content.size());
+    while (keep > 0 && !startsWord(std::string_view(lower_window).substr(lower_window.size() - keep))) {
+        keep--;
+    }
+    held_content.erase(0, held_content.size() - keep);
+
+    // Where that content starts in held, stepping back over passed bytes between
+    size_t cut = held.size();
+    size_t needed = keep;
+    for (auto run = passed.rbegin(); run != passed.rend() && needed > 0; ++run) {
+        size_t content_after = cut - (run->first + run->second);
+        if (content_after >= needed) break;
+        needed -= content_after;
+        cut = run->first;
+    }
+    cut -= needed;
+
+    release.append(held, 0, cut);
+    held.erase(0, cut);
+    passed.erase(std::remove_if(passed.begin(), passed.end(), [cut](const auto& run) { return run.first < cut; }),
+                 passed.end());
+    for (auto& run : passed) run.first -= cut;
+    return false;
+}
+
+bool ContentFilter::Scanner::startsWord(std::string_view lower_tail) const {
+    for (const std::string& word : lower_words) {
+        if (word.size() > lower_tail.size() && word.compare(0, lower_tail.size(), lower_tail) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ContentFilter::Scanner::pass(std::string_view data, std::string& release) {
+    // Nothing held back, nothing to wait for
+    if (held.empty()) {
+        release.append(data);
+        return;
+    }
+    passed.emplace_back(held.size(), data.size());
+    held.append(data);
+}
+
+void ContentFilter::Scanner::finish(std::string& release) {
+    release += held;
+    held.clear();
+    held_content.clear();
+    passed.clear();
+}
+
 // ====================================================================================================
 // Private Helper Methods
 // ====================================================================================================
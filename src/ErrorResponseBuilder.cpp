@@ -67,6 +67,24 @@ std::string ErrorResponseBuilder::build400BadRequest(const std::string& reason)
     return buildResponse("HTTP/1.1 400 Bad Request", html);
 }
 
+std::string ErrorResponseBuilder::build504GatewayTimeout(const std::string& reason) {
+    std::string message = "The proxy server could not answer from its cache.";
+    if (!reason.empty()) {
+        message += " Reason: " + htmlEscape(reason);
+    }
+
+    std::string html = buildErrorHTML(
+        504,
+        "504 Gateway Timeout",
+        "Not Cached",
+        message,
+        {},  // No blocked terms
+        "#607d8b"  // Grey color theme
+    );
+
+    return buildResponse("HTTP/1.1 504 Gateway Timeout", html);
+}
+
 // ====================================================================================================
 // Private Helper Methods
 // ====================================================================================================
@@ -1,27 +1,49 @@
 #include <algorithm>
 #include <arpa/inet.h>
+#include <chrono>
+#include <cstdio>
 #include <cstring>
+#include <deque>
+#include <fcntl.h>
 #include <filesystem>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <map>
 #include <sstream>
 #include <netinet/in.h>
 #include <string>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "FileClient.hpp"
+#include "FileCopy.hpp"
+#include "LocalSocket.hpp"
+#include "MessageBuilder.hpp"
+#include "MessageSchema.hpp"
 #include "Protocol.hpp"
+#include "SocketTuning.hpp"
+#include "SparseFile.hpp"
 
 
 FileClient::FileClient(const std::string& server_ip, int server_port)
-    : BaseClient(server_ip, server_port) {}
+    : BaseClient(server_ip, server_port),
+      metadata(std::filesystem::current_path() / MetadataIndex::DEFAULT_NAME) {}
 
     
 FileClient::FileClient(const std::string& dest_ip, int dest_port,
                        const std::string& proxy_ip, int proxy_port)
-    : BaseClient(dest_ip, dest_port, proxy_ip, proxy_port) {}
+    : BaseClient(dest_ip, dest_port, proxy_ip, proxy_port),
+      metadata(std::filesystem::current_path() / MetadataIndex::DEFAULT_NAME) {}
 
 
 void FileClient::makeRequest() {
+    // Identify Ourselves and Tune the Connection Before Anything Else
+    char hostname[256] = "netcopy-client";
+    gethostname(hostname, sizeof(hostname) - 1);
+    identify(hostname);
+    local = LocalSocket::isLocal(socket_fd);
+
     // Main Command-Handling Loop
     std::string input;
     while (true) {
@@ -47,9 +69,53 @@ void FileClient::makeRequest() {
         std::transform(command.begin(), command.end(), command.begin(),
                        [](unsigned char c){ return std::tolower(c); });
 
+        // Remaining Arguments for Multi-File Commands
+        std::vector<std::string> file_names;
+        if (!filename.empty()) file_names.push_back(filename);
+        for (std::string name; iss >> name;) file_names.push_back(name);
+
+        // Once in Shared Memory, Only get/put Are Served
+        if (shared_ring) {
+            if ((command == "get" || command == "put") && !filename.empty()) {
+                ringTransfer(command == "get", filename);
+            } else {
+                std::cout << "Error: Only get/put are available on a shared memory connection.\n";
+            }
+            continue;
+        }
+
+        // Once Multiplexed, Transfers Go Over Streams
+        if (mux && (command == "get" || command == "put")) command = "m" + command;
+
         // Handle User Commands
-        if (command == "identify") {
-            identify();
+        if (command == "mget" || command == "mput") {
+            if (file_names.empty()) {
+                std::cout << "Error: Missing file name.\n";
+            } else if (enableMultiplex()) {
+                if (command == "mget") multiGet(file_names);
+                else multiPut(file_names);
+            }
+        } else if (command == "ls") {
+            listRemote(filename);
+        } else if (command == "sync") {
+            size_t concurrency = 4;
+            try {
+                if (file_names.size() >= 3) concurrency = std::max<size_t>(std::stoul(file_names[2]), 1);
+            } catch (const std::exception&) {
+                std::cout << "Error: Invalid concurrency: " << file_names[2] << "\n";
+                continue;
+            }
+            if (file_names.size() < 2 || (filename != "push" && filename != "pull")) {
+                std::cout << "Usage: sync push|pull <dir> [concurrent transfers]\n";
+            } else {
+                sync(filename, file_names[1], concurrency);
+            }
+        } else if (mux) {
+            std::cout << "Error: Only get/put/ls/sync are available on a multiplexed connection.\n";
+        } else if (command == "ring") {
+            enableSharedRing();
+        } else if (command == "identify") {
+            identify(filename);
         } else if (command == "put") {
             if (filename.empty()) {
                 std::cout << "Error: Missing file name.\n";
@@ -59,42 +125,124 @@ void FileClient::makeRequest() {
         } else if (command == "get") {
             if (filename.empty()) {
                 std::cout << "Error: Missing file name.\n";
+            } else if (local) {
+                getLocalFile(filename);
             } else {
                 getFile(filename);
             }
+        } else if (command == "cget" || command == "cput") {
+            if (filename.empty()) {
+                std::cout << "Error: Missing file name.\n";
+            } else if (command == "cget") {
+                getFile(filename, true);
+            } else {
+                putFile(filename, true);
+            }
+        } else if (command == "watch") {
+            if (watch(filename)) break; // The connection only carried events from here on
+        } else if (command == "cp" || command == "mv") {
+            if (file_names.size() < 2) {
+                std::cout << "Error: Missing source or destination.\n";
+            } else {
+                copyRemote(file_names[0], file_names[1], command == "mv");
+            }
+        } else if (command == "sput") {
+            if (filename.empty()) {
+                std::cout << "Error: Missing file name.\n";
+            } else {
+                putSparse(filename);
+            }
+        } else if (command == "sget") {
+            if (filename.empty()) {
+                std::cout << "Error: Missing file name.\n";
+            } else {
+                getSparse(filename);
+            }
         } else {
             std::cout << "Unknown command.\n";
         }
     }
 }
 
-void FileClient::identify() {
-    // Construct Command Header
-    std::vector<char> header(Protocol::COMMAND_HEADER_SIZE, 0);
+void FileClient::identify(const std::string& client_id) {
+    using Clock = std::chrono::steady_clock;
+    constexpr uint32_t PROBE_BYTES = 1024 * 1024;
 
-    // Serialize Command Header
-    header[0] = static_cast<char>(Protocol::CommandID::IDENTIFY);
+    // Serialize Command Header, Client ID and Requested Probe Size
+    MessageBuilder message;
+    message.append<Protocol::Schema::IdentifyCommand>(Protocol::CommandID::IDENTIFY, client_id, PROBE_BYTES);
 
-    // Send Command Header
-    send(socket_fd, header.data(), header.size(), 0);
-    std::cout << "Sent IDENTIFY\n";
+    // Time the ACK for RTT
+    Clock::time_point sent_at = Clock::now();
+    if (!message.flush(socket_fd) || receiveReply() != Protocol::ReplyStatus::ACK) {
+        std::cerr << PRINT_ERROR << "Server rejected IDENTIFY\n";
+        return;
+    }
+    Clock::time_point acked_at = Clock::now();
+
+    // Time the Probe That Follows It for Bandwidth
+    std::vector<char> temp(64 * 1024);
+    uint32_t received = 0;
+    while (received < PROBE_BYTES) {
+        ssize_t n = recv(socket_fd, temp.data(), std::min<size_t>(temp.size(), PROBE_BYTES - received), 0);
+        if (n <= 0) {
+            std::cerr << PRINT_ERROR << "Failed to receive bandwidth probe\n";
+            return;
+        }
+        received += static_cast<uint32_t>(n);
+    }
+    Clock::time_point probe_done = Clock::now();
+
+    // Prefer the Kernel's RTT Estimate, Ours Includes Server Processing
+    auto micros = [](Clock::duration d) {
+        return std::max<int64_t>(std::chrono::duration_cast<std::chrono::microseconds>(d).count(), 1);
+    };
+    uint32_t rtt_us = static_cast<uint32_t>(micros(acked_at - sent_at));
+    uint32_t kernel_rtt = SocketTuning::kernelRtt(socket_fd);
+    if (kernel_rtt != 0) rtt_us = std::min(rtt_us, kernel_rtt);
+    uint64_t bandwidth = PROBE_BYTES * 1000000ull / micros(probe_done - acked_at);
+
+    // Tune Our End
+    SocketTuning::Parameters params = SocketTuning::fromMeasurement(rtt_us, bandwidth);
+    if (!SocketTuning::apply(socket_fd, params)) {
+        std::cerr << PRINT_ERROR << "Failed to set socket buffer sizes\n";
+    }
+    chunk_size = params.chunk_size;
+
+    // Ask the Server to Tune Its End the Same Way
+    message.append<Protocol::Schema::TuneCommand>(Protocol::CommandID::TUNE, params.rtt_us, params.bandwidth,
+                                                  params.buffer_size, params.chunk_size);
+    if (!message.flush(socket_fd) || receiveReply() != Protocol::ReplyStatus::ACK) {
+        std::cerr << PRINT_ERROR << "Server rejected TUNE\n";
+        return;
+    }
+    std::cout << "Session tuned: " << SocketTuning::report(socket_fd, params) << "\n";
 }
 
-void FileClient::getFile(const std::string& file_name) {
+void FileClient::getFile(const std::string& file_name, bool conditional) {
     // Construct Absolute File Path
     std::filesystem::path local_path = std::filesystem::current_path() / file_name;
 
     // Construct and Serialize Command Header
-    std::vector<char> header(Protocol::COMMAND_HEADER_SIZE + 2 + file_name.size());
-    header[0] = static_cast<char>(Protocol::CommandID::GET_FILE);
-    std::memset(&header[1], 0, 3);
-    Protocol::write_uint16(&header[4], static_cast<uint16_t>(file_name.size()));
-    std::memcpy(&header[6], file_name.data(), file_name.size());
+    // Conditional GET Carries the Version We Already Have, Zeros if None
+    MessageBuilder message;
+    if (conditional) {
+        Protocol::FileVersion local;
+        metadata.version(local_path, file_name, local);
+        message.append<Protocol::Schema::ConditionalCommand>(Protocol::CommandID::GET_IF_CHANGED, file_name,
+                                                             local.size, local.mtime_ns, local.hash);
+    } else {
+        message.append<Protocol::Schema::PathCommand>(Protocol::CommandID::GET_FILE, file_name);
+    }
 
     // Send Command Header
-    send(socket_fd, header.data(), header.size(), 0);
+    message.flush(socket_fd);
 
     Protocol::ReplyStatus reply = receiveReply(); //Get a reply from the server with the status of our request
+    if (reply == Protocol::ReplyStatus::NOT_MODIFIED) {
+        std::cout << PRINT_SUCCESSES << "Not modified, kept " << local_path << "\n";
+        return;
+    }
     if (reply == Protocol::ReplyStatus::INVALID) { //The requested file does not exist on server
         //std::cerr << "Error: File does not exist on server:" << file_name << "\n";
         std::cerr << PRINT_ERROR << "File does not exist on server:" << file_name << "\n";
@@ -105,31 +253,28 @@ void FileClient::getFile(const std::string& file_name) {
         return;
     }
 
-    // Receive Header Buffer
-    char header_buf[4096];
-    ssize_t bytes_received = recv(socket_fd, header_buf, sizeof(header_buf), 0);
-    if (bytes_received <= 0) {
-        std::cerr << PRINT_ERROR << "Failed to receive file header\n";
-        return;
-    }
-
-    // Parse Header Buffer
-    std::vector<char> buffer(header_buf, header_buf + bytes_received);
+    // Receive Header Buffer, Behind the Version Being Sent for a Conditional GET
+    std::vector<char> temp(chunk_size);
+    std::vector<char> buffer;
+    size_t header_offset = conditional ? Protocol::FILE_VERSION_SIZE : 0;
     Protocol::FileHeader file_header;
     size_t next_offset;
-    if (!Protocol::FileHeader::parse(buffer, 0, file_header, next_offset)) {
-        std::cerr << PRINT_ERROR << "Invalid file header received\n";
-        return;
+    while (!Protocol::FileHeader::parse(buffer, header_offset, file_header, next_offset)) {
+        ssize_t bytes_received = recv(socket_fd, temp.data(), temp.size(), 0);
+        if (bytes_received <= 0) {
+            std::cerr << PRINT_ERROR << "Failed to receive file header\n";
+            return;
+        }
+        buffer.insert(buffer.end(), temp.begin(), temp.begin() + bytes_received);
     }
 
     // Receive File Data
     std::vector<char> file_data;
     file_data.insert(file_data.end(), buffer.begin() + next_offset, buffer.end());
     while (file_data.size() < file_header.file_size) {
-        char temp[4096];
-        ssize_t n = recv(socket_fd, temp, sizeof(temp), 0);
+        ssize_t n = recv(socket_fd, temp.data(), temp.size(), 0);
         if (n <= 0) break;
-        file_data.insert(file_data.end(), temp, temp + n);
+        file_data.insert(file_data.end(), temp.begin(), temp.begin() + n);
     }
 
     // Validate File Size
@@ -140,52 +285,128 @@ void FileClient::getFile(const std::string& file_name) {
         return;
     }
 
+    // Validate the Contents Against the Version the Server Sent
+    Protocol::FileVersion remote;
+    if (conditional) {
+        remote = Protocol::FileVersion::parse(buffer.data());
+        if (MetadataIndex::hash(MetadataIndex::FNV_OFFSET, file_data.data(), file_data.size()) != remote.hash) {
+            std::cerr << PRINT_ERROR << "Received contents do not match the server's hash\n";
+            return;
+        }
+    }
+
     // Write to Local File
     if (!writeFile(local_path, file_data)) {
         std::cerr << PRINT_ERROR << "Failed to save file to " << local_path << "\n";
         return;
     }
+
+    // Take Over the Server's Modification Time and Remember the Version
+    if (conditional) {
+        int file_fd = open(local_path.c_str(), O_WRONLY);
+        if (file_fd >= 0 && MetadataIndex::setMtime(file_fd, remote.mtime_ns)) metadata.record(file_name, remote);
+        if (file_fd >= 0) close(file_fd);
+    }
     std::cout << PRINT_SUCCESSES << "Downloaded file to " << local_path << "\n";
 }
 
-void FileClient::putFile(const std::string& file_name) {
+void FileClient::getLocalFile(const std::string& file_name) {
+    std::filesystem::path local_path = std::filesystem::current_path() / file_name;
+
+    // Send OPEN_FILE Command
+    MessageBuilder message;
+    message.append<Protocol::Schema::PathCommand>(Protocol::CommandID::OPEN_FILE, file_name);
+    message.flush(socket_fd);
+
+    // The Reply Byte Carries the Server's Open File
+    uint8_t reply = static_cast<uint8_t>(Protocol::ReplyStatus::ERROR);
+    bool ok;
+    int src_fd = LocalSocket::receiveFd(socket_fd, reinterpret_cast<char*>(&reply), sizeof(reply), ok);
+    if (static_cast<Protocol::ReplyStatus>(reply) == Protocol::ReplyStatus::INVALID) {
+        std::cerr << PRINT_ERROR << "File does not exist on server:" << file_name << "\n";
+        return;
+    }
+    if (static_cast<Protocol::ReplyStatus>(reply) != Protocol::ReplyStatus::ACK || src_fd < 0) {
+        std::cerr << PRINT_ERROR << "Server rejected OPEN_FILE request\n";
+        if (src_fd >= 0) close(src_fd);
+        return;
+    }
+
+    // Serving the Same Directory, Truncating the Destination Would Destroy the Source
+    struct stat src_st{}, dst_st{};
+    fstat(src_fd, &src_st);
+    if (stat(local_path.c_str(), &dst_st) == 0 && dst_st.st_dev == src_st.st_dev && dst_st.st_ino == src_st.st_ino) {
+        std::cout << PRINT_SUCCESSES << local_path << " is the server's file already\n";
+        close(src_fd);
+        return;
+    }
+
+    // Copy Between the Two Descriptors, Inside the Kernel Where Possible
+    int dst_fd = open(local_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, src_st.st_mode & 07777);
+    FileCopy::Method method;
+    bool copied = dst_fd >= 0 && FileCopy::copy(src_fd, dst_fd, static_cast<uint64_t>(src_st.st_size), method);
+    close(src_fd);
+    if (dst_fd >= 0) copied = close(dst_fd) == 0 && copied;
+    if (!copied) {
+        std::cerr << PRINT_ERROR << "Failed to save file to " << local_path << "\n";
+        return;
+    }
+    std::cout << PRINT_SUCCESSES << "Copied file to " << local_path << " from the server's descriptor ("
+              << FileCopy::methodName(method) << ", " << src_st.st_size << " bytes)\n";
+}
+
+void FileClient::putFile(const std::string& file_name, bool conditional) {
     // Construct Absolute File Path
     std::filesystem::path local_path = std::filesystem::current_path() / file_name;
 
-    // Read the Local File
+    // Conditional PUT Offers the Local Version First, the File Is Only Read if the Server Wants It
+    Protocol::FileVersion local;
     std::vector<char> file_data;
-    if (!readFile(local_path, file_data)) {
+    if (conditional ? !metadata.version(local_path, file_name, local) : !readFile(local_path, file_data)) {
         std::cerr << PRINT_ERROR << "Failed to read local file: " << local_path << "\n";
         return;
     }
 
     // Construct and Serialize the Payload
-    std::vector<char> cmd_payload(Protocol::COMMAND_HEADER_SIZE + 2 + file_name.size());
-    cmd_payload[0] = static_cast<char>(Protocol::CommandID::PUT_FILE);
-    std::memset(&cmd_payload[1], 0, 3);
-    Protocol::write_uint16(&cmd_payload[4], static_cast<uint16_t>(file_name.size()));
-    std::memcpy(&cmd_payload[6], file_name.data(), file_name.size());
+    MessageBuilder message;
+    if (conditional) {
+        message.append<Protocol::Schema::ConditionalCommand>(Protocol::CommandID::PUT_IF_CHANGED, file_name,
+                                                             local.size, local.mtime_ns, local.hash);
+    } else {
+        message.append<Protocol::Schema::PathCommand>(Protocol::CommandID::PUT_FILE, file_name);
+    }
 
     // Send the Payload
-    send(socket_fd, cmd_payload.data(), cmd_payload.size(), 0);
+    message.flush(socket_fd);
 
-    // Receive Server Reply (ACK, NACK, ERROR)
-    if (receiveReply() != Protocol::ReplyStatus::ACK) {
+    // Receive Server Reply (ACK, NACK, NOT_MODIFIED, ERROR)
+    Protocol::ReplyStatus reply = receiveReply();
+    if (reply == Protocol::ReplyStatus::NOT_MODIFIED) {
+        std::cout << PRINT_SUCCESSES << "Not modified, server already has " << file_name << "\n";
+        return;
+    }
+    if (reply != Protocol::ReplyStatus::ACK) {
         std::cerr << PRINT_ERROR << "Server rejected PUT_FILE command\n";
         return;
     }
 
+    // The Server Now Waits for the Upload, if the File Vanished There Is No Way to Back Out
+    if (conditional && !readFile(local_path, file_data)) {
+        std::cerr << PRINT_ERROR << "Failed to read local file: " << local_path << "\n";
+        disconnect();
+        return;
+    }
+
     // Construct and Serialize FileHeader
     Protocol::FileHeader header{0644, file_name, file_data.size()};
-    std::vector<char> header_buffer(2 + 2 + header.path.size() + 8);
-    Protocol::write_uint16(&header_buffer[0], header.permissions);
-    Protocol::write_uint16(&header_buffer[2], header.path.size());
-    std::memcpy(&header_buffer[4], header.path.data(), header.path.size());
-    Protocol::write_uint64(&header_buffer[4 + header.path.size()], header.file_size);
+    message.append<Protocol::Schema::FileHeader>(header.permissions, header.path, header.file_size);
 
-    // Send FileHeader and File Data
-    send(socket_fd, header_buffer.data(), header_buffer.size(), 0);
-    send(socket_fd, file_data.data(), file_data.size(), 0);
+    // Send FileHeader and File Data in One Call
+    message.appendRef(file_data.data(), file_data.size());
+    if (!message.flush(socket_fd)) {
+        std::cerr << PRINT_ERROR << "Failed to send file data\n";
+        return;
+    }
 
     // Receive Final Server Reply
     if (receiveReply() == Protocol::ReplyStatus::ACK) {
@@ -195,6 +416,379 @@ void FileClient::putFile(const std::string& file_name) {
     }
 }
 
+void FileClient::copyRemote(const std::string& src, const std::string& dst, bool move) {
+    // Command Header, Source and Destination Pathnames
+    MessageBuilder message;
+    message.append<Protocol::Schema::CopyCommand>(move ? Protocol::CommandID::MOVE : Protocol::CommandID::COPY, src, dst);
+    message.flush(socket_fd);
+
+    Protocol::ReplyStatus reply = receiveReply();
+    if (reply == Protocol::ReplyStatus::ACK) {
+        std::cout << PRINT_SUCCESSES << (move ? "Moved " : "Copied ") << src << " to " << dst << " on the server\n";
+    } else if (reply == Protocol::ReplyStatus::INVALID) {
+        std::cerr << PRINT_ERROR << "Source does not exist on server or is the destination: " << src << "\n";
+    } else {
+        std::cerr << PRINT_ERROR << "Server failed to " << (move ? "move " : "copy ") << src << "\n";
+    }
+}
+
+void FileClient::getSparse(const std::string& file_name) {
+    std::filesystem::path local_path = std::filesystem::current_path() / file_name;
+
+    // Send GET_SPARSE Command
+    MessageBuilder message;
+    message.append<Protocol::Schema::PathCommand>(Protocol::CommandID::GET_SPARSE, file_name);
+    message.flush(socket_fd);
+
+    Protocol::ReplyStatus reply = receiveReply();
+    if (reply == Protocol::ReplyStatus::INVALID) {
+        std::cerr << PRINT_ERROR << "File does not exist on server:" << file_name << "\n";
+        return;
+    }
+    if (reply != Protocol::ReplyStatus::ACK) {
+        std::cerr << PRINT_ERROR << "Server rejected GET_SPARSE request\n";
+        return;
+    }
+
+    // Receive FileHeader
+    std::vector<char> buffer;
+    Protocol::FileHeader file_header;
+    size_t next_offset = 0;
+    while (!Protocol::FileHeader::parse(buffer, 0, file_header, next_offset)) {
+        size_t needed = buffer.size() + 1;
+        if (buffer.size() >= 4)
+            needed = 4 + Protocol::parse_uint16(&buffer[2]) + 8;
+        if (!SparseFile::fill(socket_fd, buffer, needed)) {
+            std::cerr << PRINT_ERROR << "Failed to receive file header\n";
+            return;
+        }
+    }
+    buffer.erase(buffer.begin(), buffer.begin() + next_offset);
+
+    // Receive Extents Directly into the Local File
+    int file_fd = open(local_path.c_str(), O_WRONLY | O_CREAT, 0644);
+    if (file_fd < 0) {
+        std::cerr << PRINT_ERROR << "Failed to open " << local_path << "\n";
+        return;
+    }
+    bool ok = SparseFile::receive(socket_fd, file_fd, file_header.file_size, buffer);
+    close(file_fd);
+
+    if (!ok) {
+        std::cerr << PRINT_ERROR << "Failed to save file to " << local_path << "\n";
+        return;
+    }
+    std::cout << PRINT_SUCCESSES << "Downloaded sparse file to " << local_path << "\n";
+}
+
+void FileClient::putSparse(const std::string& file_name) {
+    std::filesystem::path local_path = std::filesystem::current_path() / file_name;
+
+    // Open the Local File and Map Its Data Extents
+    int file_fd = open(local_path.c_str(), O_RDONLY);
+    struct stat st{};
+    Protocol::ExtentMap map;
+    if (file_fd < 0 || fstat(file_fd, &st) != 0 || !SparseFile::mapExtents(file_fd, st.st_size, map.extents)) {
+        std::cerr << PRINT_ERROR << "Failed to read local file: " << local_path << "\n";
+        if (file_fd >= 0) close(file_fd);
+        return;
+    }
+
+    // Send PUT_SPARSE Command
+    MessageBuilder message;
+    message.append<Protocol::Schema::PathCommand>(Protocol::CommandID::PUT_SPARSE, file_name);
+    message.flush(socket_fd);
+
+    if (receiveReply() != Protocol::ReplyStatus::ACK) {
+        std::cerr << PRINT_ERROR << "Server rejected PUT_SPARSE command\n";
+        close(file_fd);
+        return;
+    }
+
+    // Send FileHeader, ExtentMap, then Only the Data Extents
+    Protocol::FileHeader header{static_cast<uint16_t>(st.st_mode & 07777), file_name, static_cast<uint64_t>(st.st_size)};
+    message.append<Protocol::Schema::FileHeader>(header.permissions, header.path, header.file_size);
+    message.append<Protocol::Schema::Count>(static_cast<uint32_t>(map.extents.size()));
+    for (const Protocol::Extent& extent : map.extents) {
+        message.append<Protocol::Schema::Extent>(extent.offset, extent.length);
+    }
+    bool sent = message.flush(socket_fd, !map.extents.empty()) && SparseFile::sendExtentData(socket_fd, file_fd, map);
+    close(file_fd);
+    if (!sent) {
+        std::cerr << PRINT_ERROR << "Failed to send file data\n";
+        return;
+    }
+
+    // Receive Final Server Reply
+    if (receiveReply() == Protocol::ReplyStatus::ACK) {
+        std::cout << PRINT_SUCCESSES << "Successfully uploaded sparse file ("
+                  << map.dataSize() << " of " << header.file_size << " bytes sent)\n";
+    } else {
+        std::cerr << PRINT_ERROR << "Server failed to receive file\n";
+    }
+}
+
+bool FileClient::enableSharedRing() {
+    if (!local) {
+        std::cerr << PRINT_ERROR << "Shared memory needs a unix: connection\n";
+        return false;
+    }
+    shared_ring = SharedRingClient::upgrade(socket_fd);
+    if (!shared_ring) {
+        std::cerr << PRINT_ERROR << "Server does not support shared memory transfers\n";
+        return false;
+    }
+    std::cout << "Switched connection to shared memory rings\n";
+    return true;
+}
+
+void FileClient::ringTransfer(bool get, const std::string& file_name) {
+    std::filesystem::path local_path = std::filesystem::current_path() / file_name;
+    uint64_t bytes = 0;
+    Protocol::ReplyStatus status;
+
+    if (get) {
+        // Download Next to the Destination, the Server May Be Reading the Same File
+        std::filesystem::path part_path = local_path.string() + ".part";
+        int file_fd = open(part_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (file_fd < 0) {
+            std::cerr << PRINT_ERROR << "Failed to open " << part_path << "\n";
+            return;
+        }
+        status = shared_ring->get(file_name, file_fd, bytes);
+        bool saved = close(file_fd) == 0 && status == Protocol::ReplyStatus::ACK
+                  && std::rename(part_path.c_str(), local_path.c_str()) == 0;
+        if (!saved) unlink(part_path.c_str());
+    } else {
+        int file_fd = open(local_path.c_str(), O_RDONLY);
+        if (file_fd < 0) {
+            std::cerr << PRINT_ERROR << "Failed to open " << local_path << "\n";
+            return;
+        }
+        status = shared_ring->put(file_fd, file_name, bytes);
+        close(file_fd);
+    }
+
+    if (status == Protocol::ReplyStatus::ACK) {
+        std::cout << PRINT_SUCCESSES << (get ? "Downloaded " : "Uploaded ") << file_name << " (" << bytes << " bytes)\n";
+    } else if (status == Protocol::ReplyStatus::INVALID) {
+        std::cerr << PRINT_ERROR << "File does not exist on server:" << file_name << "\n";
+    } else {
+        std::cerr << PRINT_ERROR << "Transfer of " << file_name << " failed\n";
+    }
+}
+
+bool FileClient::enableMultiplex() {
+    if (mux) return true;
+    if (!MuxClient::upgrade(socket_fd)) {
+        std::cerr << PRINT_ERROR << "Server does not support multiplexed transfers\n";
+        return false;
+    }
+    mux = std::make_unique<MuxClient>(socket_fd);
+    std::cout << "Switched connection to multiplexed protocol v" << static_cast<int>(Multiplex::VERSION) << "\n";
+    return true;
+}
+
+void FileClient::multiGet(const std::vector<std::string>& file_names) {
+    // Start Every Download, Then Collect Them
+    std::vector<MuxClient::StreamID> streams;
+    for (const std::string& name : file_names) {
+        std::filesystem::path local_path = std::filesystem::current_path() / name;
+        streams.push_back(mux->startGet(name, local_path));
+    }
+
+    for (size_t i = 0; i < streams.size(); i++) {
+        MuxClient::Result result = mux->wait(streams[i]);
+        if (result.status == Protocol::ReplyStatus::ACK) {
+            std::cout << PRINT_SUCCESSES << "Downloaded " << file_names[i] << " (" << result.bytes << " bytes)\n";
+        } else if (result.status == Protocol::ReplyStatus::INVALID) {
+            std::cerr << PRINT_ERROR << "File does not exist on server:" << file_names[i] << "\n";
+        } else {
+            std::cerr << PRINT_ERROR << "Failed to download " << file_names[i] << "\n";
+        }
+    }
+}
+
+void FileClient::multiPut(const std::vector<std::string>& file_names) {
+    // Start Every Upload, Then Collect Them
+    std::vector<MuxClient::StreamID> streams;
+    for (const std::string& name : file_names) {
+        std::filesystem::path local_path = std::filesystem::current_path() / name;
+        streams.push_back(mux->startPut(local_path, name));
+    }
+
+    for (size_t i = 0; i < streams.size(); i++) {
+        MuxClient::Result result = mux->wait(streams[i]);
+        if (result.status == Protocol::ReplyStatus::ACK) {
+            std::cout << PRINT_SUCCESSES << "Uploaded " << file_names[i] << " (" << result.bytes << " bytes)\n";
+        } else {
+            std::cerr << PRINT_ERROR << "Failed to upload " << file_names[i] << "\n";
+        }
+    }
+}
+
+bool FileClient::fetchListing(const std::string& dir, Protocol::Listing& out) {
+    std::vector<char> buffer;
+    size_t offset = 0;
+
+    // On a Multiplexed Connection the Listing Is a Stream of Its Own
+    if (mux) {
+        MuxClient::Result result = mux->wait(mux->startList(dir));
+        if (result.status != Protocol::ReplyStatus::ACK) return false;
+        buffer = std::move(result.data);
+    } else {
+        MessageBuilder message;
+        message.append<Protocol::Schema::PathCommand>(Protocol::CommandID::ENUMERATE, dir);
+        if (!message.flush(socket_fd) || receiveReply() != Protocol::ReplyStatus::ACK) return false;
+
+        // Listing Length, Then the Listing
+        if (!SparseFile::fill(socket_fd, buffer, 4)) return false;
+        if (!SparseFile::fill(socket_fd, buffer, 4 + Protocol::parse_uint32(buffer.data()))) return false;
+        offset = 4;
+    }
+
+    size_t next_offset;
+    return Protocol::Listing::parse(buffer, offset, out, next_offset);
+}
+
+void FileClient::listRemote(const std::string& dir) {
+    Protocol::Listing listing;
+    if (!fetchListing(dir, listing)) {
+        std::cerr << PRINT_ERROR << "Failed to list remote directory: " << dir << "\n";
+        return;
+    }
+    for (const Protocol::ListingEntry& entry : listing.entries) {
+        std::cout << std::oct << std::setw(4) << std::setfill('0') << entry.permissions << std::dec << std::setfill(' ')
+                  << " " << std::setw(12) << entry.version.size << " " << entry.path << "\n";
+    }
+    std::cout << listing.entries.size() << " files\n";
+}
+
+bool FileClient::watch(const std::string& prefix) {
+    MessageBuilder message;
+    message.append<Protocol::Schema::PathCommand>(Protocol::CommandID::SUBSCRIBE, prefix);
+    if (!message.flush(socket_fd) || receiveReply() != Protocol::ReplyStatus::ACK) {
+        std::cerr << PRINT_ERROR << "Server does not support change notification\n";
+        return false;
+    }
+    std::cout << "Watching '" << prefix << "' for changes, press Ctrl-C to stop\n";
+
+    // Print Each Batch as It Arrives
+    std::vector<char> buffer;
+    std::vector<char> temp(chunk_size);
+    while (true) {
+        Protocol::ChangeBatch batch;
+        size_t next_offset;
+        while (!Protocol::ChangeBatch::parse(buffer, 0, batch, next_offset)) {
+            ssize_t n = recv(socket_fd, temp.data(), temp.size(), 0);
+            if (n <= 0) {
+                std::cout << "Server closed the subscription\n";
+                return true;
+            }
+            buffer.insert(buffer.end(), temp.begin(), temp.begin() + n);
+        }
+        buffer.erase(buffer.begin(), buffer.begin() + next_offset);
+
+        for (const Protocol::ChangeEvent& event : batch.events) {
+            if (event.type == Protocol::ChangeType::OVERFLOW) {
+                std::cout << "overflow " << event.path << " (changes were missed, list it again)" << std::endl;
+                continue;
+            }
+            const char* type = event.type == Protocol::ChangeType::CREATED ? "created "
+                             : event.type == Protocol::ChangeType::MODIFIED ? "modified" : "deleted ";
+            std::cout << type << " " << event.path << std::endl;
+        }
+    }
+}
+
+void FileClient::sync(const std::string& direction, const std::string& dir, size_t concurrency) {
+    bool push = direction == "push";
+    std::filesystem::path root = std::filesystem::current_path();
+
+    // Both Listings, Local Versions Come from Our Index. A Missing Destination Is Just Empty.
+    Protocol::Listing remote, local;
+    if (!fetchListing(dir, remote) && !push) {
+        std::cerr << PRINT_ERROR << "Failed to list remote directory: " << dir << "\n";
+        return;
+    }
+    if (!metadata.list(root, dir, local) && push) {
+        std::cerr << PRINT_ERROR << "Failed to list local directory: " << dir << "\n";
+        return;
+    }
+
+    // Only Files That Are New or Whose Contents Differ Are Transferred
+    const Protocol::Listing& source = push ? local : remote;
+    std::map<std::string, Protocol::FileVersion> existing;
+    for (const Protocol::ListingEntry& entry : (push ? remote : local).entries) existing[entry.path] = entry.version;
+
+    std::vector<const Protocol::ListingEntry*> changed;
+    uint64_t skipped_files = 0, skipped_bytes = 0, rejected = 0;
+    for (const Protocol::ListingEntry& entry : source.entries) {
+        // The Listing Comes from the Server, a Name Reaching Outside the Directory Is Never Used
+        std::filesystem::path relative = std::filesystem::path(entry.path).lexically_normal();
+        if (relative.empty() || relative.is_absolute() || relative.has_root_name() || *relative.begin() == ".."
+            || relative == ".") {
+            std::cerr << PRINT_ERROR << "Ignoring listing entry outside '" << dir << "': " << entry.path << "\n";
+            rejected++;
+            continue;
+        }
+
+        auto it = existing.find(entry.path);
+        if (it != existing.end() && it->second.sameContents(entry.version)) {
+            skipped_files++;
+            skipped_bytes += entry.version.size;
+        } else {
+            changed.push_back(&entry);
+        }
+    }
+    if (!changed.empty() && !enableMultiplex()) return;
+
+    // Keep Up to `concurrency` Transfers in Flight on Their Own Streams
+    std::deque<std::pair<MuxClient::StreamID, const Protocol::ListingEntry*>> in_flight;
+    size_t next = 0;
+    uint64_t sent_files = 0, sent_bytes = 0, failed = rejected;
+    while (next < changed.size() || !in_flight.empty()) {
+        while (next < changed.size() && in_flight.size() < concurrency) {
+            const Protocol::ListingEntry* entry = changed[next++];
+            std::string name = (std::filesystem::path(dir) / entry->path).generic_string();
+            std::filesystem::path local_path = root / name;
+            if (push) {
+                in_flight.emplace_back(mux->startPut(local_path, name), entry);
+            } else {
+                std::error_code error;
+                std::filesystem::create_directories(local_path.parent_path(), error);
+                in_flight.emplace_back(mux->startGet(name, local_path), entry);
+            }
+        }
+
+        auto [stream_id, entry] = in_flight.front();
+        in_flight.pop_front();
+        std::string name = (std::filesystem::path(dir) / entry->path).generic_string();
+        if (mux->wait(stream_id).status != Protocol::ReplyStatus::ACK) {
+            std::cerr << PRINT_ERROR << "Failed to sync " << name << "\n";
+            failed++;
+            continue;
+        }
+        sent_files++;
+        sent_bytes += entry->version.size;
+
+        // Pulled Files Take the Server's Modification Time Once Their Contents Check Out
+        Protocol::FileVersion received;
+        if (!push && metadata.version(root / name, name, received) && received.sameContents(entry->version)) {
+            int file_fd = open((root / name).c_str(), O_WRONLY);
+            if (file_fd >= 0 && MetadataIndex::setMtime(file_fd, entry->version.mtime_ns)) metadata.record(name, entry->version);
+            if (file_fd >= 0) close(file_fd);
+        }
+    }
+
+    if (failed == 0) std::cout << PRINT_SUCCESSES;
+    else std::cout << PRINT_ERROR;
+    std::cout << "Sync " << direction << " '" << dir << "': "
+              << sent_files << " files (" << sent_bytes << " bytes) sent, "
+              << skipped_files << " files (" << skipped_bytes << " bytes) skipped, "
+              << failed << " failed\n";
+}
+
 Protocol::ReplyStatus FileClient::receiveReply() {
     uint8_t reply;
     ssize_t n = recv(socket_fd, &reply, sizeof(reply), 0);
@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <filesystem>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif
+
+#include "FileCopy.hpp"
+
+namespace FileCopy {
+
+    bool copy(int src_fd, int dst_fd, uint64_t size, Method& method) {
+        uint64_t done = 0;
+
+    #if defined(__linux__) && defined(FICLONE)
+        // Reflink: Both Files Share the Same Blocks Until One Is Written
+        if (ioctl(dst_fd, FICLONE, src_fd) == 0) {
+            method = Method::CLONE;
+            return true;
+        }
+    #endif
+
+    #ifdef __linux__
+        // Copy Inside the Kernel, the Filesystem May Offload It to the Storage Device
+        loff_t src_offset = 0, dst_offset = 0;
+        while (done < size) {
+            size_t want = static_cast<size_t>(std::min<uint64_t>(size - done, 1u << 30));
+            ssize_t n = copy_file_range(src_fd, &src_offset, dst_fd, &dst_offset, want, 0);
+            if (n < 0) {
+                // Not Supported Here, Fall Back Below Unless Part of the File Was Already Copied
+                bool unsupported = errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP;
+                if (done == 0 && unsupported) break;
+                return false;
+            }
+            if (n == 0) break; // Source shrank, copy what is there
+            done += n;
+        }
+        if (done > 0 || size == 0) {
+            method = Method::COPY_FILE_RANGE;
+            return true;
+        }
+    #endif
+
+        // Plain Read / Write
+        method = Method::READ_WRITE;
+        std::vector<char> chunk(1024 * 1024);
+        while (done < size) {
+            ssize_t n = pread(src_fd, chunk.data(), chunk.size(), static_cast<off_t>(done));
+            if (n < 0) return false;
+            if (n == 0) break;
+            ssize_t written = 0;
+            while (written < n) {
+                ssize_t w = pwrite(dst_fd, chunk.data() + written, n - written, static_cast<off_t>(done + written));
+                if (w <= 0) return false;
+                written += w;
+            }
+            done += n;
+        }
+        return true;
+    }
+
+
+    bool copyPath(const std::string& src, const std::string& dst, Method& method) {
+        // Non-Blocking, a FIFO Swapped in After the Caller's Check Mustn't Wait Forever for a Writer
+        int src_fd = open(src.c_str(), O_RDONLY | O_NONBLOCK);
+        struct stat st{};
+        if (src_fd < 0 || fstat(src_fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+            if (src_fd >= 0) close(src_fd);
+            return false;
+        }
+        fcntl(src_fd, F_SETFL, fcntl(src_fd, F_GETFL) & ~O_NONBLOCK);
+
+        std::error_code error;
+        std::filesystem::create_directories(std::filesystem::path(dst).parent_path(), error);
+        int dst_fd = open(dst.c_str(), O_WRONLY | O_CREAT | O_TRUNC, st.st_mode & 07777);
+        if (dst_fd < 0) {
+            close(src_fd);
+            return false;
+        }
+
+        bool ok = copy(src_fd, dst_fd, static_cast<uint64_t>(st.st_size), method);
+        ok = fchmod(dst_fd, st.st_mode & 07777) == 0 && ok;
+        close(src_fd);
+        ok = close(dst_fd) == 0 && ok;
+        if (!ok) unlink(dst.c_str());
+        return ok;
+    }
+
+
+    bool move(const std::string& src, const std::string& dst, Method& method, bool& renamed) {
+        std::error_code error;
+        std::filesystem::create_directories(std::filesystem::path(dst).parent_path(), error);
+
+        renamed = std::rename(src.c_str(), dst.c_str()) == 0;
+        if (renamed) return true;
+        if (errno != EXDEV) return false;
+
+        // Different Filesystems, Copy Then Remove the Original
+        return copyPath(src, dst, method) && unlink(src.c_str()) == 0;
+    }
+
+
+    const char* methodName(Method method) {
+        switch (method) {
+            case Method::CLONE: return "reflink";
+            case Method::COPY_FILE_RANGE: return "copy_file_range";
+            default: return "read/write";
+        }
+    }
+
+} // namespace FileCopy
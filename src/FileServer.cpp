@@ -1,135 +1,198 @@
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <cstring>
 #include <filesystem>
-#include <fstream>
 #include <string>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <netinet/in.h>
+#include <thread>
 
+#include "FileCopy.hpp"
 #include "FileServer.hpp"
+#include "LocalSocket.hpp"
+#include "MessageBuilder.hpp"
+#include "MessageSchema.hpp"
+#include "MuxServerSession.hpp"
 #include "Protocol.hpp"
+#include "SharedRingSession.hpp"
+#include "SocketTuning.hpp"
+#include "SparseFile.hpp"
 
-FileServer::FileServer(int port)
-    : BaseServer(port) {}
+FileServer::FileServer(int port, const TransferScheduler::Config& scheduler_config)
+    : BaseServer(port), scheduler(scheduler_config),
+      metadata(std::filesystem::current_path() / MetadataIndex::DEFAULT_NAME),
+      notifier(std::filesystem::current_path()) {}
 
     
-void FileServer::handleIdentify(const std::vector<char>& data) {
-    std::string id(data.begin(), data.end());
-    std::cout << "IDENTIFY command with id: " << id << ".\n";
+void FileServer::handleIdentify(Session& session, const CommandParser::Command& command) {
+    constexpr uint32_t MAX_PROBE = 16 * 1024 * 1024;
+    std::cout << "IDENTIFY command: client ID = " << command.path << "\n";
+    scheduler.setWeight(session.flow, command.path);
+
+    // The Client Times the ACK for RTT, So It Goes Out on Its Own
+    uint32_t probe_bytes = 0;
+    size_t consumed;
+    Protocol::Schema::IdentifyTail::read(command.tail.data(), command.tail.size(), consumed, probe_bytes);
+    probe_bytes = std::min(probe_bytes, MAX_PROBE);
+    acknowledgeCommand(session.client_fd);
+
+    // Bandwidth Probe, Timed by the Client from the ACK to the Last Byte
+    static const std::vector<char> zeros(64 * 1024, 0);
+    uint32_t sent = 0;
+    while (sent < probe_bytes) {
+        size_t n = std::min<size_t>(zeros.size(), probe_bytes - sent);
+        ssize_t w = send(session.client_fd, zeros.data(), n, sent + n < probe_bytes ? SEND_MORE : 0);
+        if (w <= 0) {
+            std::cerr << "IDENTIFY: Failed to send bandwidth probe\n";
+            return;
+        }
+        sent += static_cast<uint32_t>(w);
+    }
 }
 
 
-void FileServer::handleRequest(int client_fd) {
-    constexpr size_t BUFFER_SIZE = 4096;
-    std::vector<char> buffer;
-    char temp_buffer[BUFFER_SIZE];
-
-    ssize_t bytes_received;
-    while ((bytes_received = recv(client_fd, temp_buffer, BUFFER_SIZE, 0)) > 0) {
-        // Append Received Data to Buffer
-        buffer.insert(buffer.end(), temp_buffer, temp_buffer + bytes_received);
+void FileServer::handleTune(Session& session, const std::string& body) {
+    // Apply What the Client Measured to Our End of the Connection
+    SocketTuning::Parameters params;
+    size_t consumed;
+    bool parsed = Protocol::Schema::TuneBody::read(body.data(), body.size(), consumed, params.rtt_us, params.bandwidth,
+                                                   params.buffer_size, params.chunk_size);
 
-        // Attempt to Parse Command Header
-        if (buffer.empty() || buffer.size() < Protocol::COMMAND_HEADER_SIZE)
-            continue;
-        Protocol::CommandHeader header;
-        if (!Protocol::CommandHeader::parse(buffer, header))
-            continue;  // Wait for more data
-        std::cout << "Received command ID: " << static_cast<int>(header.command_id) << "\n";
-
-        // Attempt to Parse and Handle the Command
-        if (!parseCommand(client_fd, header, buffer))
-            continue;  // Wait for more data
+    // The Chunk Size Becomes Our Per-Transfer Buffer and Scheduler Quantum, Only Sane Ones Are Taken
+    if (!parsed || !SocketTuning::withinLimits(params) || !SocketTuning::apply(session.client_fd, params)) {
+        std::cerr << "TUNE: Failed to apply socket parameters\n";
+        Protocol::sendReply(session.client_fd, Protocol::ReplyStatus::NACK);
+        return;
     }
+    scheduler.setChunkSize(session.flow, params.chunk_size);
 
-    if (bytes_received < 0) {
-        std::cerr << "Error: Failed to receive data from client\n";
-    }
+    acknowledgeCommand(session.client_fd);
+    std::cout << "TUNE: Session tuned: " << SocketTuning::report(session.client_fd, params) << "\n";
 }
 
 
-bool FileServer::parseCommand(int client_fd, Protocol::CommandHeader& command_header, std::vector<char>& buffer) {
-    Protocol::CommandID command = command_header.command_id;
-    size_t cursor = Protocol::COMMAND_HEADER_SIZE;
-
-    if (command == Protocol::CommandID::IDENTIFY) {
-        // Parse IDENTIFY Command
-        std::string client_id(buffer.begin() + cursor, buffer.end());
-        std::cout << "IDENTIFY command: client ID = " << client_id << "\n";
+void FileServer::handleRequest(int client_fd) {
+    constexpr size_t RING_CAPACITY = 64 * 1024;
+    Session session{client_fd, scheduler.addClient(), RingBuffer(RING_CAPACITY), CommandParser()};
+
+    while (true) {
+        // Handle Every Complete Command Already Buffered
+        CommandParser::Command command;
+        while (session.parser.parseCommand(session.ring, command)) {
+            std::cout << "Received command ID: " << static_cast<int>(command.header.command_id) << "\n";
+            handleCommand(session, command);
+        }
 
-        // Clear buffer after processing
-        buffer.clear();
-        return true;
+        // Receive Directly into the Ring, the Parser Resumes Where It Stopped
+        if (!fillRing(session)) break;
     }
 
-    else if (command == Protocol::CommandID::GET_FILE) {
-        // Parse Path Length
-        if (buffer.size() < cursor + 2)
-            return false;
-        uint16_t path_len = Protocol::parse_uint16(&buffer[cursor]);
-        cursor += 2;
+    scheduler.removeClient(session.flow);
+}
 
-        // Parse Path
-        if (buffer.size() < cursor + path_len)
-            return false;
-        std::string path_name(&buffer[cursor], path_len);
-        cursor += path_len;
 
-        // Acknowledge the command
-        //acknowledgeCommand(client_fd); //Moved this to handleGetFile, only send the ACK if the file exists
+bool FileServer::fillRing(Session& session) {
+    std::span<char> space = session.ring.writable();
+    ssize_t bytes_received = recv(session.client_fd, space.data(), space.size(), 0);
+    if (bytes_received < 0) {
+        std::cerr << "Error: Failed to receive data from client\n";
+    }
+    if (bytes_received <= 0) return false;
 
-        // Handle GET_FILE Command
-        handleGetFile(client_fd, path_name);
+    session.ring.commit(bytes_received);
+    return true;
+}
 
-        // Remove processed command from buffer
-        buffer.erase(buffer.begin(), buffer.begin() + cursor);
-        return true;
-    }
 
-    else if (command == Protocol::CommandID::PUT_FILE) {
-        // Parse Path Length
-        if (buffer.size() < cursor + 2)
-            return false;
-        uint16_t cmd_path_len = Protocol::parse_uint16(&buffer[cursor]);
-        cursor += 2;
+void FileServer::handleCommand(Session& session, const CommandParser::Command& command) {
+    int client_fd = session.client_fd;
 
-        // Parse Path
-        if (buffer.size() < cursor + cmd_path_len)
-            return false;
-        std::string cmd_path(&buffer[cursor], cmd_path_len);
-        cursor += cmd_path_len;
+    switch (command.header.command_id) {
+        case Protocol::CommandID::IDENTIFY:
+            handleIdentify(session, command);
+            break;
 
-        // Acknowledge the command
-        acknowledgeCommand(client_fd); // THIS MAY CAUSE MULTIPLE ACKS IF FILEHEADER NOT FULLY RECEIVED
+        case Protocol::CommandID::TUNE:
+            handleTune(session, command.tail);
+            break;
 
-        // Parse FileHeader
-        Protocol::FileHeader file_header;
-        size_t next_offset;
-        if (!Protocol::FileHeader::parse(buffer, cursor, file_header, next_offset))
-            return false;
-        cursor = next_offset;
+        case Protocol::CommandID::GET_FILE:
+            // ACK is sent by handleGetFile, only if the file exists
+            handleGetFile(session, command.path);
+            break;
 
-        // Parse File Data
-        if (buffer.size() < cursor + file_header.file_size)
-            return false;
-        std::vector<char> file_data(buffer.begin() + cursor, buffer.begin() + cursor + file_header.file_size);
-        cursor += file_header.file_size;
+        case Protocol::CommandID::PUT_FILE:
+            acknowledgeCommand(client_fd);
+            handlePutFile(session, command.path);
+            break;
 
-        // Handle PUT_FILE Command
-        handlePutFile(client_fd, file_data, file_header.permissions, file_header.path);
+        case Protocol::CommandID::GET_IF_CHANGED: {
+            Protocol::FileVersion known = Protocol::FileVersion::parse(command.tail.data());
+            handleGetFile(session, command.path, &known);
+            break;
+        }
 
-        // Remove processed command from buffer
-        buffer.erase(buffer.begin(), buffer.begin() + cursor);
-        return true;
-    }
+        case Protocol::CommandID::PUT_IF_CHANGED:
+            handlePutIfChanged(session, command);
+            break;
+
+        case Protocol::CommandID::ENUMERATE:
+            handleEnumerate(session, command.path);
+            break;
+
+        case Protocol::CommandID::COPY:
+        case Protocol::CommandID::MOVE:
+            handleCopy(session, command);
+            break;
+
+        case Protocol::CommandID::SUBSCRIBE:
+            handleSubscribe(session, command.path);
+            break;
+
+        case Protocol::CommandID::OPEN_FILE:
+            handleOpenFile(session, command.path);
+            break;
+
+        case Protocol::CommandID::SHARED_RING:
+            handleSharedRing(session, command);
+            break;
+
+        case Protocol::CommandID::GET_SPARSE:
+            handleGetSparse(session, command.path);
+            break;
+
+        case Protocol::CommandID::PUT_SPARSE:
+            acknowledgeCommand(client_fd);
+            handlePutSparse(session, command.path);
+            break;
+
+        case Protocol::CommandID::MULTIPLEX: {
+            // Reserved Byte Carries the Requested Protocol Version
+            if (command.header.reserved[0] != Multiplex::VERSION) {
+                Protocol::sendReply(client_fd, Protocol::ReplyStatus::NACK);
+                break;
+            }
+            acknowledgeCommand(client_fd);
+
+            // The Rest of the Connection Is Framed
+            std::vector<char> pending(session.ring.size());
+            session.ring.read(pending.data(), pending.size());
+            MuxServerSession mux(client_fd, scheduler, session.flow, metadata);
+            mux.run(pending);
+            break;
+        }
 
-    else {
-        std::cerr << "Unknown command ID: " << static_cast<int>(command) << "\n";
+        default:
+            std::cerr << "Unknown command ID: " << static_cast<int>(command.header.command_id) << "\n";
 
-        // Clear buffer to avoid reprocessing
-        buffer.clear();
-        return true;
+            // Drop buffered data to avoid reprocessing
+            session.ring.clear();
+            break;
     }
 }
 
@@ -140,64 +203,120 @@ void FileServer::acknowledgeCommand(int client_fd) {
 }
 
 
-void FileServer::handleGetFile(int client_fd, const std::string& file_name) {
-    std::vector<char> file_data;
+void FileServer::handleGetFile(Session& session, const std::string& file_name, const Protocol::FileVersion* known) {
+    int client_fd = session.client_fd;
     std::filesystem::path local_path = std::filesystem::current_path() / file_name;
 
-    // Read file from disk
-    if (!readFile(local_path.string(), file_data)) {
+    // Open file on disk, the contents are streamed by sendFileRange (non-blocking, a FIFO must not hang us)
+    int file_fd = open(local_path.c_str(), O_RDONLY | O_NONBLOCK);
+    struct stat st{};
+    if (file_fd < 0 || fstat(file_fd, &st) != 0 || !S_ISREG(st.st_mode)) {
         std::cerr << "GET_FILE: Failed to read file: " << file_name << "\n";
         Protocol::sendReply(client_fd, Protocol::ReplyStatus::INVALID); //This file does not exist, send INVALID
+        if (file_fd >= 0) close(file_fd);
         return;
-    }else{ //We found the file, send ACK
-        Protocol::sendReply(client_fd, Protocol::ReplyStatus::ACK);
     }
 
-    // Build and send the FileHeader
+    // Conditional GET: Nothing to Send if the Client Already Has These Contents
+    Protocol::FileVersion current;
+    if (known && !metadata.version(local_path, file_name, current)) {
+        std::cerr << "GET_IF_CHANGED: Failed to hash file: " << file_name << "\n";
+        Protocol::sendReply(client_fd, Protocol::ReplyStatus::INVALID);
+        close(file_fd);
+        return;
+    }
+    if (known && known->sameContents(current)) {
+        Protocol::sendReply(client_fd, Protocol::ReplyStatus::NOT_MODIFIED);
+        std::cout << "GET_IF_CHANGED: '" << file_name << "' not modified\n";
+        close(file_fd);
+        return;
+    }
+
+    // Build the FileHeader
     Protocol::FileHeader header;
     header.permissions = 0644; // TODO: optionally fetch real file mode
     header.path = local_path;
-    header.file_size = file_data.size();
+    header.file_size = static_cast<uint64_t>(st.st_size);
 
-    // Serialize FileHeader
-    std::vector<char> header_buffer;
-    header_buffer.resize(2 + 2 + header.path.size() + 8);
-    Protocol::write_uint16(&header_buffer[0], header.permissions);
-    Protocol::write_uint16(&header_buffer[2], header.path.size());
-    std::memcpy(&header_buffer[4], header.path.data(), header.path.size());
-    Protocol::write_uint64(&header_buffer[4 + header.path.size()], header.file_size);
+    // ACK, the Version Being Sent and FileHeader Go Out with the First Quantum of File Data
+    MessageBuilder message;
+    message.appendUint8(static_cast<uint8_t>(Protocol::ReplyStatus::ACK));
+    if (known) message.append<Protocol::Schema::FileVersion>(current.size, current.mtime_ns, current.hash);
+    message.append<Protocol::Schema::FileHeader>(header.permissions, header.path, header.file_size);
 
-    // Send FileHeader
-    if (send(client_fd, header_buffer.data(), header_buffer.size(), 0) != static_cast<ssize_t>(header_buffer.size())) {
-        std::cerr << "GET_FILE: Failed to send file header\n";
+    // Send File Data
+    if (!sendFileRange(session, file_fd, 0, header.file_size, message)) {
+        std::cerr << "GET_FILE: Failed to send file contents\n";
+        close(file_fd);
         return;
     }
+    close(file_fd);
+    std::cout << "GET_FILE: Sent file '" << file_name << "' (" << header.file_size << " bytes)\n";
+}
 
-    // Send File Data
-    size_t total_sent = 0;
-    while (total_sent < file_data.size()) {
-        ssize_t sent = send(client_fd, file_data.data() + total_sent,
-                            file_data.size() - total_sent, 0);
-        if (sent <= 0) {
-            std::cerr << "GET_FILE: Failed to send file contents\n";
-            return;
-        }
-        total_sent += sent;
+
+void FileServer::handlePutIfChanged(Session& session, const CommandParser::Command& command) {
+    std::filesystem::path local_path = std::filesystem::current_path() / command.path;
+    Protocol::FileVersion offered = Protocol::FileVersion::parse(command.tail.data());
+
+    // Skip the Upload if We Already Have These Contents
+    Protocol::FileVersion current;
+    if (metadata.version(local_path, command.path, current) && current.sameContents(offered)) {
+        Protocol::sendReply(session.client_fd, Protocol::ReplyStatus::NOT_MODIFIED);
+        std::cout << "PUT_IF_CHANGED: '" << command.path << "' not modified\n";
+        return;
     }
-    std::cout << "GET_FILE: Sent file '" << file_name << "' (" << total_sent << " bytes)\n";
+
+    acknowledgeCommand(session.client_fd);
+    handlePutFile(session, command.path, &offered);
 }
 
 
-void FileServer::handlePutFile(int client_fd, const std::vector<char>& file_data,
-                               uint16_t permissions, const std::string& file_name) {
+void FileServer::handlePutFile(Session& session, const std::string& file_name, const Protocol::FileVersion* offered) {
+    int client_fd = session.client_fd;
     std::filesystem::path local_path = std::filesystem::current_path() / file_name;
 
+    // Receive FileHeader
+    Protocol::FileHeader file_header;
+    while (!session.parser.parseFileHeader(session.ring, file_header)) {
+        if (!fillRing(session)) {
+            std::cerr << "PUT_FILE: Failed to receive file header\n";
+            return;
+        }
+    }
+
     std::cout << "PUT_FILE command for path: " << file_name
-              << " with permissions: " << std::oct << permissions
-              << " and file size: " << file_data.size() << std::dec << ".\n";
-    
-    // Write file data to disk
-    if (!writeFile(local_path.string(), file_data)) {
+              << " with permissions: " << std::oct << file_header.permissions
+              << " and file size: " << file_header.file_size << std::dec << ".\n";
+
+    // Stream file data from the ring to disk
+    int file_fd = open(local_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    uint64_t received = 0;
+    bool write_ok = file_fd >= 0;
+    while (received < file_header.file_size) {
+        if (session.ring.empty() && !fillRing(session)) break;
+
+        std::span<const char> data = session.ring.readable();
+        size_t n = static_cast<size_t>(std::min<uint64_t>(data.size(), file_header.file_size - received));
+        size_t written = 0;
+        while (write_ok && written < n) {
+            ssize_t w = write(file_fd, data.data() + written, n - written);
+            if (w <= 0) write_ok = false;
+            else written += w;
+        }
+        session.ring.consume(n); // Keep draining even after a write error so the stream stays in sync
+        received += n;
+    }
+    if (offered && write_ok) write_ok = MetadataIndex::setMtime(file_fd, offered->mtime_ns);
+    if (file_fd >= 0) close(file_fd);
+
+    if (received != file_header.file_size) {
+        std::cerr << "PUT_FILE: Connection lost after " << received << " bytes\n";
+        return;
+    }
+
+    // Report write errors to the client
+    if (!write_ok) {
         std::cerr << "PUT_FILE: Failed to write file to " << local_path << "\n";
         Protocol::sendReply(client_fd, Protocol::ReplyStatus::NACK);
         return;
@@ -205,7 +324,7 @@ void FileServer::handlePutFile(int client_fd, const std::vector<char>& file_data
 
     // Set file permission on Linux; ignore on Windows
     #ifndef _WIN32
-        if (chmod(local_path.c_str(), permissions) != 0) {
+        if (chmod(local_path.c_str(), file_header.permissions) != 0) {
             std::cerr << "PUT_FILE: Failed to set permissions on " << file_name << "\n";
             Protocol::sendReply(client_fd, Protocol::ReplyStatus::NACK);
             return;
@@ -214,34 +333,299 @@ void FileServer::handlePutFile(int client_fd, const std::vector<char>& file_data
         std::cout << "PUT_FILE: Skipping chmod on Windows.\n";
     #endif
 
+    // Conditional PUT: Verify the Contents Against the Version the Client Offered
+    Protocol::FileVersion stored;
+    if (offered && (!metadata.version(local_path, file_name, stored) || !stored.sameContents(*offered))) {
+        std::cerr << "PUT_IF_CHANGED: Contents of '" << file_name << "' do not match the offered hash\n";
+        metadata.forget(file_name);
+        Protocol::sendReply(client_fd, Protocol::ReplyStatus::NACK);
+        return;
+    }
+
     // Send ACK to client on success
     Protocol::sendReply(client_fd, Protocol::ReplyStatus::ACK);
     std::cout << "PUT_FILE: Successfully saved file '" << file_name << "'\n";
 }
 
 
-bool FileServer::readFile(const std::string& file_path, std::vector<char>& buffer) {
-    // Create File Stream, Open File
-    std::ifstream file(file_path, std::ios::binary | std::ios::ate);
-    if (!file) return false;
+void FileServer::handleEnumerate(Session& session, const std::string& dir) {
+    // List Every File Below dir with Its Version
+    Protocol::Listing listing;
+    if (!metadata.list(std::filesystem::current_path(), dir, listing)) {
+        std::cerr << "ENUMERATE: Failed to list directory: " << dir << "\n";
+        Protocol::sendReply(session.client_fd, Protocol::ReplyStatus::INVALID);
+        return;
+    }
+
+    // ACK, Listing Length, Listing
+    std::vector<char> body;
+    listing.serialize(body);
+    MessageBuilder message;
+    message.appendUint8(static_cast<uint8_t>(Protocol::ReplyStatus::ACK));
+    message.appendUint32(static_cast<uint32_t>(body.size()));
+    message.appendRef(body.data(), body.size());
+    if (!message.flush(session.client_fd)) {
+        std::cerr << "ENUMERATE: Failed to send listing\n";
+        return;
+    }
+    std::cout << "ENUMERATE: Listed " << listing.entries.size() << " files in '" << dir << "'\n";
+}
+
+
+void FileServer::handleCopy(Session& session, const CommandParser::Command& command) {
+    bool move = command.header.command_id == Protocol::CommandID::MOVE;
+    const char* name = move ? "MOVE" : "COPY";
+    std::filesystem::path src = std::filesystem::current_path() / command.path;
+    std::filesystem::path dst = std::filesystem::current_path() / command.target;
+
+    // Source Must Be a Regular File, and Copying a File onto Itself Would Truncate It
+    std::error_code error;
+    if (!std::filesystem::is_regular_file(src, error) || std::filesystem::equivalent(src, dst, error)) {
+        std::cerr << name << ": Invalid source or destination: " << command.path << " -> " << command.target << "\n";
+        Protocol::sendReply(session.client_fd, Protocol::ReplyStatus::INVALID);
+        return;
+    }
+
+    // The Data Stays on the Server
+    FileCopy::Method method = FileCopy::Method::READ_WRITE;
+    bool renamed = false;
+    bool ok = move ? FileCopy::move(src, dst, method, renamed) : FileCopy::copyPath(src, dst, method);
+    if (!ok) {
+        std::cerr << name << ": Failed to " << (move ? "move " : "copy ") << command.path << " to " << command.target << "\n";
+        Protocol::sendReply(session.client_fd, Protocol::ReplyStatus::NACK);
+        return;
+    }
+
+    // A Rename Keeps Contents and mtime, so the Indexed Version Moves Along
+    if (move) {
+        if (renamed) metadata.rename(command.path, command.target);
+        else metadata.forget(command.path);
+    }
+
+    acknowledgeCommand(session.client_fd);
+    std::cout << name << ": " << command.path << " -> " << command.target << " ("
+              << (renamed ? "rename" : FileCopy::methodName(method)) << ")\n";
+}
+
+
+void FileServer::handleSubscribe(Session& session, const std::string& prefix) {
+    constexpr auto BATCH_WINDOW = std::chrono::milliseconds(50);
+
+    std::shared_ptr<ChangeNotifier::Subscription> subscription = notifier.subscribe(prefix);
+    if (!subscription) {
+        std::cerr << "SUBSCRIBE: Change notification is not available\n";
+        Protocol::sendReply(session.client_fd, Protocol::ReplyStatus::NACK);
+        return;
+    }
+    acknowledgeCommand(session.client_fd);
+    std::cout << "SUBSCRIBE: Watching '" << prefix << "'\n";
+
+    // The Connection Carries Event Batches Until the Client Closes It
+    pollfd fds[2] = {{session.client_fd, POLLIN, 0}, {subscription->fd(), POLLIN, 0}};
+    while (true) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        // Client Closed, Anything It Sends Meanwhile Is Ignored
+        if (fds[0].revents != 0) {
+            char discard[256];
+            if (recv(session.client_fd, discard, sizeof(discard), 0) <= 0) break;
+        }
+
+        // Let a Burst of Changes Settle, Then Send It as One Batch
+        if (fds[1].revents & POLLIN) {
+            std::this_thread::sleep_for(BATCH_WINDOW);
+            Protocol::ChangeBatch batch{subscription->take()};
+            if (batch.events.empty()) continue;
+
+            std::vector<char> body;
+            batch.serialize(body);
+            MessageBuilder message;
+            message.appendRef(body.data(), body.size());
+            if (!message.flush(session.client_fd)) break;
+        }
+    }
+
+    notifier.unsubscribe(subscription);
+    std::cout << "SUBSCRIBE: Stopped watching '" << prefix << "'\n";
+}
+
+
+void FileServer::handleOpenFile(Session& session, const std::string& file_name) {
+    int client_fd = session.client_fd;
+
+    // Descriptors Can Only Be Passed to a Process on This Host
+    if (!LocalSocket::isLocal(client_fd)) {
+        std::cerr << "OPEN_FILE: Not a local connection\n";
+        Protocol::sendReply(client_fd, Protocol::ReplyStatus::NACK);
+        return;
+    }
+
+    // Non-Blocking, so Opening a FIFO Doesn't Wait Forever for a Writer Before the Type Check
+    std::filesystem::path local_path = std::filesystem::current_path() / file_name;
+    int file_fd = open(local_path.c_str(), O_RDONLY | O_NONBLOCK);
+    struct stat st{};
+    if (file_fd < 0 || fstat(file_fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        std::cerr << "OPEN_FILE: Failed to open file: " << file_name << "\n";
+        Protocol::sendReply(client_fd, Protocol::ReplyStatus::INVALID);
+        if (file_fd >= 0) close(file_fd);
+        return;
+    }
+    fcntl(file_fd, F_SETFL, fcntl(file_fd, F_GETFL) & ~O_NONBLOCK); // The client gets an ordinary descriptor
+
+    // ACK Carries the Descriptor, the Client Reads the File Itself
+    char reply = static_cast<char>(Protocol::ReplyStatus::ACK);
+    if (LocalSocket::sendFd(client_fd, file_fd, &reply, 1)) {
+        std::cout << "OPEN_FILE: Passed descriptor for " << file_name << " (" << st.st_size << " bytes)\n";
+    } else {
+        std::cerr << "OPEN_FILE: Failed to pass descriptor\n";
+    }
+    close(file_fd);
+}
+
+
+void FileServer::handleSharedRing(Session& session, const CommandParser::Command& command) {
+    int client_fd = session.client_fd;
+    auto ring = std::make_unique<SharedRing>();
+    if (!LocalSocket::isLocal(client_fd) || !ring->create(Protocol::parse_uint32(command.tail.data()), client_fd)) {
+        std::cerr << "SHARED_RING: Shared memory is not available on this connection\n";
+        Protocol::sendReply(client_fd, Protocol::ReplyStatus::NACK);
+        return;
+    }
+
+    // ACK Carries the Shared Memory and Both Wakeup Descriptors
+    char reply = static_cast<char>(Protocol::ReplyStatus::ACK);
+    if (!LocalSocket::sendFds(client_fd, {ring->memoryFd(), ring->serverEvent(), ring->clientEvent()}, &reply, 1)) {
+        std::cerr << "SHARED_RING: Failed to pass shared memory\n";
+        return;
+    }
+    std::cout << "SHARED_RING: Connection moved to shared memory\n";
+
+    // The Rest of the Connection Runs Through the Rings
+    SharedRingSession(std::move(ring)).run();
+}
+
+
+void FileServer::handleGetSparse(Session& session, const std::string& file_name) {
+    int client_fd = session.client_fd;
+    std::filesystem::path local_path = std::filesystem::current_path() / file_name;
 
-    // Get File Size
-    std::streamsize size = file.tellg();
-    if (size < 0) return false;
+    // Open File and Map Its Data Extents (Non-Blocking, a FIFO Must Not Hang Us)
+    int file_fd = open(local_path.c_str(), O_RDONLY | O_NONBLOCK);
+    struct stat st{};
+    Protocol::ExtentMap map;
+    if (file_fd < 0 || fstat(file_fd, &st) != 0 || !S_ISREG(st.st_mode)
+        || !SparseFile::mapExtents(file_fd, st.st_size, map.extents)) {
+        std::cerr << "GET_SPARSE: Failed to read file: " << file_name << "\n";
+        Protocol::sendReply(client_fd, Protocol::ReplyStatus::INVALID);
+        if (file_fd >= 0) close(file_fd);
+        return;
+    }
 
-    // Read File Contents
-    buffer.resize(static_cast<size_t>(size));
-    file.seekg(0, std::ios::beg);
-    return file.read(buffer.data(), size).good();
+    // ACK, FileHeader and ExtentMap Go Out with the First Quantum of Data
+    Protocol::FileHeader header{static_cast<uint16_t>(st.st_mode & 07777), file_name, static_cast<uint64_t>(st.st_size)};
+    MessageBuilder message;
+    message.appendUint8(static_cast<uint8_t>(Protocol::ReplyStatus::ACK));
+    message.append<Protocol::Schema::FileHeader>(header.permissions, header.path, header.file_size);
+    message.append<Protocol::Schema::Count>(static_cast<uint32_t>(map.extents.size()));
+    for (const Protocol::Extent& extent : map.extents) {
+        message.append<Protocol::Schema::Extent>(extent.offset, extent.length);
+    }
+
+    // Send Only the Data Extents
+    bool sent = map.extents.empty() ? message.flush(client_fd) : true;
+    for (size_t i = 0; sent && i < map.extents.size(); i++) {
+        bool more_after = i + 1 < map.extents.size();
+        sent = sendFileRange(session, file_fd, map.extents[i].offset, map.extents[i].length, message, more_after);
+    }
+    if (sent) {
+        std::cout << "GET_SPARSE: Sent file '" << file_name << "' (" << map.dataSize() << " of "
+                  << header.file_size << " bytes in " << map.extents.size() << " extents)\n";
+    }
+    close(file_fd);
 }
 
 
-bool FileServer::writeFile(const std::string& file_path, const std::vector<char>& buffer) {
-    // Create File Stream, Open File
-    std::ofstream file(file_path, std::ios::binary);
-    if (!file) return false;
+void FileServer::handlePutSparse(Session& session, const std::string& file_name) {
+    int client_fd = session.client_fd;
+    std::filesystem::path local_path = std::filesystem::current_path() / file_name;
+
+    // Receive FileHeader
+    Protocol::FileHeader file_header;
+    while (!session.parser.parseFileHeader(session.ring, file_header)) {
+        if (!fillRing(session)) {
+            std::cerr << "PUT_SPARSE: Failed to receive file header\n";
+            return;
+        }
+    }
 
-    // Write File Contents
-    file.write(buffer.data(), buffer.size());
-    return file.good();
+    std::cout << "PUT_SPARSE command for path: " << file_name
+              << " with permissions: " << std::oct << file_header.permissions
+              << " and file size: " << std::dec << file_header.file_size << ".\n";
+
+    // Receive Extents Directly into the Destination File
+    int file_fd = open(local_path.c_str(), O_WRONLY | O_CREAT, 0644);
+    if (file_fd < 0) {
+        std::cerr << "PUT_SPARSE: Failed to open " << local_path << "\n";
+        Protocol::sendReply(client_fd, Protocol::ReplyStatus::NACK);
+        return;
+    }
+    std::vector<char> pending(session.ring.size());
+    session.ring.read(pending.data(), pending.size());
+    bool received = SparseFile::receive(client_fd, file_fd, file_header.file_size, pending);
+    bool ok = received && fchmod(file_fd, file_header.permissions) == 0;
+    close(file_fd);
+
+    // Bytes Past the Transfer Belong to the Next Command, After a Failed Transfer We Don't Know Where It Ends
+    bool kept = received && session.ring.write(pending.data(), pending.size()) == pending.size();
+
+    if (!ok) {
+        std::cerr << "PUT_SPARSE: Failed to write file to " << local_path << "\n";
+        Protocol::sendReply(client_fd, Protocol::ReplyStatus::NACK);
+    } else {
+        Protocol::sendReply(client_fd, Protocol::ReplyStatus::ACK);
+        std::cout << "PUT_SPARSE: Successfully saved file '" << file_name << "'\n";
+    }
+
+    // The Rest of the Extents, or Commands That Didn't Fit Back, Would Be Read as Commands
+    if (!kept) {
+        std::cerr << "PUT_SPARSE: " << (received ? "Too much data after the transfer" : "Transfer abandoned")
+                  << ", closing connection\n";
+        session.ring.clear();
+        shutdown(client_fd, SHUT_RDWR);
+    }
+}
+
+
+bool FileServer::sendFileRange(Session& session, int file_fd, uint64_t offset, uint64_t length,
+                               MessageBuilder& message, bool more_after) {
+    std::vector<char> chunk;
+    uint64_t done = 0;
+
+    // Nothing to Read, Just Send What the Caller Queued
+    if (length == 0) return message.empty() || message.flush(session.client_fd, more_after);
+
+    while (done < length) {
+        // Wait for Our Turn to Use the Disk and the Network
+        size_t want = static_cast<size_t>(std::min<uint64_t>(scheduler.quantumFor(session.flow), length - done));
+        scheduler.acquire(session.flow, want);
+
+        // Read the Quantum, a Client Slow to Read Must Not Keep the Slot Through the Send
+        chunk.resize(want);
+        ssize_t n = pread(file_fd, chunk.data(), want, static_cast<off_t>(offset + done));
+        scheduler.release(session.flow);
+
+        // Send It Behind Anything Queued, Holding the Segment Open if More Follows
+        bool ok = n > 0;
+        if (ok) {
+            message.appendRef(chunk.data(), n);
+            ok = message.flush(session.client_fd, more_after || done + n < length);
+        }
+
+        if (!ok) return false;
+        done += n;
+    }
+    return true;
 }
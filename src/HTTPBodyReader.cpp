@@ -0,0 +1,73 @@
+#include "HTTPBodyReader.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <string_view>
+#include <sys/socket.h>
+
+// ====================================================================================================
+// Construction
+// ====================================================================================================
+HTTPBodyReader::HTTPBodyReader(int fd, Framing framing, uint64_t length, std::string buffered)
+    : fd{fd}, mode{framing}, remaining{length}, buffer{std::move(buffered)},
+      finished{framing == Framing::NONE || (framing == Framing::LENGTH && length == 0)} {}
+
+// ====================================================================================================
+// Reading
+// ====================================================================================================
+bool HTTPBodyReader::next(std::string& data, bool& content) {
+    data.clear();
+    content = true;
+    if (finished) {
+        return true;
+    }
+
+    // Everything Received Is Handed Out, Wait for More
+    if (position == buffer.size()) {
+        // Never past a known length, the next message on the connection is not ours
+        size_t want = mode == Framing::LENGTH ? static_cast<size_t>(std::min<uint64_t>(PIECE_BYTES, remaining))
+                                              : PIECE_BYTES;
+        buffer.resize(want);
+        position = 0;
+        ssize_t n = recv(fd, buffer.data(), want, 0);
+        buffer.resize(n > 0 ? static_cast<size_t>(n) : 0);
+
+        if (n == 0 && mode == Framing::CLOSE) {
+            finished = true;
+            return true;
+        }
+        if (n <= 0) {
+            std::cerr << "[HTTPBodyReader] Connection ended before the end of the body\n";
+            return false;
+        }
+    }
+
+    // Chunked: One Run of Framing or Data at a Time
+    if (mode == Framing::CHUNKED) {
+        size_t length = decoder.next(std::string_view(buffer).substr(position), content);
+        if (decoder.failed()) {
+            return false;
+        }
+        data.assign(buffer, position, length);
+        position += length;
+        finished = decoder.done();
+        return true;
+    }
+
+    // Length or Until Close: Whatever Was Received, Up to the End of the Body
+    size_t available = buffer.size() - position;
+    size_t length = mode == Framing::LENGTH ? static_cast<size_t>(std::min<uint64_t>(remaining, available)) : available;
+    if (position == 0 && length == buffer.size()) {
+        data.swap(buffer);
+        buffer.clear();
+    } else {
+        data.assign(buffer, position, length);
+        position += length;
+    }
+
+    if (mode == Framing::LENGTH) {
+        remaining -= length;
+        finished = remaining == 0;
+    }
+    return true;
+}
@@ -0,0 +1,566 @@
+#include "HTTPCache.hpp"
+#include "HTTPRequestParser.hpp"
+#include "HTTPUtils.hpp"
+#include "StringUtils.hpp"
+
+#include <algorithm>
+#include <ctime>
+#include <functional>
+#include <iterator>
+#include <sstream>
+#include <unistd.h>
+
+using namespace utils;
+
+namespace {
+    using Seconds = std::chrono::seconds;
+
+    // Statuses a cache may store without explicit freshness (RFC 9110 15.1)
+    bool heuristicallyCacheable(int status) {
+        switch (status) {
+            case 200: case 203: case 204: case 300: case 301: case 308:
+            case 404: case 405: case 410: case 414: case 501:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    std::string trim(std::string_view text) {
+        size_t start = text.find_first_not_of(" \t");
+        if (start == std::string_view::npos) return "";
+        size_t end = text.find_last_not_of(" \t");
+        return std::string(text.substr(start, end - start + 1));
+    }
+
+    /**
+     * Value of a header field, matched at the start of a line only and
+     * limited to the header section. Repeated fields are joined with ", ".
+     */
+    std::string header(const std::string& message, std::string_view name) {
+        size_t end = message.find("\r\n\r\n");
+        if (end == std::string::npos) end = message.size();
+
+        std::string value;
+        size_t line = message.find("\r\n");  // Skip the start line
+        while (line != std::string::npos && line < end) {
+            line += 2;
+            size_t line_end = message.find("\r\n", line);
+            if (line_end == std::string::npos || line_end > end) line_end = end;
+
+            size_t colon = message.find(':', line);
+            if (colon != std::string::npos && colon < line_end && colon - line == name.size() &&
+                toLower(std::string_view(message).substr(line, colon - line)) == toLower(name)) {
+                if (!value.empty()) value += ", ";
+                value += trim(std::string_view(message).substr(colon + 1, line_end - colon - 1));
+            }
+            line = line_end < end ? line_end : std::string::npos;
+        }
+        return value;
+    }
+
+    /**
+     * Cache-Control directives, lower case names, values unquoted ("" if none)
+     */
+    std::unordered_map<std::string, std::string> directives(const std::string& value) {
+        std::unordered_map<std::string, std::string> out;
+        std::stringstream list(value);
+        std::string item;
+        while (std::getline(list, item, ',')) {
+            size_t equals = item.find('=');
+            std::string name = toLower(trim(item.substr(0, equals)));
+            std::string argument = equals == std::string::npos ? "" : trim(item.substr(equals + 1));
+            if (argument.size() >= 2 && argument.front() == '"' && argument.back() == '"') {
+                argument = argument.substr(1, argument.size() - 2);
+            }
+            if (!name.empty()) out.emplace(name, argument);
+        }
+        return out;
+    }
+
+    // Delta-seconds, false if missing or not a number
+    bool seconds(const std::unordered_map<std::string, std::string>& cc, const std::string& name, Seconds& out) {
+        auto it = cc.find(name);
+        if (it == cc.end()) return false;
+        try {
+            out = Seconds(std::max(0L, std::stol(it->second)));
+            return true;
+        } catch (...) {
+            return false;
+        }
+    }
+
+    // IMF-fixdate, eg. "Sun, 06 Nov 1994 08:49:37 GMT"
+    bool parseDate(const std::string& value, HTTPCache::Clock::time_point& out) {
+        std::tm tm{};
+        const char* end = strptime(value.c_str(), "%a, %d %b %Y %H:%M:%S", &tm);
+        if (end == nullptr) return false;
+        out = HTTPCache::Clock::from_time_t(timegm(&tm));
+        return true;
+    }
+}
+
+// ====================================================================================================
+// Construction
+// ====================================================================================================
+HTTPCache::HTTPCache(const Config& config)
+    : config{config}, shard_budget{config.max_bytes / std::max<size_t>(config.shards, 1)} {
+    for (size_t i = 0; i < std::max<size_t>(config.shards, 1); i++) {
+        shards.push_back(std::make_unique<Shard>());
+    }
+
+    if (!config.disk_dir.empty()) {
+        HTTPDiskCache::Config disk_config;
+        disk_config.dir = config.disk_dir;
+        disk_config.max_bytes = config.disk_bytes;
+        disk_config.tag = config.disk_tag;
+        disk = std::make_unique<HTTPDiskCache>(disk_config);
+        if (!disk->ready()) disk.reset();
+    }
+}
+
+std::string HTTPCache::keyFor(const std::string& request, const std::string& host, int port) {
+    // Request target from the request line, absolute-form reduced to its path
+    std::istringstream line(request.substr(0, request.find("\r\n")));
+    std::string method, target;
+    line >> method >> target;
+
+    size_t scheme = target.find("://");
+    if (scheme != std::string::npos) {
+        size_t path = target.find('/', scheme + 3);
+        target = path == std::string::npos ? "/" : target.substr(path);
+    }
+    return toLower(host) + ":" + std::to_string(port) + target;
+}
+
+// ====================================================================================================
+// Lookup
+// ====================================================================================================
+HTTPCache::Lookup HTTPCache::lookup(const std::string& key, const std::string& request) {
+    Lookup lookup;
+    lookups++;
+
+    auto request_cc = directives(header(request, "Cache-Control"));
+    bool only_if_cached = request_cc.count("only-if-cached") > 0;
+
+    // Client's Own Conditional and Range Requests Go to the Origin as They Are
+    bool bypass = request_cc.count("no-store") || !header(request, "If-None-Match").empty() ||
+                  !header(request, "If-Modified-Since").empty() || !header(request, "Range").empty();
+
+    Shard& shard = shardFor(key);
+    std::unique_lock<std::mutex> lock(shard.mutex);
+    auto entry = bypass ? shard.lru.end() : findVariant(shard, key, request);
+
+    // Not in Memory, the Disk Tier May Have It
+    if (entry == shard.lru.end() && !bypass && disk) {
+        lock.unlock();
+        if (lookupDisk(key, request, lookup)) return lookup;
+        lock.lock();
+        entry = findVariant(shard, key, request);
+    }
+
+    if (entry == shard.lru.end()) {
+        misses++;
+        lookup.result = only_if_cached ? Lookup::Result::UNAVAILABLE : Lookup::Result::MISS;
+        return lookup;
+    }
+
+    Seconds age;
+    if (usable(*entry, request, Clock::now(), age)) {
+        shard.lru.splice(shard.lru.begin(), shard.lru, entry);
+        lookup.result = Lookup::Result::HIT;
+        lookup.response = withAge(*entry, age);
+        hits++;
+        bytes_saved += lookup.response.full.size();
+        return lookup;
+    }
+
+    // Stale: Ask the Origin Whether It Still Holds, If There Is Anything to Ask With
+    std::string etag = header(entry->response.headers, "ETag");
+    std::string last_modified = header(entry->response.headers, "Last-Modified");
+    if (only_if_cached || (etag.empty() && last_modified.empty())) {
+        misses++;
+        lookup.result = only_if_cached ? Lookup::Result::UNAVAILABLE : Lookup::Result::MISS;
+        return lookup;
+    }
+
+    lookup.result = Lookup::Result::VALIDATE;
+    lookup.response = entry->response;
+    lookup.request = request;
+    if (!etag.empty()) lookup.request = http_utils::insertHeader(lookup.request, "If-None-Match", etag);
+    if (!last_modified.empty()) lookup.request = http_utils::insertHeader(lookup.request, "If-Modified-Since", last_modified);
+    return lookup;
+}
+
+bool HTTPCache::lookupDisk(const std::string& key, const std::string& request, Lookup& lookup) {
+    HTTPDiskCache::Object object;
+    if (!disk->find(key, object)) return false;
+
+    Entry entry;
+    entry.key = key;
+    entry.vary = std::move(object.vary);
+    entry.response.status_code = object.status_code;
+    entry.response.valid = true;
+    entry.response.delimited = true;
+    entry.response.headers = std::move(object.headers);
+    entry.request_time = object.request_time;
+    entry.response_time = object.response_time;
+
+    bool matches = std::all_of(entry.vary.begin(), entry.vary.end(), [&](const auto& field) {
+        return header(request, field.first) == field.second;
+    });
+
+    // Fresh and Still Cold, or Too Large for Memory Anyway: Headers from Here, the Body Straight from the Slab
+    entry.size = key.size() + entry.response.headers.size() + object.body_length;
+    bool fits = entry.size <= shard_budget;
+    Seconds age;
+    if (matches && (object.hits < config.promote_after || !fits) && usable(entry, request, Clock::now(), age)) {
+        lookup.result = Lookup::Result::HIT;
+        lookup.response = withAge(entry, age);
+        lookup.body_fd = object.fd;
+        lookup.body_offset = object.body_offset;
+        lookup.body_length = object.body_length;
+        hits++;
+        disk_hits++;
+        bytes_saved += lookup.response.full.size() + object.body_length;
+        return true;
+    }
+
+    // Hot, or in Need of Revalidation: Into Memory with It, Sized Before Anything Is Read
+    if (matches && fits && HTTPDiskCache::readBody(object, entry.response.body)) {
+        Shard& shard = shardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        insert(shard, request, std::move(entry));
+        promotions++;
+    }
+    close(object.fd);
+    return false;
+}
+
+bool HTTPCache::revalidated(const std::string& key, const std::string& request,
+                            const HTTPResponseParser::ParsedResponse& response,
+                            HTTPResponseParser::ParsedResponse& stored) {
+    if (response.status_code != 304) {
+        misses++;
+        return false;
+    }
+
+    // Header Fields in the 304 Replace the Stored Ones (RFC 9111 4.3.4)
+    std::string headers = response.headers;
+    size_t line = headers.find("\r\n");
+    while (line != std::string::npos && line + 4 <= headers.size()) {
+        line += 2;
+        size_t line_end = headers.find("\r\n", line);
+        size_t colon = headers.find(':', line);
+        if (line_end == std::string::npos || line_end == line) break;
+        if (colon != std::string::npos && colon < line_end) {
+            std::string name = trim(std::string_view(headers).substr(line, colon - line));
+            std::string lower = toLower(name);
+            if (lower != "content-length" && lower != "transfer-encoding" && lower != "connection" &&
+                lower != "keep-alive" && lower != "age") {
+                stored.headers = http_utils::insertHeader(stored.headers, name, header(headers, name));
+            }
+        }
+        line = line_end;
+    }
+    stored.headers = http_utils::removeHeader(stored.headers, "Age");
+    stored.full = stored.headers + stored.body;
+
+    // Refresh the Entry, Unless It Was Dropped Meanwhile
+    Shard& shard = shardFor(key);
+    Entry refreshed;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto entry = findVariant(shard, key, request);
+        if (entry != shard.lru.end()) {
+            entry->response.headers = stored.headers;
+            entry->request_time = entry->response_time = Clock::now();
+            shard.lru.splice(shard.lru.begin(), shard.lru, entry);
+            if (disk) refreshed = *entry;
+        }
+    }
+    if (!refreshed.key.empty()) writeThrough(refreshed);
+
+    revalidations++;
+    bytes_saved += stored.body.size();
+    return true;
+}
+
+// ====================================================================================================
+// Store
+// ====================================================================================================
+void HTTPCache::store(const std::string& key, const std::string& request,
+                      const HTTPResponseParser::ParsedResponse& response, Clock::time_point request_time) {
+    std::string method = HTTPRequestParser::getMethod(request);
+    Shard& shard = shardFor(key);
+
+    // Unsafe Methods That Succeeded Invalidate the URI (RFC 9111 4.4)
+    if (method != "GET" && method != "HEAD" && method != "OPTIONS" && method != "TRACE") {
+        if (response.status_code < 200 || response.status_code >= 400) return;
+        if (disk) disk->erase(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto variants = shard.index.find(key);
+        while (variants != shard.index.end()) {
+            erase(shard, variants->second.back());
+            variants = shard.index.find(key);
+        }
+        return;
+    }
+    if (method != "GET" || !storable(request, response)) return;
+
+    Entry entry;
+    entry.key = key;
+    entry.request_time = request_time;
+    entry.response_time = Clock::now();
+
+    // Request Headers the Response Varies On Pick the Variant
+    std::stringstream vary(header(response.headers, "Vary"));
+    std::string name;
+    while (std::getline(vary, name, ',')) {
+        name = toLower(trim(name));
+        if (!name.empty()) entry.vary.emplace_back(name, header(request, name));
+    }
+
+    // Hop-by-Hop Fields Belong to the Origin's Connection, Not to the Response
+    entry.response.status_code = response.status_code;
+    entry.response.valid = true;
+    entry.response.delimited = true;
+    entry.response.headers = response.headers;
+    for (const char* field : {"Connection", "Keep-Alive", "Proxy-Connection"}) {
+        entry.response.headers = http_utils::removeHeader(entry.response.headers, field);
+    }
+
+    // A Chunked Body Is Kept Decoded, Served With Its Length Instead
+    if (!header(entry.response.headers, "Transfer-Encoding").empty()) {
+        entry.response.headers = http_utils::removeHeader(entry.response.headers, "Transfer-Encoding");
+        entry.response.headers = http_utils::insertHeader(entry.response.headers, "Content-Length",
+                                                          std::to_string(response.body.size()));
+    }
+    entry.response.body = response.body;
+    entry.size = key.size() + entry.response.headers.size() + entry.response.body.size();
+
+    // Written Through, What Memory Lets Go of Is Still on Disk
+    bool on_disk = writeThrough(entry);
+    if (entry.size > shard_budget) {
+        if (on_disk) stores++;
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    insert(shard, request, std::move(entry));
+    stores++;
+}
+
+bool HTTPCache::writeThrough(const Entry& entry) {
+    if (!disk) return false;
+
+    HTTPDiskCache::Object object;
+    object.vary = entry.vary;
+    object.headers = entry.response.headers;
+    object.status_code = entry.response.status_code;
+    object.request_time = entry.request_time;
+    object.response_time = entry.response_time;
+    return disk->put(entry.key, object, entry.response.body);
+}
+
+size_t HTTPCache::storableBody(const std::string& request, const std::string& response_headers) const {
+    HTTPResponseParser::ParsedResponse response;
+    response.headers = response_headers;
+    response.status_code = HTTPResponseParser::getStatusCode(response_headers);
+    response.valid = true;
+    if (HTTPRequestParser::getMethod(request) != "GET" || !cacheable(request, response)) return 0;
+
+    // Whatever Either Tier Can Hold, Less the Key and Headers Kept with It
+    size_t limit = std::max(shard_budget, disk ? disk->maxObjectBytes() : 0);
+    size_t overhead = HTTPRequestParser::getHeader(request, "Host").size() + request.find("\r\n") + response_headers.size();
+    return limit > overhead ? limit - overhead : 0;
+}
+
+bool HTTPCache::storable(const std::string& request, const HTTPResponseParser::ParsedResponse& response) {
+    // A Body Cut Short Is Not the Response, Nor Is One That Only Ended Because the Connection Did
+    if (!response.delimited) return false;
+    std::string length = header(response.headers, "Content-Length");
+    if (!length.empty() && length != std::to_string(response.body.size())) return false;
+
+    return cacheable(request, response);
+}
+
+bool HTTPCache::cacheable(const std::string& request, const HTTPResponseParser::ParsedResponse& response) {
+    if (!response.valid || response.status_code == 206) return false;
+
+    // Interim Responses and a 304 Are About Another Response, Never One to Store (304 Goes Through revalidated())
+    if (response.status_code < 200 || response.status_code == 304) return false;
+
+    auto request_cc = directives(header(request, "Cache-Control"));
+    auto response_cc = directives(header(response.headers, "Cache-Control"));
+    if (request_cc.count("no-store") || response_cc.count("no-store") || response_cc.count("private")) return false;
+    if (header(response.headers, "Vary").find('*') != std::string::npos) return false;
+
+    // Authorized Responses Only When the Origin Allows Sharing Them (RFC 9111 3.5)
+    bool shareable = response_cc.count("public") || response_cc.count("s-maxage") || response_cc.count("must-revalidate");
+    if (!header(request, "Authorization").empty() && !shareable) return false;
+
+    bool explicit_freshness = response_cc.count("max-age") || response_cc.count("s-maxage") ||
+                              !header(response.headers, "Expires").empty();
+    return explicit_freshness || response_cc.count("public") || heuristicallyCacheable(response.status_code);
+}
+
+// ====================================================================================================
+// Freshness (RFC 9111 4.2)
+// ====================================================================================================
+bool HTTPCache::usable(const Entry& entry, const std::string& request, Clock::time_point now, Seconds& age) {
+    auto request_cc = directives(header(request, "Cache-Control"));
+    bool request_no_cache = request_cc.count("no-cache") ||
+                            (request_cc.empty() && toLower(header(request, "Pragma")).find("no-cache") != std::string::npos);
+
+    // Fresh, and Fresh Enough for What the Request Allows
+    Seconds lifetime = freshnessLifetime(entry);
+    age = currentAge(entry, now);
+    Seconds limit;
+    bool acceptable = age < lifetime;
+    if (seconds(request_cc, "max-age", limit) && age > limit) acceptable = false;
+    if (seconds(request_cc, "min-fresh", limit) && lifetime - age < limit) acceptable = false;
+
+    auto response_cc = directives(header(entry.response.headers, "Cache-Control"));
+    bool must_validate = request_no_cache || response_cc.count("no-cache");
+    return acceptable && !must_validate;
+}
+
+std::chrono::seconds HTTPCache::freshnessLifetime(const Entry& entry) {
+    const std::string& headers = entry.response.headers;
+    auto cc = directives(header(headers, "Cache-Control"));
+
+    Seconds lifetime;
+    if (seconds(cc, "s-maxage", lifetime) || seconds(cc, "max-age", lifetime)) return lifetime;
+
+    Clock::time_point date;
+    if (!parseDate(header(headers, "Date"), date)) date = entry.response_time;
+
+    // Expires Relative to the Origin's Own Clock, an Invalid Date Means Already Expired
+    std::string expires_value = header(headers, "Expires");
+    if (!expires_value.empty()) {
+        Clock::time_point expires;
+        if (!parseDate(expires_value, expires) || expires <= date) return Seconds(0);
+        return std::chrono::duration_cast<Seconds>(expires - date);
+    }
+
+    // Heuristic: a Tenth of the Time Since It Last Changed, at Most a Day
+    Clock::time_point last_modified;
+    if (heuristicallyCacheable(entry.response.status_code) &&
+        parseDate(header(headers, "Last-Modified"), last_modified) && last_modified < date) {
+        return std::min(std::chrono::duration_cast<Seconds>(date - last_modified) / 10, Seconds(24 * 3600));
+    }
+    return Seconds(0);
+}
+
+std::chrono::seconds HTTPCache::currentAge(const Entry& entry, Clock::time_point now) {
+    const std::string& headers = entry.response.headers;
+
+    Seconds age_value(0);
+    try {
+        std::string age = header(headers, "Age");
+        if (!age.empty()) age_value = Seconds(std::max(0L, std::stol(age)));
+    } catch (...) {}
+
+    Clock::time_point date;
+    if (!parseDate(header(headers, "Date"), date)) date = entry.response_time;
+
+    auto apparent_age = std::max(Clock::duration::zero(), entry.response_time - date);
+    auto corrected_age = age_value + (entry.response_time - entry.request_time);
+    auto initial_age = std::max<Clock::duration>(apparent_age, corrected_age);
+    return std::chrono::duration_cast<Seconds>(initial_age + (now - entry.response_time));
+}
+
+HTTPResponseParser::ParsedResponse HTTPCache::withAge(const Entry& entry, std::chrono::seconds age) {
+    HTTPResponseParser::ParsedResponse response = entry.response;
+    response.headers = http_utils::insertHeader(response.headers, "Age", std::to_string(age.count()));
+    response.full = response.headers + response.body;
+    return response;
+}
+
+// ====================================================================================================
+// Shards
+// ====================================================================================================
+HTTPCache::Shard& HTTPCache::shardFor(const std::string& key) {
+    return *shards[std::hash<std::string>{}(key) % shards.size()];
+}
+
+std::list<HTTPCache::Entry>::iterator HTTPCache::findVariant(Shard& shard, const std::string& key,
+                                                             const std::string& request) {
+    auto variants = shard.index.find(key);
+    if (variants == shard.index.end()) return shard.lru.end();
+
+    for (auto entry : variants->second) {
+        bool matches = std::all_of(entry->vary.begin(), entry->vary.end(), [&](const auto& field) {
+            return header(request, field.first) == field.second;
+        });
+        if (matches) return entry;
+    }
+    return shard.lru.end();
+}
+
+void HTTPCache::insert(Shard& shard, const std::string& request, Entry&& entry) {
+    auto existing = findVariant(shard, entry.key, request);
+    if (existing != shard.lru.end()) erase(shard, existing);
+
+    shard.lru.push_front(std::move(entry));
+    shard.index[shard.lru.front().key].push_back(shard.lru.begin());
+    shard.bytes += shard.lru.front().size;
+
+    // Least Recently Used Go First
+    while (shard.bytes > shard_budget && !shard.lru.empty()) {
+        erase(shard, std::prev(shard.lru.end()));
+        evictions++;
+    }
+}
+
+void HTTPCache::erase(Shard& shard, std::list<Entry>::iterator entry) {
+    auto variants = shard.index.find(entry->key);
+    if (variants != shard.index.end()) {
+        auto& list = variants->second;
+        list.erase(std::remove(list.begin(), list.end(), entry), list.end());
+        if (list.empty()) shard.index.erase(variants);
+    }
+    shard.bytes -= entry->size;
+    shard.lru.erase(entry);
+}
+
+// ====================================================================================================
+// Stats
+// ====================================================================================================
+HTTPCache::Stats HTTPCache::stats() const {
+    Stats out;
+    out.lookups = lookups;
+    out.hits = hits;
+    out.disk_hits = disk_hits;
+    out.promotions = promotions;
+    out.revalidated = revalidations;
+    out.misses = misses;
+    out.stores = stores;
+    out.evictions = evictions;
+    out.bytes_saved = bytes_saved;
+    for (const auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        out.bytes_stored += shard->bytes;
+    }
+    if (disk) out.disk_objects = disk->objects();
+    return out;
+}
+
+std::string HTTPCache::report() const {
+    Stats s = stats();
+    double ratio = s.lookups ? 100.0 * static_cast<double>(s.hits + s.revalidated) / static_cast<double>(s.lookups) : 0.0;
+
+    std::ostringstream out;
+    out.setf(std::ios::fixed);
+    out.precision(1);
+    out << "lookups " << s.lookups << ", hits " << s.hits << ", revalidated " << s.revalidated
+        << ", misses " << s.misses << ", hit ratio " << ratio << "%\n"
+        << "stored " << s.stores << " (" << s.bytes_stored << " bytes held), evictions " << s.evictions
+        << ", bytes saved " << s.bytes_saved << "\n";
+    if (disk) {
+        out << "disk: " << s.disk_objects << " objects, hits " << s.disk_hits
+            << ", promoted to memory " << s.promotions << "\n";
+    }
+    return out.str();
+}
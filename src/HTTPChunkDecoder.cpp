@@ -0,0 +1,107 @@
+#include "HTTPChunkDecoder.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+// ====================================================================================================
+// Decoding
+// ====================================================================================================
+size_t HTTPChunkDecoder::next(std::string_view data, bool& content) {
+    // Chunk Data: As Much of It as Is There, Untouched
+    if (state == State::DATA) {
+        content = true;
+        size_t length = static_cast<size_t>(std::min<uint64_t>(size, data.size()));
+        size -= length;
+        if (size == 0) state = State::DATA_CR;
+        return length;
+    }
+
+    // Framing: Up to the Next Chunk Data, or the End of the Body
+    content = false;
+    size_t consumed = 0;
+    while (consumed < data.size() && state != State::DATA && state != State::DONE && state != State::ERROR) {
+        frame(data[consumed++]);
+    }
+
+    if (state == State::ERROR) {
+        std::cerr << "[HTTPChunkDecoder] Invalid chunk framing\n";
+        return 0;
+    }
+    return consumed;
+}
+
+void HTTPChunkDecoder::frame(char c) {
+    switch (state) {
+        case State::SIZE: {
+            int digit = (c >= '0' && c <= '9') ? c - '0'
+                      : (c >= 'a' && c <= 'f') ? c - 'a' + 10
+                      : (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+            if (digit >= 0) {
+                // Sixteen hex digits already say more than any body could hold
+                if (size >> 60) {
+                    state = State::ERROR;
+                    return;
+                }
+                size = size * 16 + static_cast<uint64_t>(digit);
+                has_digits = true;
+            } else if (!has_digits) {
+                state = State::ERROR;
+            } else if (c == ';' || c == ' ' || c == '\t') {
+                state = State::EXTENSION;
+            } else if (c == '\r') {
+                state = State::SIZE_LF;
+            } else if (c == '\n') {
+                endSizeLine();
+            } else {
+                state = State::ERROR;
+            }
+            return;
+        }
+
+        case State::EXTENSION:
+            // Chunk extensions are passed along, not interpreted
+            if (c == '\r') state = State::SIZE_LF;
+            else if (c == '\n') endSizeLine();
+            return;
+
+        case State::SIZE_LF:
+            if (c == '\n') endSizeLine();
+            else state = State::ERROR;
+            return;
+
+        case State::DATA_CR:
+            if (c == '\r') state = State::DATA_LF;
+            else if (c == '\n') state = State::SIZE;
+            else state = State::ERROR;
+            return;
+
+        case State::DATA_LF:
+            state = c == '\n' ? State::SIZE : State::ERROR;
+            return;
+
+        case State::TRAILER:
+            if (c == '\r') state = State::END_LF;
+            else if (c == '\n') state = State::DONE;
+            else state = State::TRAILER_LINE;
+            return;
+
+        case State::TRAILER_LINE:
+            if (c == '\n') state = State::TRAILER;
+            return;
+
+        case State::END_LF:
+            state = c == '\n' ? State::DONE : State::ERROR;
+            return;
+
+        case State::DATA:
+        case State::DONE:
+        case State::ERROR:
+            return;
+    }
+}
+
+void HTTPChunkDecoder::endSizeLine() {
+    // A Zero Size Is the Last Chunk, Trailer Fields May Follow
+    state = size == 0 ? State::TRAILER : State::DATA;
+    has_digits = false;
+}
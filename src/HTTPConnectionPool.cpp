@@ -0,0 +1,92 @@
+#include "HTTPConnectionPool.hpp"
+#include "NetworkUtils.hpp"
+#include "StringUtils.hpp"
+
+#include <cerrno>
+#include <iterator>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// ====================================================================================================
+// Construction
+// ====================================================================================================
+HTTPConnectionPool::HTTPConnectionPool(const Config& config)
+    : config{config} {}
+
+HTTPConnectionPool::~HTTPConnectionPool() {
+    for (auto& [origin, connections] : idle) {
+        for (const Idle& connection : connections) close(connection.fd);
+    }
+}
+
+// ====================================================================================================
+// Acquire / Release
+// ====================================================================================================
+int HTTPConnectionPool::acquire(const std::string& host, int port, bool& reused) {
+    reused = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        prune(Clock::now());
+
+        // Newest first, it is the least likely to have timed out on the server
+        auto it = idle.find(key(host, port));
+        while (it != idle.end() && !it->second.empty()) {
+            Idle connection = it->second.back();
+            it->second.pop_back();
+            idle_count--;
+
+            if (!isStale(connection.fd)) {
+                reused = true;
+                return connection.fd;
+            }
+            close(connection.fd);
+        }
+    }
+
+    return NetworkUtils::connectToHost(host, port);
+}
+
+void HTTPConnectionPool::release(const std::string& host, int port, int fd) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Clock::time_point now = Clock::now();
+    prune(now);
+
+    std::deque<Idle>& connections = idle[key(host, port)];
+    if (connections.size() >= config.max_idle_per_host || idle_count >= config.max_idle_total) {
+        close(fd);
+        return;
+    }
+
+    connections.push_back({fd, now});
+    idle_count++;
+}
+
+// ====================================================================================================
+// Helpers
+// ====================================================================================================
+void HTTPConnectionPool::prune(Clock::time_point now) {
+    for (auto it = idle.begin(); it != idle.end();) {
+        std::deque<Idle>& connections = it->second;
+
+        // Oldest are at the front
+        while (!connections.empty() && now - connections.front().since >= config.idle_timeout) {
+            close(connections.front().fd);
+            connections.pop_front();
+            idle_count--;
+        }
+
+        it = connections.empty() ? idle.erase(it) : std::next(it);
+    }
+}
+
+bool HTTPConnectionPool::isStale(int fd) {
+    // An idle HTTP connection has nothing to read: EOF means closed, data means out of step
+    char byte;
+    ssize_t n = recv(fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+    return !(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+}
+
+std::string HTTPConnectionPool::key(const std::string& host, int port) {
+    // Hostnames are case-insensitive
+    return utils::toLower(host) + ":" + std::to_string(port);
+}
@@ -0,0 +1,388 @@
+#include "HTTPDiskCache.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <iostream>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    constexpr char MAGIC[8] = {'N', 'C', 'H', 'T', 'D', 'I', 'S', 'K'};
+    constexpr uint32_t VERSION = 1;
+    constexpr size_t HEADER_BYTES = 4096;  // Slots start on a page of their own
+
+    int64_t toNanoseconds(HTTPDiskCache::Clock::time_point time) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+    }
+
+    HTTPDiskCache::Clock::time_point fromNanoseconds(int64_t value) {
+        return HTTPDiskCache::Clock::time_point(
+            std::chrono::duration_cast<HTTPDiskCache::Clock::duration>(std::chrono::nanoseconds(value)));
+    }
+
+    // Length-prefixed field of an object's meta section
+    void appendField(std::string& out, std::string_view value) {
+        uint32_t length = static_cast<uint32_t>(value.size());
+        out.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        out.append(value);
+    }
+
+    bool readCount(std::string_view& in, uint32_t& out) {
+        if (in.size() < sizeof(out)) return false;
+        std::memcpy(&out, in.data(), sizeof(out));
+        in.remove_prefix(sizeof(out));
+        return true;
+    }
+
+    bool readField(std::string_view& in, std::string& out) {
+        uint32_t length;
+        if (!readCount(in, length) || in.size() < length) return false;
+        out.assign(in.substr(0, length));
+        in.remove_prefix(length);
+        return true;
+    }
+
+    bool readAt(int fd, char* data, size_t length, uint64_t offset) {
+        size_t done = 0;
+        while (done < length) {
+            ssize_t n = pread(fd, data + done, length - done, static_cast<off_t>(offset + done));
+            if (n <= 0) return false;
+            done += n;
+        }
+        return true;
+    }
+
+    bool writeAt(int fd, const char* data, size_t length, uint64_t offset) {
+        size_t done = 0;
+        while (done < length) {
+            ssize_t n = pwrite(fd, data + done, length - done, static_cast<off_t>(offset + done));
+            if (n <= 0) return false;
+            done += n;
+        }
+        return true;
+    }
+}
+
+// ====================================================================================================
+// Construction
+// ====================================================================================================
+HTTPDiskCache::HTTPDiskCache(const Config& config)
+    : config{config} {
+    auto start = std::chrono::steady_clock::now();
+    if (!open()) return;
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << "[HTTPDiskCache] " << objects() << " objects in " << config.dir << " (" << slabs.size()
+              << " slabs of " << index->slab_bytes << " bytes), ready in " << elapsed.count() << " ms\n";
+}
+
+HTTPDiskCache::~HTTPDiskCache() {
+    if (index != nullptr) munmap(index, map_bytes);
+    if (index_fd >= 0) close(index_fd);
+    for (int fd : slabs) close(fd);
+}
+
+bool HTTPDiskCache::open() {
+    static_assert(sizeof(IndexHeader) <= HEADER_BYTES, "index header outgrew its page");
+
+    std::error_code error;
+    std::filesystem::create_directories(config.dir, error);
+    if (error) {
+        std::cerr << "[HTTPDiskCache] Failed to create cache directory " << config.dir << "\n";
+        return false;
+    }
+
+    size_t slot_count = std::max<size_t>(config.slots, PROBES);
+    size_t slab_count = std::clamp<size_t>(config.max_bytes / std::max<size_t>(config.slab_bytes, 1), 2, MAX_SLABS);
+    map_bytes = HEADER_BYTES + slot_count * sizeof(Slot);
+
+    // An Index of the Right Size Is Mapped as It Is, Anything Else Starts Over
+    std::string index_path = config.dir + "/index";
+    int fd = ::open(index_path.c_str(), O_RDWR | O_CREAT, 0644);
+    struct stat info {};
+    if (fd < 0 || fstat(fd, &info) < 0) {
+        std::cerr << "[HTTPDiskCache] Failed to open " << index_path << ": " << strerror(errno) << "\n";
+        if (fd >= 0) close(fd);
+        return false;
+    }
+
+    // Two Processes Appending to the Same Slabs Would Overwrite Each Other's Objects
+    if (flock(fd, LOCK_EX | LOCK_NB) < 0) {
+        std::cerr << "[HTTPDiskCache] " << config.dir << " is in use by another process\n";
+        close(fd);
+        return false;
+    }
+
+    bool reuse = static_cast<size_t>(info.st_size) == map_bytes;
+    if (!reuse && (ftruncate(fd, 0) < 0 || ftruncate(fd, static_cast<off_t>(map_bytes)) < 0)) {
+        std::cerr << "[HTTPDiskCache] Failed to size " << index_path << ": " << strerror(errno) << "\n";
+        close(fd);
+        return false;
+    }
+
+    void* map = mmap(nullptr, map_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        std::cerr << "[HTTPDiskCache] Failed to map " << index_path << ": " << strerror(errno) << "\n";
+        close(fd);
+        return false;
+    }
+
+    IndexHeader* header = static_cast<IndexHeader*>(map);
+    reuse = reuse && std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0 && header->version == VERSION &&
+            header->slot_count == slot_count && header->slab_count == slab_count &&
+            header->slab_bytes == config.slab_bytes && header->tag == config.tag &&
+            header->current_slab < slab_count && header->write_offset <= config.slab_bytes;
+    if (!reuse) {
+        std::memset(map, 0, map_bytes);
+        std::memcpy(header->magic, MAGIC, sizeof(MAGIC));
+        header->version = VERSION;
+        header->slot_count = static_cast<uint32_t>(slot_count);
+        header->slab_count = static_cast<uint32_t>(slab_count);
+        header->slab_bytes = config.slab_bytes;
+        header->tag = config.tag;
+        std::fill(std::begin(header->generations), std::end(header->generations), 1);
+    }
+
+    index = header;
+    slots = reinterpret_cast<Slot*>(static_cast<char*>(map) + HEADER_BYTES);
+
+    // Slabs Are Only Emptied Along with the Index That Names Their Objects
+    for (size_t i = 0; i < slab_count; i++) {
+        std::string path = slabPath(i);
+        int slab = ::open(path.c_str(), O_RDWR | O_CREAT | (reuse ? 0 : O_TRUNC), 0644);
+        if (slab < 0) {
+            std::cerr << "[HTTPDiskCache] Failed to open " << path << ": " << strerror(errno) << "\n";
+            munmap(map, map_bytes);
+            close(fd);
+            index = nullptr;
+            return false;
+        }
+        slabs.push_back(slab);
+    }
+    index_fd = fd;
+    return true;
+}
+
+// ====================================================================================================
+// Find / Put / Erase
+// ====================================================================================================
+bool HTTPDiskCache::find(const std::string& key, Object& object) {
+    if (!ready()) return false;
+
+    // Copy the Candidates and Hold Their Slabs Open, the Reads Happen Without the Lock
+    uint64_t key_hash = hash(key);
+    std::vector<std::pair<size_t, Slot>> candidates;
+    std::vector<int> fds;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t home = key_hash % index->slot_count;
+        for (size_t i = 0; i < PROBES; i++) {
+            size_t position = (home + i) % index->slot_count;
+            if (!live(slots[position]) || slots[position].hash != key_hash) continue;
+            int fd = dup(slabs[slots[position].slab]);
+            if (fd < 0) continue;
+            candidates.emplace_back(position, slots[position]);
+            fds.push_back(fd);
+        }
+    }
+
+    // The Hash Narrows It Down, the Key Stored with the Object Decides
+    std::string record;
+    size_t found = candidates.size();
+    for (size_t i = 0; i < candidates.size() && found == candidates.size(); i++) {
+        const Slot& candidate = candidates[i].second;
+        record.resize(candidate.meta_length + candidate.header_length);
+        std::string_view meta(record);
+        std::string stored_key;
+        uint32_t fields = 0;
+        if (!readAt(fds[i], record.data(), record.size(), candidate.offset) ||
+            !readField(meta, stored_key) || stored_key != key || !readCount(meta, fields)) {
+            continue;
+        }
+
+        object.vary.clear();
+        for (uint32_t field = 0; field < fields; field++) {
+            std::string name, value;
+            if (!readField(meta, name) || !readField(meta, value)) break;
+            object.vary.emplace_back(std::move(name), std::move(value));
+        }
+        if (object.vary.size() == fields) found = i;
+    }
+    for (size_t i = 0; i < fds.size(); i++) {
+        if (i != found) close(fds[i]);
+    }
+    if (found == candidates.size()) return false;
+
+    const Slot& slot = candidates[found].second;
+    object.fd = fds[found];
+    object.headers = record.substr(slot.meta_length);
+    object.status_code = slot.status_code;
+    object.request_time = fromNanoseconds(slot.request_time);
+    object.response_time = fromNanoseconds(slot.response_time);
+    object.hits = slot.hits + 1;
+    object.body_offset = slot.offset + slot.meta_length + slot.header_length;
+    object.body_length = slot.body_length;
+
+    // Count the Hit Unless the Slot Was Replaced Meanwhile, What Was Read Stays Valid Through object.fd
+    std::lock_guard<std::mutex> lock(mutex);
+    Slot& current = slots[candidates[found].first];
+    if (current.hash == key_hash && current.slab == slot.slab && current.generation == slot.generation &&
+        current.offset == slot.offset) {
+        object.hits = ++current.hits;
+    }
+    return true;
+}
+
+bool HTTPDiskCache::readBody(const Object& object, std::string& body) {
+    body.resize(object.body_length);
+    return readAt(object.fd, body.data(), body.size(), object.body_offset);
+}
+
+bool HTTPDiskCache::put(const std::string& key, const Object& object, const std::string& body) {
+    if (!ready()) return false;
+
+    std::string record;
+    appendField(record, key);
+    uint32_t fields = static_cast<uint32_t>(object.vary.size());
+    record.append(reinterpret_cast<const char*>(&fields), sizeof(fields));
+    for (const auto& [name, value] : object.vary) {
+        appendField(record, name);
+        appendField(record, value);
+    }
+    uint32_t meta_length = static_cast<uint32_t>(record.size());
+    record += object.headers;
+
+    uint64_t size = record.size() + body.size();
+    if (size > index->slab_bytes) return false;
+
+    // Reserve the Range Under the Lock, Write It Without
+    uint32_t slab;
+    uint32_t generation;
+    uint64_t offset;
+    int fd;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (index->write_offset + size > index->slab_bytes && !rotate()) return false;
+        slab = index->current_slab;
+        generation = index->generations[slab];
+        offset = index->write_offset;
+        fd = dup(slabs[slab]);
+        if (fd < 0) return false;
+        index->write_offset += size;
+    }
+
+    // Object First, the Slot Naming It Only Once It Is All There
+    bool written = writeAt(fd, record.data(), record.size(), offset) &&
+                   writeAt(fd, body.data(), body.size(), offset + record.size());
+    if (!written) {
+        std::cerr << "[HTTPDiskCache] Failed to write to " << slabPath(slab) << ": " << strerror(errno) << "\n";
+    }
+    close(fd);
+    if (!written) return false;
+
+    // The Ring May Have Come Round to the Slab While Writing, the Object Is Gone Then
+    std::lock_guard<std::mutex> lock(mutex);
+    if (index->generations[slab] != generation) return false;
+
+    // Replace What the Key Had, Else Take a Free Slot, Else the Oldest Nearby
+    uint64_t key_hash = hash(key);
+    size_t home = key_hash % index->slot_count;
+    Slot* target = nullptr;
+    for (size_t i = 0; i < PROBES; i++) {
+        Slot& candidate = slots[(home + i) % index->slot_count];
+        if (live(candidate) && candidate.hash == key_hash) {
+            target = &candidate;
+            break;
+        }
+        if (target != nullptr && !live(*target)) continue;
+        if (target == nullptr || !live(candidate) || candidate.response_time < target->response_time) {
+            target = &candidate;
+        }
+    }
+
+    Slot& entry = *target;
+    entry.slab = slab;
+    entry.generation = generation;
+    entry.offset = offset;
+    entry.meta_length = meta_length;
+    entry.header_length = static_cast<uint32_t>(object.headers.size());
+    entry.body_length = body.size();
+    entry.request_time = toNanoseconds(object.request_time);
+    entry.response_time = toNanoseconds(object.response_time);
+    entry.hits = 0;
+    entry.status_code = object.status_code;
+    entry.hash = key_hash;
+    return true;
+}
+
+void HTTPDiskCache::erase(const std::string& key) {
+    if (!ready()) return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t key_hash = hash(key);
+    size_t home = key_hash % index->slot_count;
+    for (size_t i = 0; i < PROBES; i++) {
+        Slot& candidate = slots[(home + i) % index->slot_count];
+        if (candidate.hash == key_hash) candidate.hash = 0;
+    }
+}
+
+size_t HTTPDiskCache::objects() {
+    if (!ready()) return 0;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    return std::count_if(slots, slots + index->slot_count, [this](const Slot& slot) { return live(slot); });
+}
+
+// ====================================================================================================
+// Helpers
+// ====================================================================================================
+bool HTTPDiskCache::live(const Slot& slot) const {
+    if (slot.hash == 0 || slot.slab >= index->slab_count || slot.generation != index->generations[slot.slab]) {
+        return false;
+    }
+
+    // The Index Is a File Anyone Could Have Written, Lengths Are Checked Before They Size a Read
+    uint64_t room = index->slab_bytes;
+    if (slot.offset > room) return false;
+    room -= slot.offset;
+    if (slot.meta_length > room || slot.header_length > room - slot.meta_length) return false;
+    room -= uint64_t{slot.meta_length} + slot.header_length;
+    return slot.body_length <= room;
+}
+
+bool HTTPDiskCache::rotate() {
+    uint32_t next = (index->current_slab + 1) % index->slab_count;
+
+    // Invalidate Before Replacing, Readers Keep the Old File Through Their Descriptors
+    if (++index->generations[next] == 0) index->generations[next] = 1;
+    index->current_slab = next;
+    index->write_offset = 0;
+
+    std::string path = slabPath(next);
+    close(slabs[next]);
+    unlink(path.c_str());
+    slabs[next] = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (slabs[next] < 0) {
+        std::cerr << "[HTTPDiskCache] Failed to recreate " << path << ": " << strerror(errno) << "\n";
+        return false;
+    }
+    return true;
+}
+
+std::string HTTPDiskCache::slabPath(size_t slab) const {
+    return config.dir + "/slab-" + std::to_string(slab);
+}
+
+uint64_t HTTPDiskCache::hash(std::string_view data) {
+    uint64_t value = 14695981039346656037ULL;
+    for (unsigned char c : data) {
+        value ^= c;
+        value *= 1099511628211ULL;
+    }
+    return value == 0 ? 1 : value;
+}
@@ -5,6 +5,7 @@
 #include "HTTPSTunnel.hpp"
 #include "NetworkUtils.hpp"
 #include "HTTPUtils.hpp"
+#include "StringUtils.hpp"
 
 #include <unistd.h>
 #include <iostream>
@@ -12,8 +13,9 @@
 // ====================================================================================================
 // Constructor
 // ====================================================================================================
-HTTPProxyServer::HTTPProxyServer(int port, const std::string& forbidden_file) 
-    : BaseServer(port), filter(forbidden_file) {
+HTTPProxyServer::HTTPProxyServer(int port, const std::string& forbidden_file, const std::string& cache_dir)
+    : BaseServer(port), filter(forbidden_file), upstreams(HTTPConnectionPool::Config{}),
+      cache(cacheConfig(cache_dir)) {
     
     if (filter.isEmpty()) {
         std::cerr << "[HTTPProxyServer] Warning: No forbidden words loaded.\n";
@@ -24,21 +26,32 @@ HTTPProxyServer::HTTPProxyServer(int port, const std::string& forbidden_file)
 // Main Request Handler
 // ====================================================================================================
 void HTTPProxyServer::handleRequest(int client_fd) {
+    std::string leftover;  // Start of a pipelined next request
+
     while (true) {
         // -------------------------------------------------------
-        // STEP 1: Read and parse client request
+        // STEP 1: Read and parse client request head, the body
+        //         (if any) is forwarded as it arrives in STEP 7
         // -------------------------------------------------------
-        std::string request = HTTPRequestParser::readRequest(client_fd);
-        if (request.empty()) {
+        HTTPRequestParser::Stream incoming(client_fd, std::move(leftover));
+        if (!incoming.readHead()) {
             return;  // Client disconnected
         }
+        const std::string& request = incoming.head();
 
         std::cout << "[Proxy] Received " 
                   << HTTPRequestParser::getMethod(request) 
                   << " request\n";
 
+        // Where the body ends is unclear, nothing after this head can be trusted either
+        if (incoming.badFraming()) {
+            std::cerr << "[Proxy] Conflicting or malformed Content-Length / Transfer-Encoding\n";
+            NetworkUtils::sendData(client_fd, ErrorResponseBuilder::build400BadRequest("Invalid message framing"));
+            return;
+        }
+
         // -------------------------------------------------------
-        // STEP 2: Check for forbidden words in request
+        // STEP 2: Check for forbidden words in request head
         // -------------------------------------------------------
         std::vector<std::string> matches;
         if (filter.containsForbiddenContent(request, matches)) {
@@ -49,6 +62,14 @@ void HTTPProxyServer::handleRequest(int client_fd) {
             return;
         }
 
+        // Cache statistics, asked of the proxy itself
+        if (isStatsRequest(request)) {
+            std::string report = cache.report();
+            NetworkUtils::sendData(client_fd, "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: " +
+                                   std::to_string(report.size()) + "\r\nConnection: close\r\n\r\n" + report);
+            return;
+        }
+
         // -------------------------------------------------------
         // STEP 3: Parse destination host and port
         // -------------------------------------------------------
@@ -65,89 +86,313 @@ void HTTPProxyServer::handleRequest(int client_fd) {
         // STEP 4: Handle CONNECT method (HTTPS tunnel)
         // -------------------------------------------------------
         if (HTTPRequestParser::isConnectRequest(request)) {
-            if (!HTTPSTunnel::establish(client_fd, dest.host, dest.port)) {
+            if (HTTPSTunnel::establish(client_fd, dest.host, dest.port)) {
+                releaseClient();  // The relay engine owns the connection now
+            } else {
                 NetworkUtils::sendData(client_fd, ErrorResponseBuilder::build502BadGateway(
                     "Could not establish tunnel to " + dest.host));
             }
-            return;  // Tunnel handles everything, then closes
-        }
-
-        // -------------------------------------------------------
-        // STEP 5: Connect to destination server
-        // -------------------------------------------------------
-        int server_fd = NetworkUtils::connectToHost(dest.host, dest.port);
-        if (server_fd < 0) {
-            std::cerr << "[Proxy] Failed to connect to " << dest.host << "\n";
-            NetworkUtils::sendData(client_fd, ErrorResponseBuilder::build502BadGateway(
-                "Could not connect to " + dest.host));
             return;
         }
 
         // -------------------------------------------------------
-        // STEP 6: Remove Accept-Encoding header to prevent compressed responses
+        // STEP 5: Remove Accept-Encoding header to prevent compressed responses,
+        //         ask the server to keep the connection for the next request
         // -------------------------------------------------------
         std::string modified_request = http_utils::removeHeader(request, "Accept-Encoding");
+        modified_request = http_utils::removeHeader(modified_request, "Proxy-Connection");
+        modified_request = http_utils::insertHeader(modified_request, "Connection", "keep-alive");
+
+        // The proxy takes the body whatever the server would say, so it asks the client for it itself
+        if (incoming.hasBody() && utils::toLower(HTTPRequestParser::getHeader(request, "Expect")) == "100-continue") {
+            modified_request = http_utils::removeHeader(modified_request, "Expect");
+            NetworkUtils::sendData(client_fd, "HTTP/1.1 100 Continue\r\n\r\n");
+        }
 
         // -------------------------------------------------------
-        // STEP 7: Forward request to server
+        // STEP 6: Answer from the cache when a fresh response is stored
         // -------------------------------------------------------
-        if (!NetworkUtils::sendData(server_fd, modified_request)) {
-            std::cerr << "[Proxy] Failed to send request to server\n";
-            close(server_fd);
+        // The cache sees the request as the server does, so Vary matches what the server was sent
+        std::string method = HTTPRequestParser::getMethod(request);
+        std::string cache_key = HTTPCache::keyFor(modified_request, dest.host, dest.port);
+        HTTPCache::Lookup cached;
+        if (method == "GET") cached = cache.lookup(cache_key, modified_request);
+
+        if (cached.result == HTTPCache::Lookup::Result::UNAVAILABLE) {
+            std::cout << "[Proxy] Not cached, only-if-cached request refused\n";
+            NetworkUtils::sendData(client_fd, ErrorResponseBuilder::build504GatewayTimeout(
+                "No stored response for this request"));
             return;
         }
 
         // -------------------------------------------------------
-        // STEP 8: Read and parse server response
+        // STEP 7: Otherwise forward request over a pooled connection to the
+        //         destination (or a new one), the body filtered as it
+        //         streams through, and read the response headers
         // -------------------------------------------------------
-        auto response = HTTPResponseParser::readResponse(server_fd);
-        
-        if (!response.valid || response.full.empty()) {
-            std::cerr << "[Proxy] Invalid or empty response from server\n";
+        bool head_request = method == "HEAD";
+        bool validating = cached.result == HTTPCache::Lookup::Result::VALIDATE;
+        const std::string& outgoing = validating ? cached.request : modified_request;
+        HTTPCache::Clock::time_point request_time = HTTPCache::Clock::now();
+        HTTPResponseParser::Stream stream;
+        int server_fd = -1;
+
+        ContentFilter::Scanner body_scanner(filter);
+        std::string replay;      // Body bytes sent so far, for a retry on a fresh connection
+        bool replayable = true;  // Until they outgrow what is worth keeping
+
+        for (int attempt = 0; attempt < 2 && cached.result != HTTPCache::Lookup::Result::HIT; attempt++) {
+            bool reused = false;
+            server_fd = upstreams.acquire(dest.host, dest.port, reused);
+            if (server_fd < 0) break;
+            if (reused) std::cout << "[Proxy] Reusing connection to " << dest.host << ":" << dest.port << "\n";
+
+            stream = HTTPResponseParser::Stream(server_fd, head_request);
+            ForwardResult sent = forwardRequest(client_fd, server_fd, outgoing, incoming, body_scanner, replay, replayable);
+            if (sent == ForwardResult::COMPLETE && stream.readHeaders()) break;
+
+            // Blocked or the client went away: the server has a partial request, the connection is spent
             close(server_fd);
+            server_fd = -1;
+            if (sent == ForwardResult::BLOCKED || sent == ForwardResult::CUT_SHORT) return;
+
+            // A pooled connection may have been closed by the server as we sent, try once on a fresh one
+            if (!reused || !isIdempotent(method) || !replayable) break;
+            std::cout << "[Proxy] Pooled connection failed, retrying on a new one\n";
+        }
+
+        HTTPResponseParser::ParsedResponse response;
+        if (cached.result == HTTPCache::Lookup::Result::HIT) {
+            response = cached.response;
+            std::cout << "[Proxy] Served from cache\n";
+        } else if (server_fd < 0) {
+            std::cerr << "[Proxy] No usable response from " << dest.host << "\n";
+            NetworkUtils::sendData(client_fd, ErrorResponseBuilder::build502BadGateway(
+                "Could not connect to " + dest.host));
             return;
+        } else {
+            response.headers = stream.headers();
+            response.status_code = stream.statusCode();
+            response.valid = true;
         }
 
         std::cout << "[Proxy] Response status: " << response.status_code << "\n";
 
-        // -------------------------------------------------------
-        // STEP 9: Check for forbidden words in response body
-        // -------------------------------------------------------
-        matches.clear();
-        if (filter.containsForbiddenContent(response.body, matches)) {
-            std::cout << "[HTTPProxyServer] Response blocked (forbidden content: ";
-            for (auto i : matches) std::cout << i << ", ";
-            std::cout << ")\n";
-            NetworkUtils::sendData(client_fd, ErrorResponseBuilder::build503ServiceUnavailable(matches));
-            close(server_fd);
-            return;
+        // The server connection can carry another request once its final response ended cleanly
+        auto finishServer = [&]() {
+            if (server_fd < 0) return;
+            if (stream.statusCode() >= 200 && stream.delimited() && HTTPResponseParser::shouldKeepAlive(stream.headers())) {
+                upstreams.release(dest.host, dest.port, server_fd);
+            } else {
+                close(server_fd);
+            }
+            server_fd = -1;
+        };
+
+        // A 304 to our validators means the stored response still holds
+        bool from_cache = cached.result == HTTPCache::Lookup::Result::HIT;
+        if (validating && cache.revalidated(cache_key, modified_request, response, cached.response)) {
+            response = cached.response;
+            from_cache = true;
+            std::cout << "[Proxy] Revalidated cached response\n";
         }
 
-        // -------------------------------------------------------
-        // STEP 10: Forward clean response to client
-        // -------------------------------------------------------
-        if (!NetworkUtils::sendData(client_fd, response.full)) {
-            std::cerr << "[Proxy] Failed to send response to client\n";
-            close(server_fd);
-            return;
+        if (from_cache) {
+            // -------------------------------------------------------
+            // STEP 8: Check for forbidden words in the stored body
+            // -------------------------------------------------------
+            matches.clear();
+            if (filter.containsForbiddenContent(response.body, matches)) {
+                std::cout << "[HTTPProxyServer] Response blocked (forbidden content: ";
+                for (auto i : matches) std::cout << i << ", ";
+                std::cout << ")\n";
+                NetworkUtils::sendData(client_fd, ErrorResponseBuilder::build503ServiceUnavailable(matches));
+                finishServer();
+                if (cached.body_fd >= 0) close(cached.body_fd);
+                return;
+            }
+
+            // -------------------------------------------------------
+            // STEP 9: Forward the stored response to client
+            // -------------------------------------------------------
+            finishServer();
+
+            // A body kept on disk follows its headers straight from the slab file
+            bool sent = NetworkUtils::sendData(client_fd, response.full);
+            if (cached.body_fd >= 0) {
+                sent = sent && NetworkUtils::sendFile(client_fd, cached.body_fd, cached.body_offset, cached.body_length);
+                close(cached.body_fd);
+            }
+            if (!sent) {
+                std::cerr << "[Proxy] Failed to send response to client\n";
+                return;
+            }
+        } else {
+            // -------------------------------------------------------
+            // STEP 8-9: Forward the body as it arrives, filtered on the way,
+            //           keeping a copy when the cache may store it
+            // -------------------------------------------------------
+            size_t body_limit = method == "GET" ? cache.storableBody(modified_request, response.headers) : 0;
+            bool body_kept = false;
+            ForwardResult result = forwardResponse(client_fd, stream, response.body, body_limit, body_kept);
+            finishServer();
+            if (result != ForwardResult::COMPLETE) {
+                if (result != ForwardResult::BLOCKED) std::cerr << "[Proxy] Failed to forward response to client\n";
+                return;
+            }
+
+            // Unsafe methods invalidate whatever their response, a GET is stored only whole
+            response.delimited = stream.delimited();
+            if (method != "GET" || body_kept) cache.store(cache_key, modified_request, response, request_time);
         }
 
         std::cout << "[Proxy] Response forwarded successfully\n";
 
         // -------------------------------------------------------
-        // STEP 11: Determine if connection should persist
+        // STEP 10: Determine if client connection should persist
         // -------------------------------------------------------
         bool request_keep_alive = HTTPRequestParser::shouldKeepAlive(request);
         bool response_keep_alive = HTTPResponseParser::shouldKeepAlive(response.headers);
 
-        close(server_fd);  // Always close server connection
-
-        if (!request_keep_alive || !response_keep_alive) {
+        // A body that ended with the server's connection can only end the same way for the client,
+        // and a request body left unread (answered from the cache) leaves the next request unfindable
+        if (!request_keep_alive || !response_keep_alive || (!from_cache && !stream.framed()) || !incoming.done()) {
             std::cout << "[Proxy] Closing connection\n";
             return;
         }
+        leftover = incoming.leftover();
 
         std::cout << "[Proxy] Keeping connection alive for next request\n";
         // Loop continues to handle next request from same client
     }
-}
\ No newline at end of file
+}
+
+// ====================================================================================================
+// Streaming
+// ====================================================================================================
+HTTPProxyServer::ForwardResult HTTPProxyServer::forwardRequest(int client_fd, int server_fd, const std::string& head,
+                                                               HTTPRequestParser::Stream& incoming,
+                                                               ContentFilter::Scanner& scanner,
+                                                               std::string& replay, bool& replayable) {
+    // A retry starts over with what the failed connection was sent
+    std::string clean = head + replay;
+    std::vector<std::string> matches;
+    std::string data;
+    bool content;
+
+    while (!incoming.done()) {
+        if (!incoming.next(data, content)) {
+            return ForwardResult::CUT_SHORT;
+        }
+
+        // Chunk framing passes through as it is, only what it carries is scanned
+        size_t released = clean.size();
+        if (!content) {
+            scanner.pass(data, clean);
+        } else if (scanner.feed(data, clean, matches)) {
+            std::cout << "[HTTPProxyServer] Request blocked (forbidden content: ";
+            for (auto i : matches) std::cout << i << ", ";
+            std::cout << ")\n";
+            NetworkUtils::sendData(client_fd, ErrorResponseBuilder::build403Forbidden(matches));
+            return ForwardResult::BLOCKED;
+        }
+        if (incoming.done()) scanner.finish(clean);
+
+        if (replayable && replay.size() + clean.size() - released <= REPLAY_BYTES) {
+            replay.append(clean, released, std::string::npos);
+        } else {
+            replayable = false;
+            std::string().swap(replay);
+        }
+
+        // The head waits for the first piece to be scanned, so an early match never reaches the server
+        if (!NetworkUtils::sendData(server_fd, clean)) return ForwardResult::FAILED;
+        clean.clear();
+    }
+
+    // No body left to read
+    if (!clean.empty() && !NetworkUtils::sendData(server_fd, clean)) return ForwardResult::FAILED;
+    return ForwardResult::COMPLETE;
+}
+
+HTTPProxyServer::ForwardResult HTTPProxyServer::forwardResponse(int client_fd, HTTPResponseParser::Stream& stream,
+                                                                std::string& body, size_t body_limit,
+                                                                bool& body_kept) {
+    ContentFilter::Scanner scanner(filter);
+    std::vector<std::string> matches;
+    std::string data, clean;
+    bool content;
+    bool headers_sent = false;
+
+    body.clear();
+    body_kept = body_limit > 0;
+
+    while (!stream.done()) {
+        if (!stream.next(data, content)) {
+            // Nothing sent yet, the client can still be told
+            if (!headers_sent) {
+                NetworkUtils::sendData(client_fd, ErrorResponseBuilder::build502BadGateway("Response cut short"));
+            }
+            return ForwardResult::CUT_SHORT;
+        }
+
+        // A copy of the content for the cache, dropped once it outgrows what the cache would take
+        if (content && body_kept && body.size() + data.size() > body_limit) {
+            body_kept = false;
+            std::string().swap(body);
+        }
+        if (content && body_kept) body += data;
+
+        // Chunk framing passes through as it is, only what it carries is scanned
+        if (!content) {
+            scanner.pass(data, clean);
+        } else if (scanner.feed(data, clean, matches)) {
+            std::cout << "[HTTPProxyServer] Response blocked (forbidden content: ";
+            for (auto i : matches) std::cout << i << ", ";
+            std::cout << ")\n";
+
+            // Once the headers are out, the only way to stop is to cut the response off
+            if (!headers_sent) {
+                NetworkUtils::sendData(client_fd, ErrorResponseBuilder::build503ServiceUnavailable(matches));
+            }
+            return ForwardResult::BLOCKED;
+        }
+        if (stream.done()) scanner.finish(clean);
+
+        // The headers wait for the first content to be scanned, so an early match still gets a proper error page
+        if (!headers_sent && !content && !stream.done()) continue;
+        if (!headers_sent) {
+            clean.insert(0, stream.headers());
+            headers_sent = true;
+        }
+        if (!clean.empty() && !NetworkUtils::sendData(client_fd, clean)) return ForwardResult::FAILED;
+        clean.clear();
+    }
+
+    // No body at all
+    if (!headers_sent && !NetworkUtils::sendData(client_fd, stream.headers())) return ForwardResult::FAILED;
+    return ForwardResult::COMPLETE;
+}
+
+// ====================================================================================================
+// Helpers
+// ====================================================================================================
+bool HTTPProxyServer::isIdempotent(const std::string& method) {
+    return method == "GET" || method == "HEAD" || method == "OPTIONS" || method == "TRACE" ||
+           method == "PUT" || method == "DELETE";
+}
+
+HTTPCache::Config HTTPProxyServer::cacheConfig(const std::string& cache_dir) const {
+    HTTPCache::Config config;
+    config.disk_dir = cache_dir;
+
+    // Stored bodies were checked against these words, other words mean checking them again
+    std::string words;
+    for (const std::string& word : filter.getForbiddenWords()) words += word + "\n";
+    config.disk_tag = HTTPDiskCache::hash(words);
+    return config;
+}
+
+bool HTTPProxyServer::isStatsRequest(const std::string& request) {
+    return request.rfind("GET /cache-stats ", 0) == 0;
+}
@@ -3,50 +3,22 @@
 #include <algorithm>
 #include <cctype>
 #include <sstream>
-#include <iostream>
 #include "StringUtils.hpp"
 
 using namespace utils;
 
+namespace {
+    std::string trim(const std::string& value) {
+        size_t start = value.find_first_not_of(" \t");
+        if (start == std::string::npos) return "";
+        return value.substr(start, value.find_last_not_of(" \t") - start + 1);
+    }
+}
+
 // ============================================================================
 // Public Methods
 // ============================================================================
 
-std::string HTTPRequestParser::readRequest(int client_fd) {
-    std::string headers;
-    if (!readHeaders(client_fd, headers)) {
-        return "";  // Connection error
-    }
-
-    // Check if request has a body (Content-Length header)
-    size_t content_length = parseContentLength(headers);
-    
-    if (content_length == 0) {
-        // No body (typical for GET, HEAD, CONNECT)
-        return headers;
-    }
-
-    // Calculate how much of the body we already received with headers
-    size_t header_end = headers.find("\r\n\r\n");
-    size_t already_have = headers.size() - (header_end + 4);
-
-    if (already_have >= content_length) {
-        // Already have complete body
-        return headers;
-    }
-
-    // Read remaining body
-    size_t remaining = content_length - already_have;
-    std::string body = readExact(client_fd, remaining);
-    
-    if (body.size() != remaining) {
-        std::cerr << "[HTTPRequestParser] Incomplete request body\n";
-        return "";
-    }
-
-    return headers + body;
-}
-
 HTTPRequestParser::Destination HTTPRequestParser::parseDestination(const std::string& request) {
     Destination dest;
     dest.port = 80;  // Default HTTP port
@@ -160,60 +132,101 @@ bool HTTPRequestParser::shouldKeepAlive(const std::string& request) {
 }
 
 // ============================================================================
-// Private Helper Methods
+// Stream
 // ============================================================================
 
-bool HTTPRequestParser::readHeaders(int client_fd, std::string& headers) {
-    headers.clear();
+HTTPRequestParser::Stream::Stream(int client_fd, std::string buffered)
+    : fd(client_fd), buffered(std::move(buffered)) {}
+
+bool HTTPRequestParser::Stream::readHead() {
     char buf[8192];
+    size_t searched = 0;
+
+    // Read until we have the complete head (ending with \r\n\r\n)
+    size_t head_end;
+    while ((head_end = buffered.find("\r\n\r\n", searched)) == std::string::npos) {
+        searched = buffered.size() >= 3 ? buffered.size() - 3 : 0;
 
-    while (true) {
-        ssize_t n = recv(client_fd, buf, sizeof(buf), 0);
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
         if (n <= 0) {
             return false;  // Connection closed or error
         }
+        buffered.append(buf, n);
+    }
 
-        headers.append(buf, n);
-
-        // Check if we have complete headers
-        if (headers.find("\r\n\r\n") != std::string::npos) {
-            return true;
-        }
+    head_section = buffered.substr(0, head_end + 4);
+    std::string rest = buffered.substr(head_end + 4);
+    buffered.clear();
+
+    // A body the server could delimit differently would let a second request hide inside it,
+    // so framing that is not clear-cut is refused rather than forwarded (RFC 9112 6.3)
+    HTTPBodyReader::Framing framing;
+    size_t content_length;
+    if (!parseFraming(head_section, framing, content_length)) {
+        bad_framing = true;
+        return true;
     }
+    body = HTTPBodyReader(fd, framing, content_length, std::move(rest));
+    return true;
 }
 
-std::string HTTPRequestParser::readExact(int fd, size_t n) {
-    std::string result;
-    result.reserve(n);
-    
-    char buf[8192];
-    size_t total = 0;
-
-    while (total < n) {
-        size_t to_read = std::min(sizeof(buf), n - total);
-        ssize_t bytes = recv(fd, buf, to_read, 0);
+// ============================================================================
+// Private Helper Methods
+// ============================================================================
 
-        if (bytes <= 0) {
-            return result;  // Partial read or error
+bool HTTPRequestParser::parseFraming(const std::string& headers, HTTPBodyReader::Framing& framing,
+                                     size_t& content_length) {
+    framing = HTTPBodyReader::Framing::NONE;
+    content_length = 0;
+
+    bool has_length = false;
+    bool has_encoding = false;
+    std::string codings;
+
+    // Each field line after the request line, names compared whole
+    size_t pos = headers.find("\r\n");
+    while (pos != std::string::npos) {
+        pos += 2;
+        size_t end = headers.find("\r\n", pos);
+        if (end == std::string::npos || end == pos) break;
+        std::string line = headers.substr(pos, end - pos);
+        pos = end;
+
+        // A folded line could carry on a framing field, and none is allowed in a request (RFC 9112 5.2)
+        if (line[0] == ' ' || line[0] == '\t') return false;
+
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) continue;
+        std::string name = toLower(line.substr(0, colon));
+        std::string value = trim(line.substr(colon + 1));
+
+        // "Content-Length :" is a name some servers trim and others don't (RFC 9112 5.1)
+        std::string bare = trim(name);
+        if ((bare == "content-length" || bare == "transfer-encoding") && bare != name) return false;
+
+        if (name == "transfer-encoding") {
+            codings += (has_encoding ? "," : "") + toLower(value);
+            has_encoding = true;
+        } else if (name == "content-length") {
+            if (value.empty() || value.size() > 19 || value.find_first_not_of("0123456789") != std::string::npos) {
+                return false;
+            }
+            size_t length = static_cast<size_t>(std::stoull(value));
+            if (has_length && length != content_length) return false;
+            content_length = length;
+            has_length = true;
         }
-
-        result.append(buf, bytes);
-        total += bytes;
     }
 
-    return result;
-}
-
-size_t HTTPRequestParser::parseContentLength(const std::string& headers) {
-    std::string value = getHeader(headers, "Content-Length");
-    
-    if (value.empty()) {
-        return 0;
+    // Chunked must be the final coding, and a Content-Length beside it is a smuggling attempt
+    if (has_encoding) {
+        size_t last = codings.rfind(',');
+        std::string final_coding = trim(last == std::string::npos ? codings : codings.substr(last + 1));
+        if (has_length || final_coding != "chunked") return false;
+        framing = HTTPBodyReader::Framing::CHUNKED;
+        return true;
     }
 
-    try {
-        return static_cast<size_t>(std::stoul(value));
-    } catch (...) {
-        return 0;
-    }
+    if (content_length > 0) framing = HTTPBodyReader::Framing::LENGTH;
+    return true;
 }
@@ -2,10 +2,7 @@
 #include <sys/socket.h>
 #include <algorithm>
 #include <cctype>
-#include <iostream>
-#include <sstream>
 #include "StringUtils.hpp"
-#include "HTTPUtils.hpp"
 
 using namespace utils;
 
@@ -13,56 +10,6 @@ using namespace utils;
 // Public Methods
 // ============================================================================
 
-HTTPResponseParser::ParsedResponse HTTPResponseParser::readResponse(int server_fd) {
-    ParsedResponse response;
-    
-    // Step 1: Read headers with overflow handling
-    std::string overflow;
-    if (!readHeaders(server_fd, response.headers, overflow)) {
-        std::cerr << "[HTTPResponseParser] Failed to read headers\n";
-        return response;
-    }
-
-    // Step 2: Extract status code
-    response.status_code = getStatusCode(response.headers);
-
-    // Step 3: Check if response should have no body
-    if (shouldHaveNoBody(response.status_code)) {
-        response.body = "";
-        response.full = response.headers;
-        response.valid = true;
-        return response;
-    }
-
-    // Step 4: Determine body reading strategy
-
-    // Case A: Chunked Transfer-Encoding
-    if (isChunked(response.headers)) {
-        response.body = readChunkedBody(server_fd, overflow);
-        // Body contains contents of the full response, replace Transfer-Encoding with Content-Length
-        response.headers = http_utils::removeHeader(response.headers, "Transfer-Encoding");
-        response.headers = http_utils::insertHeader(response.headers, "Content-Length", std::to_string(response.body.size()));
-        response.full = response.headers + response.body;
-        response.valid = true;
-        return response;
-    }
-
-    // Case B: Content-Length specified
-    size_t content_length = parseContentLength(response.headers);
-    if (content_length > 0) {
-        response.body = readFixedLengthBody(server_fd, content_length, overflow);
-        response.full = response.headers + response.body;
-        response.valid = true;
-        return response;
-    }
-
-    // Case C: Read until connection closes (HTTP/1.0 style)
-    response.body = readUntilClose(server_fd, overflow);
-    response.full = response.headers + response.body;
-    response.valid = true;
-    return response;
-}
-
 std::string HTTPResponseParser::getHeader(const std::string& headers, 
                                            const std::string& header_name) {
     // Case-insensitive search
@@ -128,25 +75,67 @@ int HTTPResponseParser::getStatusCode(const std::string& headers) {
     }
 }
 
+// ============================================================================
+// Stream
+// ============================================================================
+
+HTTPResponseParser::Stream::Stream(int server_fd, bool head_request)
+    : fd(server_fd), head_request(head_request) {}
+
+bool HTTPResponseParser::Stream::readHeaders() {
+    // Interim responses (100 Continue, 103 Early Hints) come before the real one and are dropped,
+    // taking one for the response would leave the real one for whoever uses the connection next.
+    // 101 switches the connection to another protocol and is final
+    std::string overflow;
+    do {
+        if (!HTTPResponseParser::readHeaders(fd, header_section, overflow)) {
+            return false;
+        }
+        status_code = getStatusCode(header_section);
+    } while (status_code >= 100 && status_code < 200 && status_code != 101);
+
+    // After 101 the connection carries something else, it ends with the connection and is never reused
+    if (status_code == 101) {
+        body = HTTPBodyReader(fd, HTTPBodyReader::Framing::CLOSE, 0, std::move(overflow));
+        return true;
+    }
+
+    // Case A: No body (HEAD, 204, 304)
+    if (head_request || shouldHaveNoBody(status_code)) {
+        body = HTTPBodyReader(fd, HTTPBodyReader::Framing::NONE, 0, std::move(overflow));
+        return true;
+    }
+
+    // Case B: Chunked Transfer-Encoding, passed on frame by frame
+    if (isChunked(header_section)) {
+        body = HTTPBodyReader(fd, HTTPBodyReader::Framing::CHUNKED, 0, std::move(overflow));
+        return true;
+    }
+
+    // Case C: Content-Length specified (zero included, the body is then empty)
+    size_t content_length = 0;
+    if (parseContentLength(header_section, content_length)) {
+        body = HTTPBodyReader(fd, HTTPBodyReader::Framing::LENGTH, content_length, std::move(overflow));
+        return true;
+    }
+
+    // Case D: Read until connection closes (HTTP/1.0 style)
+    body = HTTPBodyReader(fd, HTTPBodyReader::Framing::CLOSE, 0, std::move(overflow));
+    return true;
+}
+
 // ============================================================================
 // Private Helper Methods
 // ============================================================================
 
 bool HTTPResponseParser::readHeaders(int fd, std::string& headers, std::string& overflow) {
     headers.clear();
-    overflow.clear();
     
     char buf[4096];
-    std::string accumulated;
+    std::string accumulated = std::move(overflow);
+    overflow.clear();
 
     while (true) {
-        ssize_t n = recv(fd, buf, sizeof(buf), 0);
-        if (n <= 0) {
-            return false;
-        }
-
-        accumulated.append(buf, n);
-
         size_t header_end = accumulated.find("\r\n\r\n");
         
         if (header_end != std::string::npos) {
@@ -154,6 +143,13 @@ bool HTTPResponseParser::readHeaders(int fd, std::string& headers, std::string&
             overflow = accumulated.substr(header_end + 4);
             return true;
         }
+
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0) {
+            return false;
+        }
+
+        accumulated.append(buf, n);
     }
 }
 
@@ -173,167 +169,17 @@ bool HTTPResponseParser::isChunked(const std::string& headers) {
     return (lower.find("chunked") != std::string::npos);
 }
 
-size_t HTTPResponseParser::parseContentLength(const std::string& headers) {
+bool HTTPResponseParser::parseContentLength(const std::string& headers, size_t& length) {
     std::string value = getHeader(headers, "Content-Length");
     
     if (value.empty()) {
-        return 0;
+        return false;
     }
 
     try {
-        return static_cast<size_t>(std::stoul(value));
+        length = static_cast<size_t>(std::stoul(value));
+        return true;
     } catch (...) {
-        return 0;
+        return false;
     }
 }
-
-std::string HTTPResponseParser::readFixedLengthBody(int fd, size_t length, 
-                                                     const std::string& overflow) {
-    std::string body = overflow;
-    
-    if (body.size() >= length) {
-        return body.substr(0, length);
-    }
-
-    body.reserve(length);
-    char buf[8192];
-    size_t total = body.size();
-
-    while (total < length) {
-        size_t to_read = std::min(sizeof(buf), length - total);
-        ssize_t n = recv(fd, buf, to_read, 0);
-        
-        if (n <= 0) {
-            std::cerr << "[HTTPResponseParser] Premature EOF ("
-                      << total << "/" << length << " bytes)\n";
-            break;
-        }
-
-        body.append(buf, n);
-        total += n;
-    }
-
-    return body;
-}
-
-std::string HTTPResponseParser::readChunkedBody(int fd, std::string& buffer) {
-    std::string body;
-    
-    while (true) {
-        // Step 1: Read chunk size line
-        std::string chunk_size_line;
-        if (!readLine(fd, buffer, chunk_size_line)) {
-            std::cerr << "[HTTPResponseParser] Failed to read chunk size\n";
-            return body;
-        }
-
-        // Strip chunk extensions (e.g., "1A;foo=bar" -> "1A")
-        size_t semicolon = chunk_size_line.find(';');
-        if (semicolon != std::string::npos) {
-            chunk_size_line = chunk_size_line.substr(0, semicolon);
-        }
-
-        // Step 2: Parse hex chunk size
-        size_t chunk_size = 0;
-        try {
-            chunk_size = std::stoul(chunk_size_line, nullptr, 16);
-        } catch (...) {
-            std::cerr << "[HTTPResponseParser] Invalid chunk size: '" 
-                      << chunk_size_line << "'\n";
-            return body;
-        }
-
-        // Step 3: Check for last chunk (size = 0)
-        if (chunk_size == 0) {
-            // Read and discard any trailer headers until empty line
-            std::string trailer_line;
-            while (readLine(fd, buffer, trailer_line) && !trailer_line.empty()) {
-                // Trailer headers are discarded (could be parsed if needed)
-            }
-            return body;
-        }
-
-        // Step 4: Read chunk data
-        std::string chunk_data = readExactFromBuffer(fd, buffer, chunk_size);
-        if (chunk_data.size() != chunk_size) {
-            std::cerr << "[HTTPResponseParser] Incomplete chunk data\n";
-            return body;
-        }
-        body += chunk_data;
-
-        // Step 5: Read trailing CRLF
-        std::string trailing_crlf;
-        readLine(fd, buffer, trailing_crlf);
-    }
-
-    return body;
-}
-
-std::string HTTPResponseParser::readUntilClose(int fd, const std::string& overflow) {
-    std::string body = overflow;
-    char buf[8192];
-
-    while (true) {
-        ssize_t n = recv(fd, buf, sizeof(buf), 0);
-        if (n <= 0) {
-            break;
-        }
-        body.append(buf, n);
-    }
-
-    return body;
-}
-
-// ============================================================================
-// Buffered Reading Helpers
-// ============================================================================
-
-bool HTTPResponseParser::readLine(int fd, std::string& buffer, std::string& line) {
-    line.clear();
-    
-    while (true) {
-        // Check if we have a complete line in buffer
-        size_t pos = buffer.find("\r\n");
-        if (pos != std::string::npos) {
-            line = buffer.substr(0, pos);
-            buffer.erase(0, pos + 2);
-            return true;
-        }
-
-        // Need more data
-        char buf[4096];
-        ssize_t n = recv(fd, buf, sizeof(buf), 0);
-        if (n <= 0) {
-            return false;
-        }
-        buffer.append(buf, n);
-    }
-}
-
-std::string HTTPResponseParser::readExactFromBuffer(int fd, std::string& buffer, size_t n) {
-    // First, use what's in buffer
-    if (buffer.size() >= n) {
-        std::string result = buffer.substr(0, n);
-        buffer.erase(0, n);
-        return result;
-    }
-
-    // Need more data
-    std::string result = buffer;
-    buffer.clear();
-    
-    size_t remaining = n - result.size();
-    char buf[8192];
-
-    while (remaining > 0) {
-        size_t to_read = std::min(sizeof(buf), remaining);
-        ssize_t bytes = recv(fd, buf, to_read, 0);
-        if (bytes <= 0) {
-            return result;  // Partial read
-        }
-        result.append(buf, bytes);
-        remaining -= bytes;
-    }
-
-    return result;
-}
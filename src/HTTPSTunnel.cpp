@@ -1,11 +1,11 @@
 #include "HTTPSTunnel.hpp"
 #include "NetworkUtils.hpp"
+#include "RelayEngine.hpp"
 
 #include <unistd.h>
 #include <sys/socket.h>
-#include <sys/select.h>
 #include <iostream>
-#include <algorithm>
+#include <string>
 
 // ====================================================================================================
 // Public Methods
@@ -39,78 +39,12 @@ bool HTTPSTunnel::establish(int client_fd,
 
     std::cout << "[HTTPSTunnel] Tunnel established, forwarding traffic...\n";
 
-    // Step 3: Forward data bidirectionally
-    forwardTraffic(client_fd, server_fd);
-
-    // Step 4: Cleanup
-    close(server_fd);
-    std::cout << "[HTTPSTunnel] Tunnel closed\n";
+    // Step 3: Hand both sockets to the relay engine, which forwards and closes them
+    std::string target = host + ":" + std::to_string(port);
+    RelayEngine::shared().add(client_fd, server_fd, [target](bool ok, const SocketRelay::Stats& stats) {
+        std::cout << "[HTTPSTunnel] Tunnel to " << target << (ok ? " closed" : " failed")
+                  << " (" << stats.a_to_b << " bytes up, " << stats.b_to_a << " bytes down)\n";
+    });
 
     return true;
 }
-
-// ====================================================================================================
-// Private Helper Methods
-// ====================================================================================================
-
-void HTTPSTunnel::forwardTraffic(int client_fd, int server_fd) {
-    fd_set read_fds;
-    char buf[8192];
-    int max_fd = std::max(client_fd, server_fd) + 1;
-
-    while (true) {
-        // Setup file descriptor set for select()
-        FD_ZERO(&read_fds);
-        FD_SET(client_fd, &read_fds);
-        FD_SET(server_fd, &read_fds);
-
-        // Wait for activity on either socket
-        int activity = select(max_fd, &read_fds, nullptr, nullptr, nullptr);
-        if (activity < 0) {
-            std::cerr << "[HTTPSTunnel] Select error: " << NetworkUtils::getLastError() << "\n";
-            break;
-        }
-
-        // Check if client has data to send to server
-        if (FD_ISSET(client_fd, &read_fds)) {
-            ssize_t n = recv(client_fd, buf, sizeof(buf), 0);
-            
-            if (n <= 0) {
-                if (n < 0) {
-                    std::cerr << "[HTTPSTunnel] Client recv error: " 
-                              << NetworkUtils::getLastError() << "\n";
-                } else {
-                    std::cout << "[HTTPSTunnel] Client closed connection\n";
-                }
-                break;
-            }
-            
-            // Use NetworkUtils to send data to server
-            if (!NetworkUtils::sendData(server_fd, buf, n)) {
-                std::cerr << "[HTTPSTunnel] Failed to forward client data to server\n";
-                break;
-            }
-        }
-
-        // Check if server has data to send to client
-        if (FD_ISSET(server_fd, &read_fds)) {
-            ssize_t n = recv(server_fd, buf, sizeof(buf), 0);
-            
-            if (n <= 0) {
-                if (n < 0) {
-                    std::cerr << "[HTTPSTunnel] Server recv error: " 
-                              << NetworkUtils::getLastError() << "\n";
-                } else {
-                    std::cout << "[HTTPSTunnel] Server closed connection\n";
-                }
-                break;
-            }
-            
-            // Use NetworkUtils to send data to client
-            if (!NetworkUtils::sendData(client_fd, buf, n)) {
-                std::cerr << "[HTTPSTunnel] Failed to forward server data to client\n";
-                break;
-            }
-        }
-    }
-}
\ No newline at end of file
@@ -0,0 +1,166 @@
+#include <cstring>
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "LocalSocket.hpp"
+
+namespace LocalSocket {
+
+    namespace {
+        bool makeAddress(const std::string& path, sockaddr_un& addr) {
+            addr = {};
+            addr.sun_family = AF_UNIX;
+            if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+                std::cerr << "LocalSocket: Invalid socket path: " << path << "\n";
+                return false;
+            }
+            std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+            return true;
+        }
+    }
+
+
+    bool isLocalAddress(const std::string& host) {
+        return host.starts_with(PREFIX);
+    }
+
+
+    std::string socketPath(const std::string& host) {
+        return isLocalAddress(host) ? host.substr(std::strlen(PREFIX)) : host;
+    }
+
+
+    int listen(const std::string& path) {
+        sockaddr_un addr;
+        if (!makeAddress(path, addr)) return -1;
+
+        int socket_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (socket_fd < 0) {
+            std::cerr << "LocalSocket: Failed to create socket\n";
+            return -1;
+        }
+
+        // A Socket File Left Behind by an Earlier Server Would Make bind() Fail
+        struct stat st{};
+        if (lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) unlink(path.c_str());
+
+        if (bind(socket_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(socket_fd, SOMAXCONN) < 0) {
+            std::cerr << "LocalSocket: Failed to listen on " << path << "\n";
+            close(socket_fd);
+            return -1;
+        }
+        return socket_fd;
+    }
+
+
+    int connect(const std::string& path) {
+        sockaddr_un addr;
+        if (!makeAddress(path, addr)) return -1;
+
+        int socket_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (socket_fd < 0) {
+            std::cerr << "LocalSocket: Failed to create socket\n";
+            return -1;
+        }
+        if (::connect(socket_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+            std::cerr << "LocalSocket: Failed to connect to " << path << "\n";
+            close(socket_fd);
+            return -1;
+        }
+        return socket_fd;
+    }
+
+
+    bool isLocal(int socket_fd) {
+        sockaddr_storage addr{};
+        socklen_t length = sizeof(addr);
+        if (getsockname(socket_fd, reinterpret_cast<sockaddr*>(&addr), &length) != 0) return false;
+        return addr.ss_family == AF_UNIX;
+    }
+
+
+    bool sendFds(int socket_fd, const std::vector<int>& file_fds, const char* data, size_t length) {
+        constexpr size_t MAX_FDS = 8;
+        if (file_fds.empty() || file_fds.size() > MAX_FDS || length == 0) return false;
+
+        // The Descriptors Ride Along with the First Bytes as Ancillary Data
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * MAX_FDS)] = {};
+        iovec iov{const_cast<char*>(data), length};
+        msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = CMSG_SPACE(sizeof(int) * file_fds.size());
+
+        cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * file_fds.size());
+        std::memcpy(CMSG_DATA(cmsg), file_fds.data(), sizeof(int) * file_fds.size());
+
+        ssize_t sent = sendmsg(socket_fd, &msg, 0);
+        if (sent <= 0) return false;
+
+        // Rest of the Data Without the Descriptors
+        for (size_t done = sent; done < length;) {
+            ssize_t n = send(socket_fd, data + done, length - done, 0);
+            if (n <= 0) return false;
+            done += n;
+        }
+        return true;
+    }
+
+
+    bool sendFd(int socket_fd, int file_fd, const char* data, size_t length) {
+        return sendFds(socket_fd, {file_fd}, data, length);
+    }
+
+
+    std::vector<int> receiveFds(int socket_fd, char* data, size_t length, bool& ok) {
+        constexpr size_t MAX_FDS = 8;
+        std::vector<int> file_fds;
+        size_t done = 0;
+
+        while (done < length) {
+            alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * MAX_FDS)] = {};
+            iovec iov{data + done, length - done};
+            msghdr msg{};
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+
+            ssize_t n = recvmsg(socket_fd, &msg, 0);
+            if (n <= 0) break;
+            done += n;
+
+            for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+                if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) continue;
+                size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                for (size_t i = 0; i < count; i++) {
+                    int fd;
+                    std::memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+                    file_fds.push_back(fd);
+                }
+            }
+        }
+
+        ok = done == length;
+        if (!ok) {
+            for (int fd : file_fds) close(fd);
+            file_fds.clear();
+        }
+        return file_fds;
+    }
+
+
+    int receiveFd(int socket_fd, char* data, size_t length, bool& ok) {
+        std::vector<int> file_fds = receiveFds(socket_fd, data, length, ok);
+        for (size_t i = 1; i < file_fds.size(); i++) close(file_fds[i]);
+        return file_fds.empty() ? -1 : file_fds[0];
+    }
+
+} // namespace LocalSocket
@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <sys/uio.h>
+
+#include "MessageBuilder.hpp"
+#include "Protocol.hpp"
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+
+char* MessageBuilder::reserve(size_t length) {
+    // Extend the Last Segment When It Is Also Held in Storage
+    if (!segments.empty() && segments.back().ref == nullptr) {
+        segments.back().length += length;
+    } else {
+        segments.push_back({nullptr, storage.size(), length});
+    }
+
+    size_t offset = storage.size();
+    storage.resize(offset + length);
+    total += length;
+    return &storage[offset];
+}
+
+
+void MessageBuilder::appendUint8(uint8_t value) {
+    *reserve(1) = static_cast<char>(value);
+}
+
+
+void MessageBuilder::appendUint16(uint16_t value) {
+    Protocol::write_uint16(reserve(2), value);
+}
+
+
+void MessageBuilder::appendUint32(uint32_t value) {
+    Protocol::write_uint32(reserve(4), value);
+}
+
+
+void MessageBuilder::appendUint64(uint64_t value) {
+    Protocol::write_uint64(reserve(8), value);
+}
+
+
+void MessageBuilder::appendBytes(const void* data, size_t length) {
+    if (length == 0) return;
+    std::memcpy(reserve(length), data, length);
+}
+
+
+void MessageBuilder::appendBytes(const std::vector<char>& data) {
+    appendBytes(data.data(), data.size());
+}
+
+
+void MessageBuilder::appendRef(const void* data, size_t length) {
+    if (length == 0) return;
+    segments.push_back({static_cast<const char*>(data), 0, length});
+    total += length;
+}
+
+
+bool MessageBuilder::flush(int socket_fd, bool more) {
+    // Storage Is Final Now, Resolve Segments to iovecs
+    std::vector<iovec> iov;
+    iov.reserve(segments.size());
+    for (const Segment& segment : segments) {
+        const char* base = segment.ref ? segment.ref : storage.data() + segment.offset;
+        iov.push_back({const_cast<char*>(base), segment.length});
+    }
+
+    // Send, Advancing Past Whatever a Partial Write Took
+    size_t first = 0;
+    size_t remaining = total;
+    while (remaining > 0) {
+        msghdr msg{};
+        msg.msg_iov = &iov[first];
+        msg.msg_iovlen = std::min<size_t>(iov.size() - first, IOV_MAX);
+
+        size_t batch = 0;
+        for (size_t i = first; i < first + msg.msg_iovlen; i++) batch += iov[i].iov_len;
+        bool last_batch = batch == remaining;
+
+        ssize_t sent = sendmsg(socket_fd, &msg, (more || !last_batch) ? SEND_MORE : 0);
+        if (sent <= 0) {
+            clear();
+            return false;
+        }
+        remaining -= sent;
+
+        size_t advance = static_cast<size_t>(sent);
+        while (advance > 0 && advance >= iov[first].iov_len) {
+            advance -= iov[first].iov_len;
+            first++;
+        }
+        if (advance > 0) {
+            iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + advance;
+            iov[first].iov_len -= advance;
+        }
+    }
+
+    clear();
+    return true;
+}
+
+
+void MessageBuilder::clear() {
+    storage.clear();
+    segments.clear();
+    total = 0;
+}
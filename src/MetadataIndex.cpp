@@ -0,0 +1,220 @@
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "MetadataIndex.hpp"
+
+namespace {
+
+    uint64_t mtimeOf(const struct stat& st) {
+    #ifdef __APPLE__
+        const timespec& mtime = st.st_mtimespec;
+    #else
+        const timespec& mtime = st.st_mtim;
+    #endif
+        return static_cast<uint64_t>(mtime.tv_sec) * 1000000000ull + static_cast<uint64_t>(mtime.tv_nsec);
+    }
+
+} // namespace
+
+
+MetadataIndex::MetadataIndex(std::filesystem::path index_path)
+    : index_path{std::move(index_path)} {
+    load();
+}
+
+
+bool MetadataIndex::version(const std::filesystem::path& path, const std::string& key, Protocol::FileVersion& out) {
+    int file_fd = open(path.c_str(), O_RDONLY | O_NONBLOCK); // A FIFO must not hang us before the type check
+    struct stat st{};
+    if (file_fd < 0 || fstat(file_fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        if (file_fd >= 0) close(file_fd);
+        return false;
+    }
+    out.size = static_cast<uint64_t>(st.st_size);
+    out.mtime_ns = mtimeOf(st);
+
+    // Size and Modification Time Unchanged, Trust the Recorded Hash
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(key);
+        if (it != entries.end() && it->second.size == out.size && it->second.mtime_ns == out.mtime_ns) {
+            out.hash = it->second.hash;
+            close(file_fd);
+            return true;
+        }
+    }
+
+    // Otherwise Hash the Contents, Outside the Lock
+    bool ok = hashFile(file_fd, out.hash);
+    close(file_fd);
+    if (ok && key.find('\n') == std::string::npos) {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries[key] = out;
+        append(key, &out);
+    }
+    return ok;
+}
+
+
+bool MetadataIndex::list(const std::filesystem::path& root, const std::string& dir, Protocol::Listing& out) {
+    std::filesystem::path base = (root / dir).lexically_normal();
+    std::error_code error;
+    if (!std::filesystem::is_directory(base, error)) return false;
+
+    // Walk the Tree, Only Re-hashed Files Add to the Index File
+    auto options = std::filesystem::directory_options::skip_permission_denied;
+    for (std::filesystem::recursive_directory_iterator it(base, options, error), end; !error && it != end; it.increment(error)) {
+        std::error_code entry_error;
+        if (!it->is_regular_file(entry_error)) continue;
+        if (it->path().filename().string().starts_with(DEFAULT_NAME)) continue;
+
+        Protocol::ListingEntry entry;
+        std::string key = it->path().lexically_relative(root).generic_string();
+        if (!version(it->path(), key, entry.version)) continue;
+        entry.path = it->path().lexically_relative(base).generic_string();
+        entry.permissions = static_cast<uint16_t>(it->status(entry_error).permissions() & std::filesystem::perms::mask);
+        out.entries.push_back(std::move(entry));
+    }
+    return !error;
+}
+
+
+void MetadataIndex::record(const std::string& key, const Protocol::FileVersion& version) {
+    if (key.find('\n') != std::string::npos) return; // Can't be stored in the index file
+    std::lock_guard<std::mutex> lock(mutex);
+    entries[key] = version;
+    append(key, &version);
+}
+
+
+void MetadataIndex::forget(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (entries.erase(key) > 0) append(key, nullptr);
+}
+
+
+void MetadataIndex::rename(const std::string& from, const std::string& to) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(from);
+    if (it == entries.end()) return;
+    Protocol::FileVersion version = it->second;
+    entries.erase(it);
+    append(from, nullptr);
+    if (to.find('\n') == std::string::npos) {
+        entries[to] = version;
+        append(to, &version);
+    }
+}
+
+
+uint64_t MetadataIndex::hash(uint64_t state, const char* data, size_t length) {
+    constexpr uint64_t FNV_PRIME = 0x100000001b3ull;
+    for (size_t i = 0; i < length; i++) {
+        state ^= static_cast<uint8_t>(data[i]);
+        state *= FNV_PRIME;
+    }
+    return state;
+}
+
+
+bool MetadataIndex::hashFile(int file_fd, uint64_t& out) {
+    char buffer[64 * 1024];
+    uint64_t state = FNV_OFFSET;
+    off_t offset = 0;
+    while (true) {
+        ssize_t n = pread(file_fd, buffer, sizeof(buffer), offset);
+        if (n < 0) return false;
+        if (n == 0) break;
+        state = hash(state, buffer, static_cast<size_t>(n));
+        offset += n;
+    }
+    out = state;
+    return true;
+}
+
+
+bool MetadataIndex::setMtime(int file_fd, uint64_t mtime_ns) {
+    timespec times[2];
+    times[0].tv_sec = 0;
+    times[0].tv_nsec = UTIME_OMIT; // Leave the access time alone
+    times[1].tv_sec = static_cast<time_t>(mtime_ns / 1000000000ull);
+    times[1].tv_nsec = static_cast<long>(mtime_ns % 1000000000ull);
+    return futimens(file_fd, times) == 0;
+}
+
+
+// Index File: One Change per Line, "<size> <mtime_ns> <hash> <name>" or "- <name>" for
+// a removal. Later lines win.
+void MetadataIndex::load() {
+    std::ifstream file(index_path);
+    std::string line;
+    while (std::getline(file, line)) {
+        journal_lines++;
+        if (line.starts_with("- ")) {
+            entries.erase(line.substr(2));
+            continue;
+        }
+
+        std::istringstream iss(line);
+        Protocol::FileVersion version;
+        std::string key;
+        if (!(iss >> version.size >> version.mtime_ns >> std::hex >> version.hash)) continue;
+        iss.get(); // Separator before the name, which may contain spaces
+        std::getline(iss, key);
+        if (!key.empty()) entries[key] = version;
+    }
+    journal.open(index_path, std::ios::app);
+}
+
+
+void MetadataIndex::append(const std::string& key, const Protocol::FileVersion* version) {
+    // Mostly Stale Lines, Start Over with Just the Live Entries
+    if (journal_lines >= 1024 && journal_lines > 2 * entries.size()) {
+        save();
+        return;
+    }
+
+    if (version) {
+        journal << version->size << ' ' << version->mtime_ns << ' ' << std::hex << version->hash << std::dec
+                << ' ' << key << '\n';
+    } else {
+        journal << "- " << key << '\n';
+    }
+    journal.flush();
+    if (!journal) std::cerr << "MetadataIndex: Failed to append to " << index_path << "\n";
+    journal_lines++;
+}
+
+
+void MetadataIndex::save() {
+    // Write a Fresh Copy and Rename It over the Old One, so a Crash Never Leaves Half an Index
+    std::filesystem::path temp_path = index_path;
+    temp_path += ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::trunc);
+        for (const auto& [key, version] : entries) {
+            file << version.size << ' ' << version.mtime_ns << ' ' << std::hex << version.hash << std::dec
+                 << ' ' << key << '\n';
+        }
+        if (!file) {
+            std::cerr << "MetadataIndex: Failed to write " << temp_path << "\n";
+            return;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temp_path, index_path, error);
+    if (error) {
+        std::cerr << "MetadataIndex: Failed to replace " << index_path << ": " << error.message() << "\n";
+        return;
+    }
+
+    // Further Changes Go to the New File
+    journal.close();
+    journal.clear();
+    journal.open(index_path, std::ios::app);
+    journal_lines = entries.size();
+}
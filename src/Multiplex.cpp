@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <sys/socket.h>
+
+#include "MessageBuilder.hpp"
+#include "MessageSchema.hpp"
+#include "Multiplex.hpp"
+#include "Protocol.hpp"
+
+namespace Multiplex {
+
+    // version, type, flags, stream_id, length
+    using FrameLayout = Protocol::Schema::Message<Protocol::Schema::U8, Protocol::Schema::Enum8<FrameType>,
+                                                  Protocol::Schema::U16, Protocol::Schema::U32, Protocol::Schema::U32>;
+    static_assert(FrameLayout::FIXED && FrameLayout::MIN_SIZE == FRAME_HEADER_SIZE);
+
+    bool FrameHeader::parse(const char* data, FrameHeader& out) {
+        size_t consumed;
+        FrameLayout::read(data, FRAME_HEADER_SIZE, consumed, out.version, out.type, out.flags, out.stream_id, out.length);
+        return out.version == VERSION && out.length <= MAX_FRAME_PAYLOAD;
+    }
+
+    void FrameHeader::serialize(char* dest) const {
+        FrameLayout::write(dest, version, type, flags, stream_id, length);
+    }
+
+
+    Connection::Connection(int socket_fd)
+        : socket_fd{socket_fd} {}
+
+
+    void Connection::prime(const char* data, size_t length) {
+        read_buffer.insert(read_buffer.end(), data, data + length);
+    }
+
+
+    bool Connection::fill(size_t needed) {
+        // Compact Consumed Bytes Once They Make Up Most of the Buffer
+        if (read_offset > 0 && read_offset * 2 >= read_buffer.size()) {
+            read_buffer.erase(read_buffer.begin(), read_buffer.begin() + read_offset);
+            read_offset = 0;
+        }
+
+        char temp[64 * 1024];
+        while (read_buffer.size() - read_offset < needed) {
+            ssize_t n = recv(socket_fd, temp, sizeof(temp), 0);
+            if (n <= 0) return false;
+            read_buffer.insert(read_buffer.end(), temp, temp + n);
+        }
+        return true;
+    }
+
+
+    bool Connection::readFrame(FrameHeader& header, std::vector<char>& payload) {
+        // Read Frame Header
+        if (!fill(FRAME_HEADER_SIZE)) return false;
+        if (!FrameHeader::parse(&read_buffer[read_offset], header)) return false;
+        read_offset += FRAME_HEADER_SIZE;
+
+        // Read Frame Payload
+        if (!fill(header.length)) return false;
+        payload.assign(read_buffer.begin() + read_offset, read_buffer.begin() + read_offset + header.length);
+        read_offset += header.length;
+        return true;
+    }
+
+
+    bool Connection::writeFrame(FrameType type, uint32_t stream_id, const char* data, size_t length) {
+        FrameHeader header;
+        header.type = type;
+        header.stream_id = stream_id;
+        header.length = static_cast<uint32_t>(length);
+
+        // Header and Payload Go Out in One sendmsg, the Lock Keeps Frames from Interleaving
+        MessageBuilder message;
+        char header_bytes[FRAME_HEADER_SIZE];
+        header.serialize(header_bytes);
+        message.appendBytes(header_bytes, sizeof(header_bytes));
+        message.appendRef(data, length);
+
+        std::lock_guard<std::mutex> lock(write_mutex);
+        return message.flush(socket_fd);
+    }
+
+
+    bool Connection::sendData(uint32_t stream_id, const char* data, size_t length) {
+        size_t sent = 0;
+        while (sent < length) {
+            // Wait for Credit on This Stream
+            size_t n;
+            {
+                std::unique_lock<std::mutex> lock(credit_mutex);
+                credit_cv.wait(lock, [&] {
+                    auto it = send_credit.find(stream_id);
+                    return closed || it == send_credit.end() || it->second > 0;
+                });
+                auto it = send_credit.find(stream_id);
+                if (closed || it == send_credit.end()) return false;
+
+                n = static_cast<size_t>(std::min<uint64_t>({length - sent, it->second, MAX_FRAME_PAYLOAD}));
+                it->second -= n;
+            }
+
+            if (!writeFrame(FrameType::DATA, stream_id, data + sent, n)) return false;
+            sent += n;
+        }
+        return true;
+    }
+
+
+    bool Connection::sendReply(uint32_t stream_id, uint8_t status) {
+        char value = static_cast<char>(status);
+        return writeFrame(FrameType::REPLY, stream_id, &value, 1);
+    }
+
+
+    bool Connection::consumed(uint32_t stream_id, size_t length) {
+        uint64_t increment;
+        {
+            std::lock_guard<std::mutex> lock(credit_mutex);
+            uint64_t& pending = unacked[stream_id];
+            pending += length;
+            if (pending < INITIAL_WINDOW / 2) return true;
+            increment = pending;
+            pending = 0;
+        }
+
+        char payload[4];
+        Protocol::write_uint32(payload, static_cast<uint32_t>(increment));
+        return writeFrame(FrameType::WINDOW, stream_id, payload, sizeof(payload));
+    }
+
+
+    void Connection::openStream(uint32_t stream_id) {
+        std::lock_guard<std::mutex> lock(credit_mutex);
+        send_credit[stream_id] = INITIAL_WINDOW;
+        unacked[stream_id] = 0;
+    }
+
+
+    void Connection::addCredit(uint32_t stream_id, uint32_t increment) {
+        std::lock_guard<std::mutex> lock(credit_mutex);
+        auto it = send_credit.find(stream_id);
+        if (it != send_credit.end()) it->second += increment;
+        credit_cv.notify_all();
+    }
+
+
+    void Connection::closeStream(uint32_t stream_id) {
+        std::lock_guard<std::mutex> lock(credit_mutex);
+        send_credit.erase(stream_id);
+        unacked.erase(stream_id);
+        credit_cv.notify_all();
+    }
+
+
+    void Connection::shutdown() {
+        std::lock_guard<std::mutex> lock(credit_mutex);
+        closed = true;
+        credit_cv.notify_all();
+    }
+
+
+    bool Connection::isClosed() {
+        std::lock_guard<std::mutex> lock(credit_mutex);
+        return closed;
+    }
+
+} // namespace Multiplex
@@ -0,0 +1,350 @@
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "MessageSchema.hpp"
+#include "MuxClient.hpp"
+
+
+bool MuxClient::upgrade(int socket_fd) {
+    // MULTIPLEX Command Carries the Requested Protocol Version
+    char header[Protocol::COMMAND_HEADER_SIZE] = {};
+    header[0] = static_cast<char>(Protocol::CommandID::MULTIPLEX);
+    header[1] = static_cast<char>(Multiplex::VERSION);
+    if (send(socket_fd, header, sizeof(header), 0) != sizeof(header)) return false;
+
+    uint8_t reply;
+    if (recv(socket_fd, &reply, sizeof(reply), MSG_WAITALL) != sizeof(reply)) return false;
+    return static_cast<Protocol::ReplyStatus>(reply) == Protocol::ReplyStatus::ACK;
+}
+
+
+MuxClient::MuxClient(int socket_fd)
+    : conn(socket_fd) {
+    reader = std::thread(&MuxClient::readLoop, this);
+}
+
+
+MuxClient::~MuxClient() {
+    // Unblock the Reader and Any Uploads, Then Wait for Them
+    conn.shutdown();
+    ::shutdown(conn.fd(), SHUT_RDWR);
+    if (reader.joinable()) reader.join();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&] { return active_uploads == 0; });
+
+    // Deliver the Callbacks Still Queued, Then Stop the Dispatcher
+    stopping = true;
+    cv.notify_all();
+    lock.unlock();
+    if (dispatcher.joinable()) dispatcher.join();
+
+    lock.lock();
+    for (auto& [stream_id, stream] : streams) {
+        if (stream.file_fd >= 0) close(stream.file_fd);
+    }
+}
+
+
+MuxClient::StreamID MuxClient::startGet(const std::string& remote_name, const std::string& local_path, Callback on_done) {
+    return open(Kind::GET, Protocol::CommandID::GET_FILE, local_path, remote_name, -1, std::move(on_done));
+}
+
+
+MuxClient::StreamID MuxClient::startPut(const std::string& local_path, const std::string& remote_name, Callback on_done) {
+    int file_fd = ::open(local_path.c_str(), O_RDONLY);
+    return open(Kind::PUT, Protocol::CommandID::PUT_FILE, local_path, remote_name, file_fd, std::move(on_done));
+}
+
+
+MuxClient::StreamID MuxClient::startList(const std::string& remote_dir, Callback on_done) {
+    return open(Kind::LIST, Protocol::CommandID::ENUMERATE, "", remote_dir, -1, std::move(on_done));
+}
+
+
+MuxClient::Result MuxClient::wait(StreamID stream_id) {
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = streams.find(stream_id);
+    if (it == streams.end()) return {};
+    cv.wait(lock, [&] { return it->second.done; });
+
+    Result result = std::move(it->second.result);
+    streams.erase(it);
+    return result;
+}
+
+
+size_t MuxClient::pending() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return streams.size();
+}
+
+
+MuxClient::StreamID MuxClient::open(Kind kind, Protocol::CommandID command, const std::string& local_path,
+                                    const std::string& remote_name, int file_fd, Callback on_done) {
+    StreamID stream_id;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (on_done && !dispatcher.joinable()) dispatcher = std::thread(&MuxClient::dispatchLoop, this);
+
+        stream_id = next_stream++;
+        Stream& stream = streams[stream_id];
+        stream.id = stream_id;
+        stream.on_done = std::move(on_done);
+        stream.kind = kind;
+        stream.local_path = local_path;
+        stream.remote_name = remote_name;
+        stream.file_fd = file_fd;
+
+        if (kind == Kind::PUT && file_fd < 0) {
+            std::cerr << "[Multiplex] Failed to open " << local_path << "\n";
+            finish(stream, Protocol::ReplyStatus::ERROR);
+            return stream_id;
+        }
+
+        // The Reader Has Already Failed Every Stream It Knew About
+        if (conn.isClosed()) {
+            finish(stream, Protocol::ReplyStatus::ERROR);
+            return stream_id;
+        }
+    }
+
+    // OPEN Frame Carries a v1 Command Message
+    std::vector<char> payload(Protocol::Schema::PathCommand::size(command, remote_name));
+    Protocol::Schema::PathCommand::write(payload.data(), command, remote_name);
+
+    if (kind == Kind::PUT) conn.openStream(stream_id);
+    if (!conn.writeFrame(Multiplex::FrameType::OPEN, stream_id, payload.data(), payload.size())) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = streams.find(stream_id);
+        if (it != streams.end()) finish(it->second, Protocol::ReplyStatus::ERROR);
+    }
+    return stream_id;
+}
+
+
+void MuxClient::readLoop() {
+    Multiplex::FrameHeader frame;
+    std::vector<char> payload;
+    while (conn.readFrame(frame, payload)) {
+        switch (frame.type) {
+            case Multiplex::FrameType::REPLY:
+                if (!payload.empty()) handleReply(frame.stream_id, static_cast<Protocol::ReplyStatus>(payload[0]));
+                break;
+            case Multiplex::FrameType::DATA:
+                handleData(frame.stream_id, payload);
+                break;
+            case Multiplex::FrameType::END:
+                handleEnd(frame.stream_id);
+                break;
+            case Multiplex::FrameType::WINDOW:
+                if (payload.size() >= 4) conn.addCredit(frame.stream_id, Protocol::parse_uint32(payload.data()));
+                break;
+            case Multiplex::FrameType::RESET: {
+                std::lock_guard<std::mutex> lock(mutex);
+                auto it = streams.find(frame.stream_id);
+                if (it != streams.end()) finish(it->second, Protocol::ReplyStatus::ERROR);
+                conn.closeStream(frame.stream_id);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    // Connection Lost: Fail Everything Still Running
+    conn.shutdown();
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& [stream_id, stream] : streams) {
+        if (!stream.done) finish(stream, Protocol::ReplyStatus::ERROR);
+    }
+}
+
+
+void MuxClient::dispatchLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        cv.wait(lock, [&] { return !completed.empty() || stopping; });
+        if (completed.empty()) return;
+
+        StreamID stream_id = completed.front();
+        completed.pop_front();
+        auto it = streams.find(stream_id);
+        if (it == streams.end()) continue;
+
+        // The Stream Is Collected Here Instead of by wait()
+        Callback on_done = std::move(it->second.on_done);
+        Result result = std::move(it->second.result);
+        streams.erase(it);
+
+        lock.unlock();
+        on_done(std::move(result));
+        lock.lock();
+    }
+}
+
+
+void MuxClient::handleReply(StreamID stream_id, Protocol::ReplyStatus status) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = streams.find(stream_id);
+    if (it == streams.end() || it->second.done) return;
+    Stream& stream = it->second;
+
+    // First Reply Accepts or Rejects the Command
+    if (!stream.acked) {
+        if (status != Protocol::ReplyStatus::ACK) {
+            finish(stream, status);
+            conn.closeStream(stream_id);
+            return;
+        }
+        stream.acked = true;
+
+        if (stream.kind == Kind::PUT) {
+            active_uploads++;
+            std::thread(&MuxClient::upload, this, stream_id).detach();
+        }
+        return;
+    }
+
+    // Second Reply Reports Whether the Upload Was Saved
+    finish(stream, status);
+    conn.closeStream(stream_id);
+}
+
+
+void MuxClient::handleData(StreamID stream_id, const std::vector<char>& payload) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = streams.find(stream_id);
+    if (it == streams.end() || it->second.done || it->second.kind == Kind::PUT) return;
+    Stream& stream = it->second;
+
+    const char* data = payload.data();
+    size_t length = payload.size();
+
+    // A Listing Is Kept in Memory Until END
+    if (stream.kind == Kind::LIST) {
+        stream.header_buffer.insert(stream.header_buffer.end(), data, data + length);
+        conn.consumed(stream_id, length);
+        return;
+    }
+
+    // Collect the FileHeader First
+    if (!stream.header_done) {
+        stream.header_buffer.insert(stream.header_buffer.end(), data, data + length);
+        size_t next_offset;
+        if (!Protocol::FileHeader::parse(stream.header_buffer, 0, stream.header, next_offset)) {
+            conn.consumed(stream_id, length);
+            return;
+        }
+        stream.header_done = true;
+
+        stream.file_fd = ::open(stream.local_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (stream.file_fd < 0) {
+            std::cerr << "[Multiplex] Failed to open " << stream.local_path << "\n";
+            conn.writeFrame(Multiplex::FrameType::RESET, stream_id);
+            finish(stream, Protocol::ReplyStatus::ERROR);
+            return;
+        }
+
+        size_t header_bytes_in_frame = next_offset - (stream.header_buffer.size() - length);
+        data += header_bytes_in_frame;
+        length -= header_bytes_in_frame;
+        stream.header_buffer.clear();
+    }
+
+    // Write File Data
+    size_t written = 0;
+    while (written < length) {
+        ssize_t n = write(stream.file_fd, data + written, length - written);
+        if (n <= 0) break;
+        written += n;
+    }
+    stream.received += written;
+    conn.consumed(stream_id, payload.size());
+}
+
+
+void MuxClient::handleEnd(StreamID stream_id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = streams.find(stream_id);
+    if (it == streams.end() || it->second.done) return;
+    Stream& stream = it->second;
+
+    if (stream.kind == Kind::LIST) {
+        stream.result.bytes = stream.header_buffer.size();
+        stream.result.data = std::move(stream.header_buffer);
+        finish(stream, Protocol::ReplyStatus::ACK);
+        conn.closeStream(stream_id);
+        return;
+    }
+
+    bool complete = stream.header_done && stream.received == stream.header.file_size;
+    stream.result.bytes = stream.received;
+    finish(stream, complete ? Protocol::ReplyStatus::ACK : Protocol::ReplyStatus::ERROR);
+    conn.closeStream(stream_id);
+}
+
+
+void MuxClient::upload(StreamID stream_id) {
+    int file_fd;
+    std::string remote_name;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        // Upload Owns the File From Here On
+        auto it = streams.find(stream_id);
+        file_fd = it != streams.end() ? it->second.file_fd : -1;
+        if (it != streams.end()) {
+            it->second.file_fd = -1;
+            remote_name = it->second.remote_name;
+        }
+    }
+
+    // FileHeader, Then File Data
+    struct stat st{};
+    bool ok = fstat(file_fd, &st) == 0;
+    Protocol::FileHeader header{static_cast<uint16_t>(st.st_mode & 07777), remote_name, static_cast<uint64_t>(st.st_size)};
+    std::vector<char> chunk;
+    header.serialize(chunk);
+    ok = ok && conn.sendData(stream_id, chunk.data(), chunk.size());
+
+    uint64_t done = 0;
+    chunk.resize(64 * 1024);
+    while (ok && done < header.file_size) {
+        ssize_t n = pread(file_fd, chunk.data(), chunk.size(), static_cast<off_t>(done));
+        ok = n > 0 && conn.sendData(stream_id, chunk.data(), n);
+        if (ok) done += n;
+    }
+
+    if (file_fd >= 0) close(file_fd);
+
+    if (ok) {
+        conn.writeFrame(Multiplex::FrameType::END, stream_id);
+    } else {
+        conn.writeFrame(Multiplex::FrameType::RESET, stream_id);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = streams.find(stream_id);
+    if (it != streams.end()) {
+        it->second.result.bytes = done;
+        if (!ok) finish(it->second, Protocol::ReplyStatus::ERROR);
+    }
+    active_uploads--;
+    cv.notify_all();
+}
+
+
+void MuxClient::finish(Stream& stream, Protocol::ReplyStatus status) {
+    if (stream.file_fd >= 0) {
+        close(stream.file_fd);
+        stream.file_fd = -1;
+    }
+    if (!stream.done && stream.on_done) completed.push_back(stream.id);
+    stream.result.status = status;
+    stream.done = true;
+    cv.notify_all();
+}
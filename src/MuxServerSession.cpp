@@ -0,0 +1,304 @@
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <iostream>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+#include "MessageSchema.hpp"
+#include "MuxServerSession.hpp"
+
+
+MuxServerSession::MuxServerSession(int client_fd, TransferScheduler& scheduler, TransferScheduler::FlowID flow,
+                                   MetadataIndex& metadata)
+    : conn(client_fd), scheduler{scheduler}, flow{flow}, metadata{metadata} {}
+
+
+void MuxServerSession::run(const std::vector<char>& pending) {
+    conn.prime(pending.data(), pending.size());
+
+    // Frame Loop
+    Multiplex::FrameHeader frame;
+    std::vector<char> payload;
+    while (conn.readFrame(frame, payload)) {
+        switch (frame.type) {
+            case Multiplex::FrameType::OPEN:
+                handleOpen(frame.stream_id, payload);
+                break;
+            case Multiplex::FrameType::DATA:
+                handleData(frame.stream_id, payload);
+                break;
+            case Multiplex::FrameType::END:
+                handleEnd(frame.stream_id);
+                break;
+            case Multiplex::FrameType::WINDOW:
+                if (payload.size() >= 4) conn.addCredit(frame.stream_id, Protocol::parse_uint32(payload.data()));
+                break;
+            case Multiplex::FrameType::RESET:
+                handleReset(frame.stream_id);
+                break;
+            default:
+                std::cerr << "[Multiplex] Unexpected frame type " << static_cast<int>(frame.type) << "\n";
+                break;
+        }
+    }
+
+    // Stop Workers and Drop Unfinished Uploads
+    conn.shutdown();
+    std::unique_lock<std::mutex> lock(worker_mutex);
+    jobs.clear();
+    worker_cv.wait(lock, [&] { return active_workers == 0; });
+    for (auto& [stream_id, upload] : uploads) {
+        if (upload.file_fd >= 0) close(upload.file_fd);
+    }
+    uploads.clear();
+    std::cout << "[Multiplex] Session closed.\n";
+}
+
+
+void MuxServerSession::handleOpen(uint32_t stream_id, const std::vector<char>& payload) {
+    // Payload is a v1 Command Message
+    Protocol::CommandID command_id;
+    std::string path_name;
+    size_t consumed;
+    if (!Protocol::Schema::PathCommand::read(payload.data(), payload.size(), consumed, command_id, path_name)) {
+        conn.sendReply(stream_id, static_cast<uint8_t>(Protocol::ReplyStatus::ERROR));
+        return;
+    }
+
+    bool supported = command_id == Protocol::CommandID::GET_FILE || command_id == Protocol::CommandID::ENUMERATE
+                     || command_id == Protocol::CommandID::PUT_FILE;
+    if (supported && !addStream(stream_id)) {
+        std::cerr << "[Multiplex] Stream " << stream_id << " refused: ID in use or too many streams\n";
+        conn.sendReply(stream_id, static_cast<uint8_t>(Protocol::ReplyStatus::NACK));
+        return;
+    }
+
+    if (command_id == Protocol::CommandID::GET_FILE || command_id == Protocol::CommandID::ENUMERATE) {
+        std::cout << "[Multiplex] Stream " << stream_id << ": "
+                  << (command_id == Protocol::CommandID::GET_FILE ? "GET_FILE " : "ENUMERATE ") << path_name << "\n";
+
+        // Queue the Stream, Starting Another Worker While the Pool Isn't Full
+        std::lock_guard<std::mutex> lock(worker_mutex);
+        jobs.push_back({stream_id, command_id, path_name});
+        if (active_workers < MAX_WORKERS) {
+            active_workers++;
+            std::thread(&MuxServerSession::work, this).detach();
+        }
+    }
+
+    else if (command_id == Protocol::CommandID::PUT_FILE) {
+        std::cout << "[Multiplex] Stream " << stream_id << ": PUT_FILE " << path_name << "\n";
+        Upload upload;
+        upload.file_name = path_name;
+        uploads[stream_id] = std::move(upload);
+        conn.sendReply(stream_id, static_cast<uint8_t>(Protocol::ReplyStatus::ACK));
+    }
+
+    else {
+        std::cerr << "[Multiplex] Command " << static_cast<int>(command_id) << " not supported on a stream\n";
+        conn.sendReply(stream_id, static_cast<uint8_t>(Protocol::ReplyStatus::NACK));
+    }
+}
+
+
+void MuxServerSession::handleData(uint32_t stream_id, const std::vector<char>& payload) {
+    auto it = uploads.find(stream_id);
+    if (it == uploads.end()) return;
+    Upload& upload = it->second;
+
+    const char* data = payload.data();
+    size_t length = payload.size();
+
+    // Collect the FileHeader First
+    if (!upload.header_done) {
+        upload.header_buffer.insert(upload.header_buffer.end(), data, data + length);
+        size_t next_offset;
+        if (!Protocol::FileHeader::parse(upload.header_buffer, 0, upload.header, next_offset)) {
+            conn.consumed(stream_id, length);
+            return;
+        }
+        upload.header_done = true;
+
+        // Uploads from a Directory Sync May Land in Directories That Don't Exist Yet
+        std::filesystem::path local_path = std::filesystem::current_path() / upload.file_name;
+        std::error_code error;
+        std::filesystem::create_directories(local_path.parent_path(), error);
+        upload.file_fd = open(local_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (upload.file_fd < 0) {
+            std::cerr << "[Multiplex] Failed to open " << local_path << "\n";
+            conn.writeFrame(Multiplex::FrameType::RESET, stream_id);
+            uploads.erase(it);
+            removeStream(stream_id);
+            return;
+        }
+
+        // Whatever Followed the Header Is File Data
+        size_t header_bytes_in_frame = next_offset - (upload.header_buffer.size() - length);
+        data += header_bytes_in_frame;
+        length -= header_bytes_in_frame;
+        upload.header_buffer.clear();
+    }
+
+    // Write File Data
+    size_t written = 0;
+    while (written < length) {
+        ssize_t n = write(upload.file_fd, data + written, length - written);
+        if (n <= 0) break;
+        written += n;
+    }
+    upload.received += written;
+    conn.consumed(stream_id, payload.size());
+}
+
+
+void MuxServerSession::handleEnd(uint32_t stream_id) {
+    auto it = uploads.find(stream_id);
+    if (it == uploads.end()) return;
+    Upload& upload = it->second;
+
+    bool ok = upload.header_done && upload.file_fd >= 0 && upload.received == upload.header.file_size;
+    if (upload.file_fd >= 0) {
+        ok = ok && fchmod(upload.file_fd, upload.header.permissions) == 0;
+        close(upload.file_fd);
+    }
+
+    conn.sendReply(stream_id, static_cast<uint8_t>(ok ? Protocol::ReplyStatus::ACK : Protocol::ReplyStatus::NACK));
+    std::cout << "[Multiplex] Stream " << stream_id << ": " << (ok ? "saved" : "failed to save")
+              << " '" << upload.file_name << "' (" << upload.received << " bytes)\n";
+    conn.closeStream(stream_id);
+    uploads.erase(it);
+    removeStream(stream_id);
+}
+
+
+void MuxServerSession::handleReset(uint32_t stream_id) {
+    // Cancel a Download, Dropping It Outright if No Worker Has It Yet
+    {
+        std::lock_guard<std::mutex> lock(worker_mutex);
+        auto queued = std::find_if(jobs.begin(), jobs.end(), [&](const Job& job) { return job.stream_id == stream_id; });
+        if (queued != jobs.end()) {
+            jobs.erase(queued);
+            streams.erase(stream_id);
+        } else if (streams.count(stream_id) != 0 && uploads.count(stream_id) == 0) {
+            cancelled.insert(stream_id);
+        }
+    }
+    conn.closeStream(stream_id);
+
+    // Drop an Upload
+    auto it = uploads.find(stream_id);
+    if (it != uploads.end()) {
+        if (it->second.file_fd >= 0) close(it->second.file_fd);
+        uploads.erase(it);
+        removeStream(stream_id);
+    }
+}
+
+
+void MuxServerSession::work() {
+    while (true) {
+        Job job;
+        {
+            std::lock_guard<std::mutex> lock(worker_mutex);
+            if (jobs.empty()) {
+                active_workers--;
+                worker_cv.notify_all();
+                return;
+            }
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+
+        if (job.command == Protocol::CommandID::GET_FILE) {
+            sendFile(job.stream_id, job.path);
+        } else {
+            sendListing(job.stream_id, job.path);
+        }
+        removeStream(job.stream_id);
+    }
+}
+
+
+void MuxServerSession::sendFile(uint32_t stream_id, const std::string& file_name) {
+    std::filesystem::path local_path = std::filesystem::current_path() / file_name;
+
+    int file_fd = open(local_path.c_str(), O_RDONLY | O_NONBLOCK); // A FIFO must not hang us before the type check
+    struct stat st{};
+    if (file_fd < 0 || fstat(file_fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        conn.sendReply(stream_id, static_cast<uint8_t>(Protocol::ReplyStatus::INVALID));
+        if (file_fd >= 0) close(file_fd);
+    } else {
+        conn.openStream(stream_id);
+        conn.sendReply(stream_id, static_cast<uint8_t>(Protocol::ReplyStatus::ACK));
+
+        // FileHeader, Then File Data Through the Scheduler
+        Protocol::FileHeader header{static_cast<uint16_t>(st.st_mode & 07777), file_name, static_cast<uint64_t>(st.st_size)};
+        std::vector<char> chunk;
+        header.serialize(chunk);
+        bool ok = conn.sendData(stream_id, chunk.data(), chunk.size());
+
+        uint64_t done = 0;
+        while (ok && done < header.file_size && !isCancelled(stream_id)) {
+            // The Slot Covers the Read, Not the Wait for the Peer's Credit
+            size_t want = static_cast<size_t>(std::min<uint64_t>(scheduler.quantumFor(flow), header.file_size - done));
+            scheduler.acquire(flow, want);
+            chunk.resize(want);
+            ssize_t n = pread(file_fd, chunk.data(), want, static_cast<off_t>(done));
+            scheduler.release(flow);
+            ok = n > 0 && conn.sendData(stream_id, chunk.data(), n);
+            if (ok) done += n;
+        }
+        close(file_fd);
+
+        if (ok && done == header.file_size) {
+            conn.writeFrame(Multiplex::FrameType::END, stream_id);
+            std::cout << "[Multiplex] Stream " << stream_id << ": sent '" << file_name << "' (" << done << " bytes)\n";
+        } else if (!conn.isClosed()) {
+            conn.writeFrame(Multiplex::FrameType::RESET, stream_id);
+        }
+        conn.closeStream(stream_id);
+    }
+}
+
+
+void MuxServerSession::sendListing(uint32_t stream_id, const std::string& dir) {
+    // Listing Is the Whole Stream, END Marks Its End
+    Protocol::Listing listing;
+    if (!metadata.list(std::filesystem::current_path(), dir, listing)) {
+        conn.sendReply(stream_id, static_cast<uint8_t>(Protocol::ReplyStatus::INVALID));
+    } else {
+        std::vector<char> body;
+        listing.serialize(body);
+        conn.openStream(stream_id);
+        conn.sendReply(stream_id, static_cast<uint8_t>(Protocol::ReplyStatus::ACK));
+        if (conn.sendData(stream_id, body.data(), body.size())) {
+            conn.writeFrame(Multiplex::FrameType::END, stream_id);
+            std::cout << "[Multiplex] Stream " << stream_id << ": listed " << listing.entries.size()
+                      << " files in '" << dir << "'\n";
+        }
+        conn.closeStream(stream_id);
+    }
+}
+
+
+bool MuxServerSession::isCancelled(uint32_t stream_id) {
+    std::lock_guard<std::mutex> lock(worker_mutex);
+    return cancelled.count(stream_id) != 0;
+}
+
+
+bool MuxServerSession::addStream(uint32_t stream_id) {
+    std::lock_guard<std::mutex> lock(worker_mutex);
+    if (streams.size() >= MAX_STREAMS) return false;
+    return streams.insert(stream_id).second;
+}
+
+
+void MuxServerSession::removeStream(uint32_t stream_id) {
+    std::lock_guard<std::mutex> lock(worker_mutex);
+    streams.erase(stream_id);
+    cancelled.erase(stream_id);
+}
@@ -3,8 +3,15 @@
 #include <sys/socket.h>
 #include <netdb.h>
 #include <unistd.h>
+#include <algorithm>
+#include <cerrno>
 #include <cstring>
 #include <iostream>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
 
 // ====================================================================================================
 // Connection Management
@@ -79,6 +86,31 @@ bool NetworkUtils::sendData(int fd, const std::string& data) {
     return sendData(fd, data.c_str(), data.size());
 }
 
+bool NetworkUtils::sendFile(int fd, int file_fd, uint64_t offset, uint64_t length) {
+#ifdef __linux__
+    off_t position = static_cast<off_t>(offset);
+    uint64_t end = offset + length;
+    while (static_cast<uint64_t>(position) < end) {
+        ssize_t sent = sendfile(fd, file_fd, &position, static_cast<size_t>(end - position));
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) {
+            std::cerr << "[NetworkUtils] Sendfile failed: " << (sent < 0 ? strerror(errno) : "file too short") << "\n";
+            return false;
+        }
+    }
+#else
+    std::vector<char> chunk(256 * 1024);
+    uint64_t done = 0;
+    while (done < length) {
+        ssize_t n = pread(file_fd, chunk.data(), static_cast<size_t>(std::min<uint64_t>(chunk.size(), length - done)),
+                          static_cast<off_t>(offset + done));
+        if (n <= 0 || !sendData(fd, chunk.data(), n)) return false;
+        done += n;
+    }
+#endif
+    return true;
+}
+
 // ====================================================================================================
 // Data Reception
 // ====================================================================================================
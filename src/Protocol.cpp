@@ -1,11 +1,10 @@
-#include <bit>
 #include <cstdint>
 #include <cstring>
 #include <sys/socket.h>
 #include <sys/types.h>
 
+#include "MessageSchema.hpp"
 #include "Protocol.hpp"
-#include <iostream>
 
 namespace Protocol {
 
@@ -17,76 +16,112 @@ namespace Protocol {
     }
 
     bool FileHeader::parse(const std::vector<char>& buffer, size_t offset, FileHeader& out, size_t& out_next_offset) {
-        if (buffer.size() < offset + 4) return false;
+        return Schema::FileHeader::read(buffer, offset, out_next_offset, out.permissions, out.path, out.file_size);
+    }
 
-        out.permissions = parse_uint16(&buffer[offset]);
-        uint16_t path_len = parse_uint16(&buffer[offset + 2]);
+    // Append the serialized FileHeader to out
+    void FileHeader::serialize(std::vector<char>& out) const {
+        Schema::FileHeader::append(out, permissions, path, file_size);
+    }
 
-        size_t needed = offset + 2 + 2 + path_len + 8; // perms(2) + path_len(2) + path(path_len) + file_size(8)
-        if (buffer.size() < needed) return false;
+    FileVersion FileVersion::parse(const char* data) {
+        FileVersion out;
+        size_t consumed;
+        Schema::FileVersion::read(data, FILE_VERSION_SIZE, consumed, out.size, out.mtime_ns, out.hash);
+        return out;
+    }
 
-        out.path = std::string(&buffer[offset + 4], path_len);
-        out.file_size = parse_uint64(&buffer[offset + 4 + path_len]);
+    void FileVersion::serialize(char* dest) const {
+        Schema::FileVersion::write(dest, size, mtime_ns, hash);
+    }
 
-        out_next_offset = needed;
+    bool Listing::parse(const std::vector<char>& buffer, size_t offset, Listing& out, size_t& out_next_offset) {
+        uint32_t count;
+        size_t position;
+        if (!Schema::Count::read(buffer, offset, position, count)) return false;
+
+        out.entries.clear();
+        for (uint32_t i = 0; i < count; i++) {
+            ListingEntry entry;
+            FileVersion& version = entry.version;
+            if (!Schema::ListingEntry::read(buffer, position, position, entry.permissions, entry.path,
+                                            version.size, version.mtime_ns, version.hash)) return false;
+            out.entries.push_back(std::move(entry));
+        }
+
+        out_next_offset = position;
         return true;
     }
 
-    // Refactored by GPT4
-    void sendReply(int socket_fd, ReplyStatus status) {
-        uint8_t value = static_cast<uint8_t>(status);
-        send(socket_fd, &value, sizeof(value), 0);  // 1-byte reply
+    // Append the serialized Listing to out
+    void Listing::serialize(std::vector<char>& out) const {
+        Schema::Count::append(out, static_cast<uint32_t>(entries.size()));
+        for (const ListingEntry& entry : entries) {
+            const FileVersion& version = entry.version;
+            Schema::ListingEntry::append(out, entry.permissions, entry.path, version.size, version.mtime_ns, version.hash);
+        }
     }
 
-    /** reverses the byte order (polyfill for std::byteswap from C++23) */
-    template<typename T> requires std::integral<T>
-    constexpr T byteswap(T value) noexcept {        
-        if constexpr (sizeof(T) == 1) {
-            return value;
-        } else if constexpr (sizeof(T) == 2) {
-            return static_cast<T>((value >> 8) | (value << 8));
-        } else if constexpr (sizeof(T) == 4) {
-            value = ((value >> 8) & 0x00FF00FF) | ((value << 8) & 0xFF00FF00);
-            return (value >> 16) | (value << 16);
-        } else if constexpr (sizeof(T) == 8) {
-            value = ((value >> 8) & 0x00FF00FF00FF00FF) | ((value << 8) & 0xFF00FF00FF00FF00);
-            value = ((value >> 16) & 0x0000FFFF0000FFFF) | ((value << 16) & 0xFFFF0000FFFF0000);
-            return (value >> 32) | (value << 32);
+    bool ChangeBatch::parse(const std::vector<char>& buffer, size_t offset, ChangeBatch& out, size_t& out_next_offset) {
+        uint32_t count;
+        size_t position;
+        if (!Schema::Count::read(buffer, offset, position, count)) return false;
+
+        out.events.clear();
+        for (uint32_t i = 0; i < count; i++) {
+            ChangeEvent event;
+            if (!Schema::ChangeEvent::read(buffer, position, position, event.type, event.path)) return false;
+            out.events.push_back(std::move(event));
         }
+
+        out_next_offset = position;
+        return true;
     }
 
-    /** Convert an integral value between native and little endian */
-    template<typename T> requires std::integral<T>
-    constexpr T le_convert(T value) {
-        if constexpr (std::endian::native == std::endian::little) {
-            return value; // Do nothing on little endian
-        } else {
-            return byteswap(value); // Swap the bytes on big endian
-        }
+    // Append the serialized ChangeBatch to out
+    void ChangeBatch::serialize(std::vector<char>& out) const {
+        Schema::Count::append(out, static_cast<uint32_t>(events.size()));
+        for (const ChangeEvent& event : events) Schema::ChangeEvent::append(out, event.type, event.path);
     }
 
-    // Parse a 2-byte little-endian uint from buffer
-    uint16_t parse_uint16(const char* data) {
-        uint16_t raw = *reinterpret_cast<const uint16_t*>(data);
-        return le_convert(raw);
+    bool ExtentMap::parse(const std::vector<char>& buffer, size_t offset, ExtentMap& out, size_t& out_next_offset) {
+        uint32_t count;
+        size_t position;
+        if (!Schema::Count::read(buffer, offset, position, count)) return false;
+
+        // Fixed-Size Entries, Check the Whole Map Is There Before Decoding
+        size_t needed = position + static_cast<size_t>(count) * EXTENT_SIZE;
+        if (buffer.size() < needed) return false;
+
+        out.extents.resize(count);
+        for (Extent& extent : out.extents) {
+            size_t consumed;
+            Schema::Extent::read(&buffer[position], EXTENT_SIZE, consumed, extent.offset, extent.length);
+            position += EXTENT_SIZE;
+        }
+
+        out_next_offset = needed;
+        return true;
     }
 
-    // Parse an 8-byte little-endian uint from buffer
-    uint64_t parse_uint64(const char* data) {
-        uint64_t raw = *reinterpret_cast<const uint64_t*>(data);
-        return le_convert(raw);
+    // Append the serialized ExtentMap to out
+    void ExtentMap::serialize(std::vector<char>& out) const {
+        size_t start = out.size();
+        out.resize(start + Schema::Count::MIN_SIZE + extents.size() * EXTENT_SIZE);
+        char* dest = Schema::Count::write(&out[start], static_cast<uint32_t>(extents.size()));
+        for (const Extent& extent : extents) dest = Schema::Extent::write(dest, extent.offset, extent.length);
     }
 
-    // Write a 2-byte little-endian uint to buffer
-    void write_uint16(char* dest, uint16_t value) {
-        value = le_convert(value);
-        *reinterpret_cast<uint16_t*>(dest) = value;
+    uint64_t ExtentMap::dataSize() const {
+        uint64_t total = 0;
+        for (const Extent& extent : extents) total += extent.length;
+        return total;
     }
 
-    // Write an 8-byte little-endian uint to buffer
-    void write_uint64(char* dest, uint64_t value) {
-        value = le_convert(value);
-        *reinterpret_cast<uint64_t*>(dest) = value;
- }
+    // Refactored by GPT4
+    void sendReply(int socket_fd, ReplyStatus status) {
+        uint8_t value = static_cast<uint8_t>(status);
+        send(socket_fd, &value, sizeof(value), 0);  // 1-byte reply
+    }
 
-} // namespace Protocol
\ No newline at end of file
+} // namespace Protocol
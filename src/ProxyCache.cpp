@@ -0,0 +1,163 @@
+#include <fcntl.h>
+#include <iostream>
+#include <system_error>
+#include <unistd.h>
+
+#include "ProxyCache.hpp"
+
+namespace {
+    constexpr const char* FILE_PREFIX = "entry-";
+
+    bool succeeded(Protocol::ReplyStatus status) {
+        return status == Protocol::ReplyStatus::ACK || status == Protocol::ReplyStatus::NOT_MODIFIED;
+    }
+}
+
+
+ProxyCache::ProxyCache(const Config& config)
+    : config{config} {
+    std::error_code error;
+    std::filesystem::create_directories(config.dir, error);
+    if (error) {
+        std::cerr << "[ProxyCache] Failed to create cache directory " << config.dir << "\n";
+        return;
+    }
+
+    // Left Behind by an Earlier Run, Nothing Knows What They Hold Anymore
+    for (const auto& file : std::filesystem::directory_iterator(config.dir, error)) {
+        if (file.path().filename().string().rfind(FILE_PREFIX, 0) == 0) std::filesystem::remove(file.path(), error);
+    }
+}
+
+
+ProxyCache::~ProxyCache() {
+    std::error_code error;
+    for (const auto& [key, entry] : entries) std::filesystem::remove(entry.file, error);
+}
+
+
+Protocol::ReplyStatus ProxyCache::get(const std::string& key, const Fetch& fetch, Hit& hit) {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+        // Checked Recently Enough, Serve It Without Asking
+        auto entry = entries.find(key);
+        if (entry != entries.end() && Clock::now() - entry->second.checked < config.fresh_for) {
+            return open(entry->second, Source::CACHE, hit);
+        }
+
+        // Someone Is Already Asking the Server, Their Answer Is Ours
+        auto in_flight = flights.find(key);
+        if (in_flight == flights.end()) break;
+
+        std::shared_ptr<Flight> flight = in_flight->second;
+        landed.wait(lock, [&] { return flight->done; });
+        if (!succeeded(flight->status)) return flight->status;
+
+        entry = entries.find(key);
+        if (entry != entries.end()) return open(entry->second, Source::SHARED, hit);
+        // Too large to keep, ask for our own copy
+    }
+
+    // We Ask, Offering the Version Held so an Unchanged File Isn't Sent Again
+    auto flight = std::make_shared<Flight>();
+    flights[key] = flight;
+    auto entry = entries.find(key);
+    Protocol::FileVersion held = entry != entries.end() ? entry->second.version : Protocol::FileVersion{};
+    std::filesystem::path temp = config.dir / (FILE_PREFIX + std::to_string(next_file++));
+
+    lock.unlock();
+    Origin origin;
+    Protocol::ReplyStatus status = fetch(held, temp, origin);
+    lock.lock();
+
+    // Other Keys Were Added Meanwhile and May Have Rehashed the Map, Look It Up Again
+    entry = entries.find(key);
+    Protocol::ReplyStatus result = status;
+    std::error_code error;
+    if (status == Protocol::ReplyStatus::ACK && origin.version.size > config.max_bytes) {
+        // Served Once Straight from the Download, the Name Goes Now and the Data with the Last Descriptor
+        hit.fd = ::open(temp.c_str(), O_RDONLY);
+        hit.version = origin.version;
+        hit.header = origin.header;
+        hit.source = Source::FETCHED;
+        std::filesystem::remove(temp, error);
+        if (hit.fd < 0) result = Protocol::ReplyStatus::ERROR;
+    } else if (status == Protocol::ReplyStatus::ACK) {
+        if (entry != entries.end()) drop(key);
+        Entry& stored = entries[key];
+        stored.file = temp;
+        stored.version = origin.version;
+        stored.header = origin.header;
+        stored.checked = Clock::now();
+        total_bytes += origin.version.size;
+        evict(key);
+    } else if (status == Protocol::ReplyStatus::NOT_MODIFIED && entry != entries.end()) {
+        entry->second.checked = Clock::now();
+    } else {
+        // Gone from the Server, or the Server Couldn't Be Asked
+        std::filesystem::remove(temp, error);
+        if (status == Protocol::ReplyStatus::INVALID && entry != entries.end()) drop(key);
+        if (status == Protocol::ReplyStatus::NOT_MODIFIED) result = Protocol::ReplyStatus::ERROR; // Nothing held to keep
+    }
+
+    flight->done = true;
+    flight->status = result;
+    flights.erase(key);
+    landed.notify_all();
+
+    if (!succeeded(result)) return result;
+    if (hit.fd >= 0) return Protocol::ReplyStatus::ACK;
+    return open(entries[key], status == Protocol::ReplyStatus::ACK ? Source::FETCHED : Source::VALIDATED, hit);
+}
+
+
+Protocol::ReplyStatus ProxyCache::open(Entry& entry, Source source, Hit& hit) {
+    // Opened Under the Lock, Eviction Only Takes the Name Away from an Open Copy
+    hit.fd = ::open(entry.file.c_str(), O_RDONLY);
+    if (hit.fd < 0) {
+        std::cerr << "[ProxyCache] Failed to open cached file " << entry.file << "\n";
+        return Protocol::ReplyStatus::ERROR;
+    }
+    hit.version = entry.version;
+    hit.header = entry.header;
+    hit.source = source;
+    entry.last_used = ++use_counter;
+    return Protocol::ReplyStatus::ACK;
+}
+
+
+void ProxyCache::drop(const std::string& key) {
+    auto entry = entries.find(key);
+    if (entry == entries.end()) return;
+
+    std::error_code error;
+    std::filesystem::remove(entry->second.file, error);
+    total_bytes -= entry->second.version.size;
+    entries.erase(entry);
+}
+
+
+void ProxyCache::evict(const std::string& keep) {
+    while (total_bytes > config.max_bytes) {
+        // Least Recently Used First, Skipping Whatever Is Being Asked About
+        auto victim = entries.end();
+        for (auto it = entries.begin(); it != entries.end(); ++it) {
+            if (it->first == keep || flights.count(it->first)) continue;
+            if (victim == entries.end() || it->second.last_used < victim->second.last_used) victim = it;
+        }
+        if (victim == entries.end()) return;
+        drop(victim->first);
+    }
+}
+
+
+const char* ProxyCache::sourceName(Source source) {
+    switch (source) {
+        case Source::CACHE:     return "cache";
+        case Source::VALIDATED: return "cache, validated";
+        case Source::FETCHED:   return "fetched";
+        case Source::SHARED:    return "shared fetch";
+    }
+    return "unknown";
+}
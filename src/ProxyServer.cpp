@@ -1,12 +1,63 @@
+#include <algorithm>
 #include <iostream>
 #include <sstream>
+#include <cerrno>
 #include <cstring>
+#include <fcntl.h>
 #include <unistd.h>
 #include <arpa/inet.h>
-#include <sys/select.h>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
 
 #include "ProxyServer.hpp"
+#include "MessageBuilder.hpp"
+#include "MessageSchema.hpp"
+#include "NetworkUtils.hpp"
 #include "Protocol.hpp"
+#include "RelayEngine.hpp"
+#include "SocketTuning.hpp"
+
+namespace {
+    bool receiveAll(int fd, void* dest, size_t length) {
+        return length == 0 || recv(fd, dest, length, MSG_WAITALL) == static_cast<ssize_t>(length);
+    }
+
+    bool sendCachedFile(int client_fd, int file_fd, uint64_t size, MessageBuilder& message) {
+        // The Reply Header Is Held Back to Leave with the First Data
+        if (!message.flush(client_fd, size > 0)) return false;
+
+    #ifdef __linux__
+        // Straight from the Page Cache to the Socket
+        off_t offset = 0;
+        while (static_cast<uint64_t>(offset) < size) {
+            ssize_t n = sendfile(client_fd, file_fd, &offset, static_cast<size_t>(size - offset));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+        }
+    #else
+        std::vector<char> chunk(256 * 1024);
+        uint64_t done = 0;
+        while (done < size) {
+            ssize_t n = pread(file_fd, chunk.data(), static_cast<size_t>(std::min<uint64_t>(chunk.size(), size - done)),
+                              static_cast<off_t>(done));
+            if (n <= 0 || !NetworkUtils::sendData(client_fd, chunk.data(), n)) return false;
+            done += n;
+        }
+    #endif
+        return true;
+    }
+}
+
+
+ProxyServer::ProxyServer(int port, size_t warm_connections, const ProxyCache::Config& cache_config,
+                         const BackendPool::Config& backend_config)
+    : BaseServer(port), upstreams(UpstreamPool::Config{warm_connections}) {
+    if (!cache_config.dir.empty()) cache = std::make_unique<ProxyCache>(cache_config);
+    if (!backend_config.backends.empty()) backends = std::make_unique<BackendPool>(backend_config);
+}
 
 
 void ProxyServer::handleRequest(int client_fd) {
@@ -24,63 +75,310 @@ void ProxyServer::handleRequest(int client_fd) {
     std::cout << "[ProxyServer] Connecting to destination "
               << dest_ip << ":" << dest_port << "\n";
 
-    // Create Socket to Destination
-    int server_fd = socket(AF_INET, SOCK_STREAM, 0);
-    if (server_fd < 0) {
-        std::cerr << "[ProxyServer] Failed to create server socket\n";
-        return;
-    }
-
     // Set Up Destination Address Structure
     sockaddr_in dest_addr{};
     dest_addr.sin_family = AF_INET;
     dest_addr.sin_port = htons(dest_port);
     dest_addr.sin_addr = header.dest_addr;
 
-    // Connect to Destination Server
-    if (connect(server_fd, (struct sockaddr*)&dest_addr, sizeof(dest_addr)) < 0) {
+    // The Backend for a Path Is Only Known Once the Command Naming It Has Been Read
+    bool by_path = backends && backends->policy() == BackendPool::Policy::PATH_HASH;
+    if (cache || by_path) {
+        serveCommands(client_fd, dest_addr);
+    } else {
+        relay(client_fd, dest_addr);
+    }
+}
+
+
+ProxyServer::Upstream ProxyServer::connectUpstream(const sockaddr_in& dest, const std::string& path) {
+    Upstream upstream;
+    if (!backends) {
+        upstream.addr = dest;
+        upstream.fd = upstreams.acquire(dest, upstream.warm);
+        return upstream;
+    }
+
+    // Next Backend Whenever One Can't Be Reached, Each Miss Counts Against Its Health
+    std::vector<int> tried;
+    while ((upstream.backend = backends->acquire(path, tried)) >= 0) {
+        upstream.addr = backends->address(upstream.backend);
+        upstream.fd = upstreams.acquire(upstream.addr, upstream.warm);
+        if (upstream.fd >= 0) break;
+
+        std::cerr << "[ProxyServer] Backend " << backends->name(upstream.backend) << " unreachable\n";
+        backends->release(upstream.backend, false);
+        tried.push_back(upstream.backend);
+    }
+    return upstream;
+}
+
+
+void ProxyServer::finishUpstream(const Upstream& upstream, bool healthy) {
+    if (upstream.backend >= 0) backends->release(upstream.backend, healthy);
+}
+
+
+void ProxyServer::relay(int client_fd, const sockaddr_in& dest, RingBuffer* buffered, const std::string& path) {
+    // Take a Warm Connection to the Destination, or Connect Now
+    Upstream upstream = connectUpstream(dest, path);
+    if (upstream.fd < 0) {
         std::cerr << "[ProxyServer] Failed to connect to "
-                  << dest_ip << ":" << dest_port << "\n";
-        close(server_fd);
+                  << (backends ? "any backend" : inet_ntoa(dest.sin_addr)) << "\n";
         return;
     }
-    std::cout << "[ProxyServer] Connected to destination.\n";
+    int server_fd = upstream.fd;
+    std::cout << "[ProxyServer] Connected to "
+              << (backends ? "backend " + backends->name(upstream.backend) : std::string("destination"))
+              << (upstream.warm ? " (warm)" : "") << ".\n";
+
+    // Pass On What the Client Already Sent
+    while (buffered && !buffered->empty()) {
+        std::span<const char> data = buffered->readable();
+        if (!NetworkUtils::sendData(server_fd, data.data(), data.size())) {
+            close(server_fd);
+            finishUpstream(upstream, false);
+            return;
+        }
+        buffered->consume(data.size());
+    }
+
+    // Relay on the Shared Event Loops, This Thread Is Done
+    // Outstanding Until the Relay Ends, a Relay That Failed Before the Backend Sent a Byte Counts Against It
+    RelayEngine::shared().add(client_fd, server_fd, [this, upstream](bool ok, const SocketRelay::Stats& stats) {
+        finishUpstream(upstream, ok || stats.b_to_a > 0);
+        std::cout << "[ProxyServer] Connection " << (ok ? "closed" : "failed") << " (" << stats.a_to_b
+                  << " bytes to server, " << stats.b_to_a << " bytes to client, "
+                  << SocketRelay::methodName(stats.method) << ").\n";
+    });
+    releaseClient();
+}
+
+
+void ProxyServer::serveCommands(int client_fd, const sockaddr_in& dest) {
+    constexpr size_t RING_CAPACITY = 64 * 1024;
+    RingBuffer ring(RING_CAPACITY);
+    CommandParser parser;
+    bool in_command = false; // The parser holds the start of a command, the ring no longer begins with one
 
-    // Relay Loop
-    fd_set fds;  // Declare File Descriptor Set
-    char relay_buffer[4096];
     while (true) {
-        FD_ZERO(&fds);                                      // Clear the File Descriptor Set
-        FD_SET(client_fd, &fds);                            // Add Client Socket to Set
-        FD_SET(server_fd, &fds);                            // Add Server Socket to Set
-        int max_fd = std::max(client_fd, server_fd) + 1;    // Compute Max FD for select()
-
-        // Wait for Activity on Either Socket
-        // Block Until Activity is Detected
-        // Break Loop on Error
-        if (select(max_fd, &fds, nullptr, nullptr, nullptr) < 0) break;
-
-        // Client → Server
-        // Check if Client Socket is Ready for Reading
-        if (FD_ISSET(client_fd, &fds)) {
-            // Read Data from Client and Forward to Server
-            ssize_t n = recv(client_fd, relay_buffer, sizeof(relay_buffer), 0);
-            std::cout << "[ProxyServer] Relayed " << n << " bytes from client to server.\n";
-            if (n <= 0) break;
-            send(server_fd, relay_buffer, n, 0);
+        while (!ring.empty()) {
+            // At a Command Boundary, Anything We Can't Answer Hands the Session to a Relay
+            char id;
+            if (!in_command && ring.peek(&id, 1) == 1 && !answersLocally(static_cast<Protocol::CommandID>(id))) {
+                // Picking by Path Needs the Whole Command, Unless It Could Never Fit
+                std::string path;
+                bool by_path = backends && backends->policy() == BackendPool::Policy::PATH_HASH;
+                if (by_path && !peekPath(ring, path) && !ring.full()) break;
+                relay(client_fd, dest, &ring, path);
+                return;
+            }
+
+            CommandParser::Command command;
+            in_command = !parser.parseCommand(ring, command);
+            if (in_command) break;
+            if (!answer(client_fd, dest, command)) return;
         }
 
-        // Server → Client
-        // Check if Server Socket is Ready for Reading
-        if (FD_ISSET(server_fd, &fds)) {
-            // Read Data from Server and Forward to Client
-            ssize_t n = recv(server_fd, relay_buffer, sizeof(relay_buffer), 0);
-            std::cout << "[ProxyServer] Relayed " << n << " bytes from server to client.\n";
-            if (n <= 0) break;
-            send(client_fd, relay_buffer, n, 0);
+        // Receive Directly into the Ring, the Parser Resumes Where It Stopped
+        std::span<char> space = ring.writable();
+        ssize_t bytes_received = recv(client_fd, space.data(), space.size(), 0);
+        if (bytes_received <= 0) return;
+        ring.commit(bytes_received);
+    }
+}
+
+
+bool ProxyServer::answersLocally(Protocol::CommandID command) const {
+    if (command == Protocol::CommandID::IDENTIFY || command == Protocol::CommandID::TUNE) return true;
+    return cache && (command == Protocol::CommandID::GET_FILE || command == Protocol::CommandID::GET_IF_CHANGED);
+}
+
+
+bool ProxyServer::peekPath(const RingBuffer& ring, std::string& path) {
+    // Parsed from a Copy, the Relay Still Forwards the Command Whole
+    RingBuffer copy = ring;
+    CommandParser parser;
+    CommandParser::Command command;
+    if (!parser.parseCommand(copy, command)) return false;
+    path = command.path;
+    return true;
+}
+
+
+bool ProxyServer::answer(int client_fd, const sockaddr_in& dest, const CommandParser::Command& command) {
+    switch (command.header.command_id) {
+        case Protocol::CommandID::IDENTIFY:
+            return answerIdentify(client_fd, command);
+
+        case Protocol::CommandID::TUNE:
+            return answerTune(client_fd, command.tail);
+
+        case Protocol::CommandID::GET_FILE:
+            return answerGet(client_fd, dest, command.path, nullptr);
+
+        case Protocol::CommandID::GET_IF_CHANGED: {
+            Protocol::FileVersion known = Protocol::FileVersion::parse(command.tail.data());
+            return answerGet(client_fd, dest, command.path, &known);
         }
+
+        default:
+            return false;
+    }
+}
+
+
+bool ProxyServer::answerIdentify(int client_fd, const CommandParser::Command& command) {
+    constexpr uint32_t MAX_PROBE = 16 * 1024 * 1024;
+
+    // The Client Is Measuring Its Link to Us, So We Probe It as a Server Would
+    uint32_t probe_bytes = 0;
+    size_t consumed;
+    Protocol::Schema::IdentifyTail::read(command.tail.data(), command.tail.size(), consumed, probe_bytes);
+    probe_bytes = std::min(probe_bytes, MAX_PROBE);
+    Protocol::sendReply(client_fd, Protocol::ReplyStatus::ACK);
+
+    static const std::vector<char> zeros(64 * 1024, 0);
+    uint32_t sent = 0;
+    while (sent < probe_bytes) {
+        size_t n = std::min<size_t>(zeros.size(), probe_bytes - sent);
+        ssize_t w = send(client_fd, zeros.data(), n, sent + n < probe_bytes ? SEND_MORE : 0);
+        if (w <= 0) return false;
+        sent += static_cast<uint32_t>(w);
     }
+    std::cout << "[ProxyServer] Identified client " << command.path << "\n";
+    return true;
+}
+
+
+bool ProxyServer::answerTune(int client_fd, const std::string& body) {
+    SocketTuning::Parameters params;
+    size_t consumed;
+    bool parsed = Protocol::Schema::TuneBody::read(body.data(), body.size(), consumed, params.rtt_us, params.bandwidth,
+                                                   params.buffer_size, params.chunk_size);
+
+    bool ok = parsed && params.chunk_size != 0 && SocketTuning::apply(client_fd, params);
+    Protocol::sendReply(client_fd, ok ? Protocol::ReplyStatus::ACK : Protocol::ReplyStatus::NACK);
+    return true;
+}
+
+
+bool ProxyServer::answerGet(int client_fd, const sockaddr_in& dest, const std::string& path,
+                            const Protocol::FileVersion* known) {
+    // Keyed by Destination and Path, Different Servers Never Share Entries
+    std::string key = std::string(inet_ntoa(dest.sin_addr)) + ":" + std::to_string(ntohs(dest.sin_port)) + "/" + path;
+
+    ProxyCache::Hit hit;
+    Protocol::ReplyStatus status = cache->get(key, [&](const Protocol::FileVersion& held, const std::filesystem::path& temp,
+                                                       ProxyCache::Origin& origin) {
+        return fetch(dest, path, held, temp, origin);
+    }, hit);
 
-    close(server_fd);
-    std::cout << "[ProxyServer] Connection closed.\n";
+    if (status != Protocol::ReplyStatus::ACK) {
+        std::cerr << "[ProxyServer] GET '" << path << "' failed upstream\n";
+        Protocol::sendReply(client_fd, status == Protocol::ReplyStatus::INVALID ? status : Protocol::ReplyStatus::ERROR);
+        return true;
+    }
+
+    // A Conditional GET for What the Client Already Has Needs No Data
+    if (known && known->sameContents(hit.version)) {
+        close(hit.fd);
+        Protocol::sendReply(client_fd, Protocol::ReplyStatus::NOT_MODIFIED);
+        std::cout << "[ProxyServer] GET '" << path << "' not modified (" << ProxyCache::sourceName(hit.source) << ")\n";
+        return true;
+    }
+
+    // Same Reply the Server Would Have Sent
+    MessageBuilder message;
+    message.appendUint8(static_cast<uint8_t>(Protocol::ReplyStatus::ACK));
+    if (known) message.append<Protocol::Schema::FileVersion>(hit.version.size, hit.version.mtime_ns, hit.version.hash);
+    message.append<Protocol::Schema::FileHeader>(hit.header.permissions, hit.header.path, hit.header.file_size);
+
+    bool ok = sendCachedFile(client_fd, hit.fd, hit.header.file_size, message);
+    close(hit.fd);
+    if (!ok) {
+        std::cerr << "[ProxyServer] Failed to send cached '" << path << "'\n";
+        return false;
+    }
+    std::cout << "[ProxyServer] GET '" << path << "' (" << hit.header.file_size << " bytes, "
+              << ProxyCache::sourceName(hit.source) << ")\n";
+    return true;
+}
+
+
+Protocol::ReplyStatus ProxyServer::fetch(const sockaddr_in& dest, const std::string& path,
+                                         const Protocol::FileVersion& held, const std::filesystem::path& temp,
+                                         ProxyCache::Origin& origin) {
+    Upstream upstream = connectUpstream(dest, path);
+    int server_fd = upstream.fd;
+    if (server_fd < 0) return Protocol::ReplyStatus::ERROR;
+
+    // Conditional GET with the Version Held, an Unchanged File Costs One Byte
+    MessageBuilder message;
+    message.append<Protocol::Schema::ConditionalCommand>(Protocol::CommandID::GET_IF_CHANGED, path,
+                                                         held.size, held.mtime_ns, held.hash);
+    uint8_t reply;
+    if (!message.flush(server_fd) || !receiveAll(server_fd, &reply, 1)) {
+        close(server_fd);
+        finishUpstream(upstream, false);
+        return Protocol::ReplyStatus::ERROR;
+    }
+    Protocol::ReplyStatus status = static_cast<Protocol::ReplyStatus>(reply);
+    switch (status) {
+        case Protocol::ReplyStatus::ACK:
+            break;
+        case Protocol::ReplyStatus::NACK:
+        case Protocol::ReplyStatus::NOT_MODIFIED:
+        case Protocol::ReplyStatus::INVALID:
+            // A Proper Answer, the Connection Is at a Message Boundary
+            upstreams.release(upstream.addr, server_fd);
+            finishUpstream(upstream, true);
+            return status;
+        default:
+            // ERROR or a Byte That Is No Reply at All
+            close(server_fd);
+            finishUpstream(upstream, false);
+            return Protocol::ReplyStatus::ERROR;
+    }
+
+    // Version Being Sent, Then the FileHeader
+    char version[Protocol::FILE_VERSION_SIZE];
+    char fixed[4];
+    std::vector<char> header_buffer;
+    bool ok = receiveAll(server_fd, version, sizeof(version)) && receiveAll(server_fd, fixed, sizeof(fixed));
+    if (ok) {
+        header_buffer.assign(fixed, fixed + sizeof(fixed));
+        header_buffer.resize(sizeof(fixed) + Protocol::parse_uint16(fixed + 2) + sizeof(uint64_t));
+        size_t next_offset;
+        ok = receiveAll(server_fd, header_buffer.data() + sizeof(fixed), header_buffer.size() - sizeof(fixed)) &&
+             Protocol::FileHeader::parse(header_buffer, 0, origin.header, next_offset);
+    }
+    origin.version = Protocol::FileVersion::parse(version);
+
+    // Stream the Contents into the Cache File
+    int file_fd = ok ? open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600) : -1;
+    bool local_failure = ok && file_fd < 0;
+    std::vector<char> chunk(256 * 1024);
+    uint64_t done = 0;
+    while (file_fd >= 0 && done < origin.header.file_size) {
+        ssize_t n = recv(server_fd, chunk.data(), static_cast<size_t>(std::min<uint64_t>(chunk.size(), origin.header.file_size - done)), 0);
+        if (n <= 0) break;
+        if (write(file_fd, chunk.data(), n) != n) {
+            local_failure = true;
+            break;
+        }
+        done += n;
+    }
+    if (file_fd >= 0) close(file_fd);
+
+    // A Short Transfer Leaves the Connection Mid-Message, It Can't Be Reused
+    if (file_fd < 0 || done != origin.header.file_size) {
+        std::cerr << "[ProxyServer] Failed to fetch '" << path << "' from destination\n";
+        close(server_fd);
+        finishUpstream(upstream, local_failure); // A cache file we couldn't write is no fault of the server
+        return Protocol::ReplyStatus::ERROR;
+    }
+    upstreams.release(upstream.addr, server_fd);
+    finishUpstream(upstream, true);
+    return Protocol::ReplyStatus::ACK;
 }
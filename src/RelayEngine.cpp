@@ -0,0 +1,296 @@
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <iostream>
+#include <mutex>
+#include <poll.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+#include "RelayEngine.hpp"
+
+
+struct RelayEngine::Relay {
+    // Identifies one socket of a relay in the event set
+    struct Side {
+        Relay* relay;
+        int index;
+    };
+
+    int fds[2];
+    SocketRelay::Direction a_to_b;
+    SocketRelay::Direction b_to_a;
+    Finished on_finished;
+    Side sides[2];
+    short registered[2] = {0, 0}; // Events currently in the epoll set
+    bool finished = false;
+
+    Relay(int a_fd, int b_fd, Finished on_finished)
+        : fds{a_fd, b_fd}, a_to_b(a_fd, b_fd), b_to_a(b_fd, a_fd),
+          on_finished{std::move(on_finished)}, sides{{this, 0}, {this, 1}} {}
+
+    short wanted(int index) const {
+        return a_to_b.events(fds[index]) | b_to_a.events(fds[index]);
+    }
+};
+
+
+class RelayEngine::Loop {
+public:
+    explicit Loop(std::atomic<size_t>& active);
+    ~Loop();
+
+    void add(std::unique_ptr<Relay> relay);
+
+private:
+    static constexpr int MAX_EVENTS = 64;
+
+    std::atomic<size_t>& active;
+    int wake_fds[2] = {-1, -1};
+#ifdef __linux__
+    int epoll_fd = -1;
+#endif
+
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Relay>> incoming;
+    bool stopping = false;
+
+    std::unordered_map<Relay*, std::unique_ptr<Relay>> relays; // Loop thread only
+    std::vector<Relay*> finished;
+    std::thread thread;
+
+    void run();
+    bool takeIncoming();
+    void service(Relay::Side& side);
+    void update(Relay& relay);
+    void finish(Relay& relay);
+    void reap();
+};
+
+
+RelayEngine::Loop::Loop(std::atomic<size_t>& active)
+    : active{active} {
+    if (pipe(wake_fds) != 0) {
+        std::cerr << "[RelayEngine] Failed to create wakeup pipe\n";
+        wake_fds[0] = wake_fds[1] = -1;
+    }
+    for (int fd : wake_fds) {
+        if (fd >= 0) fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+
+#ifdef __linux__
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.ptr = nullptr; // The wakeup pipe
+    if (epoll_fd < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fds[0], &event) != 0) {
+        std::cerr << "[RelayEngine] Failed to create epoll instance\n";
+    }
+#endif
+
+    thread = std::thread(&Loop::run, this);
+}
+
+
+RelayEngine::Loop::~Loop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    char byte = 0;
+    if (write(wake_fds[1], &byte, 1) < 0) {} // Full pipe already wakes the loop
+    if (thread.joinable()) thread.join();
+
+    // Relays Still Running at Shutdown Are Dropped
+    for (auto& [pointer, relay] : relays) {
+        for (int fd : relay->fds) close(fd);
+    }
+    for (std::unique_ptr<Relay>& relay : incoming) {
+        for (int fd : relay->fds) close(fd);
+    }
+#ifdef __linux__
+    if (epoll_fd >= 0) close(epoll_fd);
+#endif
+    for (int fd : wake_fds) {
+        if (fd >= 0) close(fd);
+    }
+}
+
+
+void RelayEngine::Loop::add(std::unique_ptr<Relay> relay) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        incoming.push_back(std::move(relay));
+    }
+    char byte = 0;
+    if (write(wake_fds[1], &byte, 1) < 0) {} // Full pipe already wakes the loop
+}
+
+
+void RelayEngine::Loop::run() {
+#ifdef __linux__
+    epoll_event events[MAX_EVENTS];
+    while (true) {
+        int count = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "[RelayEngine] epoll_wait failed\n";
+            return;
+        }
+        for (int i = 0; i < count; i++) {
+            if (events[i].data.ptr == nullptr) {
+                if (!takeIncoming()) return;
+            } else {
+                service(*static_cast<Relay::Side*>(events[i].data.ptr));
+            }
+        }
+        reap();
+    }
+#else
+    std::vector<pollfd> fds;
+    std::vector<Relay::Side*> sides;
+    while (true) {
+        // Rebuilt Each Round, Only Sockets Something Waits On
+        fds.assign(1, {wake_fds[0], POLLIN, 0});
+        sides.assign(1, nullptr);
+        for (auto& [pointer, relay] : relays) {
+            for (Relay::Side& side : relay->sides) {
+                short events = relay->wanted(side.index);
+                if (events == 0) continue;
+                fds.push_back({relay->fds[side.index], events, 0});
+                sides.push_back(&side);
+            }
+        }
+
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "[RelayEngine] poll failed\n";
+            return;
+        }
+        for (size_t i = 0; i < fds.size(); i++) {
+            if (fds[i].revents == 0) continue;
+            if (sides[i] == nullptr) {
+                if (!takeIncoming()) return;
+            } else {
+                service(*sides[i]);
+            }
+        }
+        reap();
+    }
+#endif
+}
+
+
+bool RelayEngine::Loop::takeIncoming() {
+    char drain[64];
+    while (read(wake_fds[0], drain, sizeof(drain)) > 0) {}
+
+    std::vector<std::unique_ptr<Relay>> added;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping) return false;
+        added.swap(incoming);
+    }
+    for (std::unique_ptr<Relay>& relay : added) {
+        Relay* pointer = relay.get();
+        relays.emplace(pointer, std::move(relay));
+        update(*pointer);
+    }
+    return true;
+}
+
+
+void RelayEngine::Loop::service(Relay::Side& side) {
+    Relay& relay = *side.relay;
+    if (relay.finished) return; // Closed earlier in this round
+
+    // Either Direction May Be Waiting on This Socket, Errors Surface from the Transfer
+    int fd = relay.fds[side.index];
+    if (relay.a_to_b.events(fd)) relay.a_to_b.pump();
+    if (relay.b_to_a.events(fd)) relay.b_to_a.pump();
+
+    bool failed = relay.a_to_b.failed() || relay.b_to_a.failed();
+    if (failed || (relay.a_to_b.done() && relay.b_to_a.done())) {
+        finish(relay);
+    } else {
+        update(relay);
+    }
+}
+
+
+void RelayEngine::Loop::update(Relay& relay) {
+#ifdef __linux__
+    // Level-Triggered, and a Socket Nothing Waits On Leaves the Set So Its Hangup Can't Spin the Loop
+    for (Relay::Side& side : relay.sides) {
+        short wanted = relay.wanted(side.index);
+        short& registered = relay.registered[side.index];
+        if (wanted == registered) continue;
+
+        epoll_event event{};
+        event.events = ((wanted & POLLIN) ? uint32_t{EPOLLIN} : 0u) | ((wanted & POLLOUT) ? uint32_t{EPOLLOUT} : 0u);
+        event.data.ptr = &side;
+        int op = registered == 0 ? EPOLL_CTL_ADD : (wanted == 0 ? EPOLL_CTL_DEL : EPOLL_CTL_MOD);
+        epoll_ctl(epoll_fd, op, relay.fds[side.index], &event);
+        registered = wanted;
+    }
+#else
+    (void)relay; // The poll set is rebuilt every round
+#endif
+}
+
+
+void RelayEngine::Loop::finish(Relay& relay) {
+    relay.finished = true;
+    for (int index = 0; index < 2; index++) {
+    #ifdef __linux__
+        if (relay.registered[index] != 0) epoll_ctl(epoll_fd, EPOLL_CTL_DEL, relay.fds[index], nullptr);
+    #endif
+        close(relay.fds[index]);
+    }
+
+    SocketRelay::Stats stats;
+    stats.a_to_b = relay.a_to_b.bytes();
+    stats.b_to_a = relay.b_to_a.bytes();
+    bool spliced = relay.a_to_b.method() == SocketRelay::Method::SPLICE && relay.b_to_a.method() == SocketRelay::Method::SPLICE;
+    stats.method = spliced ? SocketRelay::Method::SPLICE : SocketRelay::Method::COPY;
+    bool ok = !relay.a_to_b.failed() && !relay.b_to_a.failed();
+
+    active--;
+    if (relay.on_finished) relay.on_finished(ok, stats);
+    finished.push_back(&relay);
+}
+
+
+void RelayEngine::Loop::reap() {
+    for (Relay* relay : finished) relays.erase(relay);
+    finished.clear();
+}
+
+
+RelayEngine::RelayEngine(size_t threads) {
+    for (size_t i = 0; i < std::max<size_t>(threads, 1); i++) {
+        loops.push_back(std::make_unique<Loop>(active_relays));
+    }
+}
+
+
+RelayEngine::~RelayEngine() = default;
+
+
+RelayEngine& RelayEngine::shared() {
+    static RelayEngine engine(std::clamp<size_t>(std::thread::hardware_concurrency(), 1, 4));
+    return engine;
+}
+
+
+void RelayEngine::add(int a_fd, int b_fd, Finished on_finished) {
+    for (int fd : {a_fd, b_fd}) fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    active_relays++;
+    Loop& loop = *loops[next_loop++ % loops.size()];
+    loop.add(std::make_unique<Relay>(a_fd, b_fd, std::move(on_finished)));
+}
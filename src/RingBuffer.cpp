@@ -0,0 +1,64 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#include "RingBuffer.hpp"
+
+
+RingBuffer::RingBuffer(size_t capacity)
+    : storage(std::bit_ceil(std::max<size_t>(capacity, 2))), mask{storage.size() - 1} {}
+
+
+std::span<char> RingBuffer::writable() {
+    size_t start = tail & mask;
+    size_t length = std::min(space(), capacity() - start);
+    return {storage.data() + start, length};
+}
+
+
+void RingBuffer::commit(size_t n) {
+    tail += std::min(n, space());
+}
+
+
+std::span<const char> RingBuffer::readable() const {
+    size_t start = head & mask;
+    size_t length = std::min(size(), capacity() - start);
+    return {storage.data() + start, length};
+}
+
+
+void RingBuffer::consume(size_t n) {
+    head += std::min(n, size());
+    if (head == tail) head = tail = 0; // Restart at the front so the next recv gets the whole ring
+}
+
+
+size_t RingBuffer::peek(char* dest, size_t n) const {
+    n = std::min(n, size());
+    size_t start = head & mask;
+    size_t first = std::min(n, capacity() - start);
+    std::memcpy(dest, storage.data() + start, first);
+    std::memcpy(dest + first, storage.data(), n - first);
+    return n;
+}
+
+
+size_t RingBuffer::read(char* dest, size_t n) {
+    n = peek(dest, n);
+    consume(n);
+    return n;
+}
+
+
+size_t RingBuffer::write(const char* src, size_t n) {
+    size_t written = 0;
+    while (written < n && !full()) {
+        std::span<char> span = writable();
+        size_t chunk = std::min(span.size(), n - written);
+        std::memcpy(span.data(), src + written, chunk);
+        commit(chunk);
+        written += chunk;
+    }
+    return written;
+}
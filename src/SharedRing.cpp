@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
+#include "SharedRing.hpp"
+
+namespace {
+    // Both Control blocks live in the first page, the ring data follows
+    constexpr size_t HEADER_SIZE = 4096;
+    static_assert(2 * sizeof(SharedRing::Control) <= HEADER_SIZE);
+}
+
+
+SharedRing::~SharedRing() {
+    if (mapping) munmap(mapping, mapping_size);
+    for (int fd : {memory_fd, server_event, client_event}) {
+        if (fd >= 0) close(fd);
+    }
+}
+
+
+bool SharedRing::create(size_t capacity, int socket_fd) {
+#ifdef __linux__
+    capacity = std::bit_ceil(std::clamp(capacity, MIN_CAPACITY, MAX_CAPACITY));
+    this->socket_fd = socket_fd;
+
+    memory_fd = memfd_create("netcopy-ring", MFD_CLOEXEC);
+    server_event = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    client_event = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (memory_fd < 0 || server_event < 0 || client_event < 0
+        || ftruncate(memory_fd, static_cast<off_t>(HEADER_SIZE + 2 * capacity)) != 0) {
+        std::cerr << "SharedRing: Failed to create shared memory\n";
+        return false;
+    }
+
+    // The memfd Starts Zeroed, Only the Capacity Needs Setting
+    if (!map(capacity, true)) return false;
+    for (Control* control : {in, out}) {
+        new (control) Control{};
+        control->capacity = capacity;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+bool SharedRing::attach(int memory_fd, int server_event, int client_event, int socket_fd) {
+    this->memory_fd = memory_fd;
+    this->server_event = server_event;
+    this->client_event = client_event;
+    this->socket_fd = socket_fd;
+
+    // Size the Mapping from the File, Then Check It Against the Capacity Inside
+    struct stat st{};
+    if (fstat(memory_fd, &st) != 0 || static_cast<size_t>(st.st_size) < HEADER_SIZE + 2 * MIN_CAPACITY) return false;
+    size_t capacity = (static_cast<size_t>(st.st_size) - HEADER_SIZE) / 2;
+    if (!std::has_single_bit(capacity) || capacity > MAX_CAPACITY || !map(capacity, false)) return false;
+    return in->capacity == capacity && out->capacity == capacity;
+}
+
+
+bool SharedRing::map(size_t capacity, bool server) {
+    this->capacity = capacity;
+    mapping_size = HEADER_SIZE + 2 * capacity;
+    mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, memory_fd, 0);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        std::cerr << "SharedRing: Failed to map shared memory\n";
+        return false;
+    }
+
+    // Ring 0 Carries Client -> Server, Ring 1 Server -> Client
+    char* base = static_cast<char*>(mapping);
+    Control* to_server = reinterpret_cast<Control*>(base);
+    Control* to_client = reinterpret_cast<Control*>(base + sizeof(Control));
+    char* to_server_data = base + HEADER_SIZE;
+    char* to_client_data = base + HEADER_SIZE + capacity;
+
+    in = server ? to_server : to_client;
+    out = server ? to_client : to_server;
+    in_data = server ? to_server_data : to_client_data;
+    out_data = server ? to_client_data : to_server_data;
+    own_event = server ? server_event : client_event;
+    peer_event = server ? client_event : server_event;
+    return true;
+}
+
+
+std::span<char> SharedRing::writable() {
+    while (!closed) {
+        // A Tail Ahead of Our Head or More Than capacity Behind Reads as Full
+        uint64_t head = produced;
+        uint64_t tail = out->tail.load();
+        if (head - tail < capacity) {
+            size_t offset = head & (capacity - 1);
+            return {out_data + offset, std::min<size_t>(capacity - (head - tail), capacity - offset)};
+        }
+
+        // Full: Announce We Are Waiting, Then Check Again So a Wakeup Can't Be Missed
+        out->producer_waiting.store(1);
+        if (out->tail.load() != tail) {
+            out->producer_waiting.store(0);
+            continue;
+        }
+        if (!sleep()) break;
+    }
+    return {};
+}
+
+
+void SharedRing::commit(size_t length) {
+    produced += length;
+    out->head.store(produced);
+    if (out->consumer_waiting.exchange(0)) wake();
+}
+
+
+std::span<const char> SharedRing::readable() {
+    while (!closed) {
+        // Never More Than One Ring's Worth, Whatever the Peer Wrote as Its Head
+        uint64_t tail = consumed;
+        uint64_t head = in->head.load();
+        if (head != tail) {
+            size_t offset = tail & (capacity - 1);
+            size_t available = static_cast<size_t>(std::min<uint64_t>(head - tail, capacity));
+            return {in_data + offset, std::min<size_t>(available, capacity - offset)};
+        }
+
+        // Empty: Same Handshake as writable()
+        in->consumer_waiting.store(1);
+        if (in->head.load() != head) {
+            in->consumer_waiting.store(0);
+            continue;
+        }
+        if (!sleep()) break;
+    }
+    return {};
+}
+
+
+void SharedRing::consume(size_t length) {
+    consumed += length;
+    in->tail.store(consumed);
+    if (in->producer_waiting.exchange(0)) wake();
+}
+
+
+bool SharedRing::write(const char* data, size_t length) {
+    while (length > 0) {
+        std::span<char> space = writable();
+        if (space.empty()) return false;
+        size_t n = std::min(space.size(), length);
+        std::memcpy(space.data(), data, n);
+        commit(n);
+        data += n;
+        length -= n;
+    }
+    return true;
+}
+
+
+bool SharedRing::read(char* data, size_t length) {
+    while (length > 0) {
+        std::span<const char> available = readable();
+        if (available.empty()) return false;
+        size_t n = std::min(available.size(), length);
+        std::memcpy(data, available.data(), n);
+        consume(n);
+        data += n;
+        length -= n;
+    }
+    return true;
+}
+
+
+bool SharedRing::sleep() {
+    // The Socket Carries Nothing Once the Rings Are Up, It Only Becomes Readable When the Peer Is Gone
+    pollfd fds[2] = {{own_event, POLLIN, 0}, {socket_fd, POLLIN, 0}};
+    if (poll(fds, 2, -1) < 0) return true;
+    if (fds[1].revents != 0) {
+        closed = true;
+        return false;
+    }
+
+    uint64_t count;
+    [[maybe_unused]] ssize_t n = ::read(own_event, &count, sizeof(count));
+    return true;
+}
+
+
+void SharedRing::wake() {
+    uint64_t one = 1;
+    [[maybe_unused]] ssize_t n = ::write(peer_event, &one, sizeof(one));
+}
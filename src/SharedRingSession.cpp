@@ -0,0 +1,249 @@
+#include <algorithm>
+#include <fcntl.h>
+#include <filesystem>
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "LocalSocket.hpp"
+#include "MessageSchema.hpp"
+#include "SharedRingSession.hpp"
+
+namespace {
+    // FileHeader: uint16 permissions, uint16 path_len, path, uint64 file_size
+    bool readFileHeader(SharedRing& ring, Protocol::FileHeader& header) {
+        std::vector<char> buffer(4);
+        if (!ring.read(buffer.data(), buffer.size())) return false;
+        size_t path_length = Protocol::parse_uint16(&buffer[2]);
+        buffer.resize(4 + path_length + 8);
+        if (!ring.read(&buffer[4], path_length + 8)) return false;
+
+        size_t next_offset;
+        return Protocol::FileHeader::parse(buffer, 0, header, next_offset);
+    }
+}
+
+
+SharedRingSession::SharedRingSession(std::unique_ptr<SharedRing> ring)
+    : ring{std::move(ring)} {}
+
+
+void SharedRingSession::run() {
+    while (true) {
+        // Command Header and Path, Same Layout as on the Socket
+        char header[Protocol::COMMAND_HEADER_SIZE];
+        char length[2];
+        if (!ring->read(header, sizeof(header))) break;
+        auto command = static_cast<Protocol::CommandID>(header[0]);
+        if (command != Protocol::CommandID::GET_FILE && command != Protocol::CommandID::PUT_FILE) {
+            // Unknown Layout, the Rest of the Ring Can't Be Parsed
+            std::cerr << "[SharedRing] Unsupported command ID: " << static_cast<int>(command) << "\n";
+            sendReply(Protocol::ReplyStatus::INVALID);
+            break;
+        }
+
+        std::string file_name;
+        if (!ring->read(length, sizeof(length))) break;
+        file_name.resize(Protocol::parse_uint16(length));
+        if (!ring->read(file_name.data(), file_name.size())) break;
+
+        bool ok = command == Protocol::CommandID::GET_FILE ? handleGet(file_name) : handlePut(file_name);
+        if (!ok) break;
+    }
+    std::cout << "[SharedRing] Session closed.\n";
+}
+
+
+bool SharedRingSession::handleGet(const std::string& file_name) {
+    std::filesystem::path local_path = std::filesystem::current_path() / file_name;
+    int file_fd = open(local_path.c_str(), O_RDONLY | O_NONBLOCK); // A FIFO must not hang us before the type check
+    struct stat st{};
+    if (file_fd < 0 || fstat(file_fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        std::cerr << "[SharedRing] Failed to read file: " << file_name << "\n";
+        if (file_fd >= 0) close(file_fd);
+        return sendReply(Protocol::ReplyStatus::INVALID);
+    }
+
+    // ACK and FileHeader
+    Protocol::FileHeader header{static_cast<uint16_t>(st.st_mode & 07777), file_name, static_cast<uint64_t>(st.st_size)};
+    std::vector<char> header_bytes;
+    header.serialize(header_bytes);
+    bool ok = sendReply(Protocol::ReplyStatus::ACK) && ring->write(header_bytes.data(), header_bytes.size());
+
+    // File Data Is Read from Disk Directly into the Ring
+    uint64_t done = 0;
+    while (ok && done < header.file_size) {
+        std::span<char> space = ring->writable();
+        size_t want = static_cast<size_t>(std::min<uint64_t>(space.size(), header.file_size - done));
+        ssize_t n = want > 0 ? pread(file_fd, space.data(), want, static_cast<off_t>(done)) : -1;
+        ok = n > 0;
+        if (ok) {
+            ring->commit(n);
+            done += n;
+        }
+    }
+    close(file_fd);
+
+    // A Short Transfer Leaves the Client Waiting for Bytes That Never Come, End the Session
+    if (!ok) {
+        std::cerr << "[SharedRing] Failed to send '" << file_name << "' after " << done << " bytes\n";
+        return false;
+    }
+    std::cout << "[SharedRing] sent '" << file_name << "' (" << done << " bytes)\n";
+    return true;
+}
+
+
+bool SharedRingSession::handlePut(const std::string& file_name) {
+    Protocol::FileHeader header;
+    if (!sendReply(Protocol::ReplyStatus::ACK) || !readFileHeader(*ring, header)) return false;
+
+    // Stream File Data from the Ring to Disk
+    std::filesystem::path local_path = std::filesystem::current_path() / file_name;
+    int file_fd = open(local_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    bool write_ok = file_fd >= 0;
+    uint64_t received = 0;
+    while (received < header.file_size) {
+        std::span<const char> data = ring->readable();
+        if (data.empty()) break;
+        size_t n = static_cast<size_t>(std::min<uint64_t>(data.size(), header.file_size - received));
+        size_t written = 0;
+        while (write_ok && written < n) {
+            ssize_t w = write(file_fd, data.data() + written, n - written);
+            if (w <= 0) write_ok = false;
+            else written += w;
+        }
+        ring->consume(n); // Keep draining after a write error so the ring stays in sync
+        received += n;
+    }
+    if (file_fd >= 0) {
+        write_ok = fchmod(file_fd, header.permissions) == 0 && write_ok;
+        close(file_fd);
+    }
+
+    if (received != header.file_size) {
+        std::cerr << "[SharedRing] Connection lost after " << received << " bytes\n";
+        return false;
+    }
+    if (!write_ok) {
+        std::cerr << "[SharedRing] Failed to write file to " << local_path << "\n";
+        return sendReply(Protocol::ReplyStatus::NACK);
+    }
+    std::cout << "[SharedRing] saved '" << file_name << "' (" << received << " bytes)\n";
+    return sendReply(Protocol::ReplyStatus::ACK);
+}
+
+
+bool SharedRingSession::sendReply(Protocol::ReplyStatus status) {
+    char reply = static_cast<char>(status);
+    return ring->write(&reply, 1);
+}
+
+
+std::unique_ptr<SharedRingClient> SharedRingClient::upgrade(int socket_fd, size_t capacity) {
+    // SHARED_RING Carries the Requested Ring Size
+    char command[Protocol::Schema::SharedRingCommand::MIN_SIZE];
+    Protocol::Schema::SharedRingCommand::write(command, Protocol::CommandID::SHARED_RING, static_cast<uint32_t>(capacity));
+    if (send(socket_fd, command, sizeof(command), 0) != sizeof(command)) return nullptr;
+
+    // ACK Carries the memfd and Both eventfds
+    char reply = static_cast<char>(Protocol::ReplyStatus::ERROR);
+    bool ok;
+    std::vector<int> fds = LocalSocket::receiveFds(socket_fd, &reply, 1, ok);
+    if (!ok || static_cast<Protocol::ReplyStatus>(reply) != Protocol::ReplyStatus::ACK || fds.size() != 3) {
+        for (int fd : fds) close(fd);
+        return nullptr;
+    }
+
+    auto ring = std::make_unique<SharedRing>();
+    if (!ring->attach(fds[0], fds[1], fds[2], socket_fd)) {
+        std::cerr << "[SharedRing] Failed to map the server's rings\n";
+        return nullptr;
+    }
+    return std::unique_ptr<SharedRingClient>(new SharedRingClient(std::move(ring)));
+}
+
+
+SharedRingClient::SharedRingClient(std::unique_ptr<SharedRing> ring)
+    : ring{std::move(ring)} {}
+
+
+Protocol::ReplyStatus SharedRingClient::get(const std::string& remote_name, int out_fd, uint64_t& bytes) {
+    bytes = 0;
+    if (!sendCommand(Protocol::CommandID::GET_FILE, remote_name)) return Protocol::ReplyStatus::ERROR;
+    Protocol::ReplyStatus reply = receiveReply();
+    if (reply != Protocol::ReplyStatus::ACK) return reply;
+
+    Protocol::FileHeader header;
+    if (!readFileHeader(*ring, header)) return Protocol::ReplyStatus::ERROR;
+
+    // Consume File Data in Place
+    bool write_ok = true;
+    while (bytes < header.file_size) {
+        std::span<const char> data = ring->readable();
+        if (data.empty()) break;
+        size_t n = static_cast<size_t>(std::min<uint64_t>(data.size(), header.file_size - bytes));
+        size_t written = out_fd >= 0 ? 0 : n;
+        while (write_ok && written < n) {
+            ssize_t w = write(out_fd, data.data() + written, n - written);
+            if (w <= 0) write_ok = false;
+            else written += w;
+        }
+        ring->consume(n);
+        bytes += n;
+    }
+    if (out_fd >= 0) fchmod(out_fd, header.permissions);
+
+    bool complete = bytes == header.file_size && write_ok;
+    return complete ? Protocol::ReplyStatus::ACK : Protocol::ReplyStatus::ERROR;
+}
+
+
+Protocol::ReplyStatus SharedRingClient::put(int in_fd, const std::string& remote_name, uint64_t& bytes) {
+    bytes = 0;
+    struct stat st{};
+    if (fstat(in_fd, &st) != 0 || !S_ISREG(st.st_mode)) return Protocol::ReplyStatus::ERROR;
+
+    if (!sendCommand(Protocol::CommandID::PUT_FILE, remote_name)) return Protocol::ReplyStatus::ERROR;
+    Protocol::ReplyStatus reply = receiveReply();
+    if (reply != Protocol::ReplyStatus::ACK) return reply;
+
+    // FileHeader, Then File Data Read Straight into the Ring
+    Protocol::FileHeader header{static_cast<uint16_t>(st.st_mode & 07777), remote_name, static_cast<uint64_t>(st.st_size)};
+    std::vector<char> header_bytes;
+    header.serialize(header_bytes);
+    if (!ring->write(header_bytes.data(), header_bytes.size())) return Protocol::ReplyStatus::ERROR;
+
+    while (bytes < header.file_size) {
+        std::span<char> space = ring->writable();
+        size_t want = static_cast<size_t>(std::min<uint64_t>(space.size(), header.file_size - bytes));
+        ssize_t n = want > 0 ? pread(in_fd, space.data(), want, static_cast<off_t>(bytes)) : -1;
+        if (n <= 0) return Protocol::ReplyStatus::ERROR; // The server is left waiting, the connection is unusable
+        ring->commit(n);
+        bytes += n;
+    }
+    return receiveReply();
+}
+
+
+bool SharedRingClient::sendCommand(Protocol::CommandID command, const std::string& path) {
+    // Encoded Straight into the Ring When It Has Room
+    size_t length = Protocol::Schema::PathCommand::size(command, path);
+    std::span<char> space = ring->writable();
+    if (space.size() >= length) {
+        Protocol::Schema::PathCommand::write(space.data(), command, path);
+        ring->commit(length);
+        return true;
+    }
+    std::vector<char> message(length);
+    Protocol::Schema::PathCommand::write(message.data(), command, path);
+    return ring->write(message.data(), message.size());
+}
+
+
+Protocol::ReplyStatus SharedRingClient::receiveReply() {
+    char reply;
+    if (!ring->read(&reply, 1)) return Protocol::ReplyStatus::ERROR;
+    return static_cast<Protocol::ReplyStatus>(static_cast<uint8_t>(reply));
+}
@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "SocketRelay.hpp"
+
+namespace SocketRelay {
+
+    namespace {
+        bool wouldBlock() {
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+    }
+
+
+    Direction::Direction(int from, int to)
+        : from{from}, to{to} {
+    #ifdef __linux__
+        use_copy = false;
+    #endif
+    }
+
+
+    Direction::~Direction() {
+        closePipe();
+    }
+
+
+    short Direction::events(int fd) const {
+        if (finished || error) return 0;
+        if (fd == from && !eof && pending == 0) return POLLIN;
+        if (fd == to && pending > 0) return POLLOUT;
+        return 0;
+    }
+
+
+    ssize_t Direction::readSome() {
+    #ifdef __linux__
+        // The Pipe Is Made on First Use, Idle Relays Don't Hold Two Extra Descriptors
+        if (!use_copy && !hasPipe() && pipe2(pipe_fds, O_NONBLOCK | O_CLOEXEC) != 0) {
+            pipe_fds[0] = pipe_fds[1] = -1;
+            use_copy = true;
+        }
+        if (hasPipe()) return splice(from, nullptr, pipe_fds[1], nullptr, capacity, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    #endif
+        if (buffer.size() < capacity) buffer.resize(capacity);
+        buffer_offset = 0;
+        return recv(from, buffer.data(), capacity, 0);
+    }
+
+
+    ssize_t Direction::writeSome() {
+    #ifdef __linux__
+        if (hasPipe()) return splice(pipe_fds[0], nullptr, to, nullptr, pending, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    #endif
+        return send(to, buffer.data() + buffer_offset, pending, 0);
+    }
+
+
+    void Direction::grow() {
+        size_t larger = std::min(capacity * 4, MAX_BUFFER);
+    #ifdef __linux__
+        // The Kernel May Refuse (pipe-max-size), Then the Pipe Stays as It Is
+        if (hasPipe()) {
+            int size = fcntl(pipe_fds[1], F_SETPIPE_SZ, static_cast<int>(larger));
+            if (size > 0) capacity = static_cast<size_t>(size);
+            return;
+        }
+    #endif
+        capacity = larger;
+    }
+
+
+    void Direction::closePipe() {
+        if (pipe_fds[0] >= 0) close(pipe_fds[0]);
+        if (pipe_fds[1] >= 0) close(pipe_fds[1]);
+        pipe_fds[0] = pipe_fds[1] = -1;
+    }
+
+
+    void Direction::pump() {
+        // Fill
+        if (!eof && pending == 0) {
+            ssize_t n = readSome();
+            if (n > 0) {
+                pending = static_cast<size_t>(n);
+                if (pending >= capacity && capacity < MAX_BUFFER) grow();
+            } else if (n == 0) {
+                eof = true;
+            } else if (hasPipe() && errno == EINVAL && total == 0) {
+                // splice() Doesn't Take This Socket Type, Copy Instead
+                closePipe();
+                use_copy = true;
+                pump();
+                return;
+            } else if (!wouldBlock()) {
+                error = true;
+            }
+        }
+
+        // Drain, Until Everything Is Out or the Destination Is Full
+        while (!error && pending > 0) {
+            ssize_t n = writeSome();
+            if (n > 0) {
+                pending -= n;
+                buffer_offset += n;
+                total += n;
+            } else if (n < 0 && wouldBlock()) {
+                break;
+            } else {
+                error = true;
+            }
+        }
+
+        // Pass the End of Stream On, the Other Direction Keeps Going
+        if (!error && eof && pending == 0) {
+            shutdown(to, SHUT_WR);
+            finished = true;
+            closePipe();
+            std::vector<char>().swap(buffer);
+        }
+    }
+
+
+    const char* methodName(Method method) {
+        return method == Method::SPLICE ? "splice" : "copy";
+    }
+
+} // namespace SocketRelay
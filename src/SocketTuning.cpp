@@ -0,0 +1,74 @@
+#include <algorithm>
+#include <bit>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sstream>
+#include <sys/socket.h>
+
+#include "SocketTuning.hpp"
+
+namespace SocketTuning {
+
+    constexpr uint64_t MIN_BUFFER = 64 * 1024;
+    constexpr uint64_t MAX_BUFFER = 32 * 1024 * 1024;
+    constexpr uint64_t MIN_CHUNK = 4 * 1024;
+    constexpr uint64_t MAX_CHUNK = 1024 * 1024;
+
+    Parameters fromMeasurement(uint32_t rtt_us, uint64_t bandwidth) {
+        Parameters params;
+        params.rtt_us = rtt_us;
+        params.bandwidth = bandwidth;
+
+        uint64_t bdp = params.bdp();
+        params.buffer_size = static_cast<uint32_t>(std::clamp(bdp * 2, MIN_BUFFER, MAX_BUFFER));
+        params.chunk_size = static_cast<uint32_t>(std::bit_floor(std::clamp(bdp / 4, MIN_CHUNK, MAX_CHUNK)));
+        return params;
+    }
+
+    bool withinLimits(const Parameters& params) {
+        return params.chunk_size >= MIN_CHUNK && params.chunk_size <= MAX_CHUNK && params.buffer_size <= MAX_BUFFER;
+    }
+
+    bool apply(int socket_fd, const Parameters& params) {
+        bool ok = true;
+        for (int option : {SO_SNDBUF, SO_RCVBUF}) {
+            int current = 0;
+            socklen_t len = sizeof(current);
+            if (getsockopt(socket_fd, SOL_SOCKET, option, &current, &len) == 0
+                && current >= static_cast<int>(params.buffer_size)) {
+                continue;
+            }
+
+            int size = static_cast<int>(params.buffer_size);
+            ok = setsockopt(socket_fd, SOL_SOCKET, option, &size, sizeof(size)) == 0 && ok;
+        }
+        return ok;
+    }
+
+    uint32_t kernelRtt(int socket_fd) {
+    #if defined(__linux__) && defined(TCP_INFO)
+        tcp_info info{};
+        socklen_t len = sizeof(info);
+        if (getsockopt(socket_fd, IPPROTO_TCP, TCP_INFO, &info, &len) == 0) {
+            return info.tcpi_rtt;
+        }
+    #endif
+        return 0;
+    }
+
+    std::string report(int socket_fd, const Parameters& params) {
+        int sndbuf = 0, rcvbuf = 0;
+        socklen_t len = sizeof(int);
+        getsockopt(socket_fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, &len);
+        len = sizeof(int);
+        getsockopt(socket_fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, &len);
+
+        std::ostringstream out;
+        out << "rtt " << params.rtt_us / 1000.0 << " ms, bandwidth "
+            << params.bandwidth / 1000000.0 << " MB/s, BDP " << params.bdp()
+            << " bytes, SO_SNDBUF " << sndbuf << ", SO_RCVBUF " << rcvbuf
+            << ", chunk " << params.chunk_size << " bytes";
+        return out.str();
+    }
+
+} // namespace SocketTuning
@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <cerrno>
+#include <iostream>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "MessageBuilder.hpp"
+#include "SparseFile.hpp"
+
+namespace SparseFile {
+
+    constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+    bool mapExtents(int file_fd, uint64_t file_size, std::vector<Protocol::Extent>& out) {
+        out.clear();
+        if (file_size == 0) return true;
+
+    #if defined(SEEK_DATA) && defined(SEEK_HOLE)
+        off_t offset = 0;
+        while (static_cast<uint64_t>(offset) < file_size) {
+            // Find Start of Next Data Region
+            off_t data_start = lseek(file_fd, offset, SEEK_DATA);
+            if (data_start < 0) {
+                if (errno == ENXIO) return true; // No more data, the rest of the file is a hole
+                if (errno == EINVAL && out.empty()) break; // Holes not supported, fall back below
+                return false;
+            }
+
+            // Find End of Data Region
+            off_t data_end = lseek(file_fd, data_start, SEEK_HOLE);
+            if (data_end < 0) return false;
+            data_end = std::min<off_t>(data_end, static_cast<off_t>(file_size));
+
+            // Too Fragmented for One Map, the Rest Goes as One Extent, Holes and All
+            if (out.size() == Protocol::MAX_EXTENTS - 1) data_end = static_cast<off_t>(file_size);
+
+            out.push_back({static_cast<uint64_t>(data_start), static_cast<uint64_t>(data_end - data_start)});
+            offset = data_end;
+        }
+        if (!out.empty()) return true;
+    #endif
+
+        // No Hole Support, Send Whole File as One Extent
+        out.push_back({0, file_size});
+        return true;
+    }
+
+    bool sendExtentData(int socket_fd, int file_fd, const Protocol::ExtentMap& map) {
+        std::vector<char> chunk(CHUNK_SIZE);
+        uint64_t left = map.dataSize();
+
+        for (const Protocol::Extent& extent : map.extents) {
+            uint64_t done = 0;
+            while (done < extent.length) {
+                // Read Next Piece of the Extent
+                size_t want = static_cast<size_t>(std::min<uint64_t>(chunk.size(), extent.length - done));
+                ssize_t n = pread(file_fd, chunk.data(), want, static_cast<off_t>(extent.offset + done));
+                if (n <= 0) {
+                    std::cerr << "Sparse: Failed to read extent at offset " << extent.offset + done << "\n";
+                    return false;
+                }
+
+                // Send It, Keeping the Segment Open Until the Last Piece
+                left -= n;
+                size_t sent = 0;
+                while (sent < static_cast<size_t>(n)) {
+                    ssize_t s = send(socket_fd, chunk.data() + sent, n - sent, left > 0 ? SEND_MORE : 0);
+                    if (s <= 0) {
+                        std::cerr << "Sparse: Failed to send extent data\n";
+                        return false;
+                    }
+                    sent += s;
+                }
+                done += n;
+            }
+        }
+        return true;
+    }
+
+    bool fill(int socket_fd, std::vector<char>& pending, size_t needed) {
+        char temp[4096];
+        while (pending.size() < needed) {
+            ssize_t n = recv(socket_fd, temp, sizeof(temp), 0);
+            if (n <= 0) return false;
+            pending.insert(pending.end(), temp, temp + n);
+        }
+        return true;
+    }
+
+    bool receive(int socket_fd, int file_fd, uint64_t file_size, std::vector<char>& pending) {
+        // Receive the Extent Map
+        Protocol::ExtentMap map;
+        size_t next_offset = 0;
+        while (!Protocol::ExtentMap::parse(pending, 0, map, next_offset)) {
+            size_t needed = pending.size() + 1;
+            if (pending.size() >= 4) {
+                // Every Extent Holds Data, No More of Them Than Bytes in the File
+                uint32_t count = Protocol::parse_uint32(pending.data());
+                if (count > Protocol::MAX_EXTENTS || count > file_size) {
+                    std::cerr << "Sparse: Extent map too long (" << count << " extents)\n";
+                    return false;
+                }
+                needed = 4 + static_cast<size_t>(count) * Protocol::EXTENT_SIZE;
+            }
+            if (!fill(socket_fd, pending, needed)) {
+                std::cerr << "Sparse: Failed to receive extent map\n";
+                return false;
+            }
+        }
+        pending.erase(pending.begin(), pending.begin() + next_offset);
+
+        // Extents Must Be Non-Empty, in Order, Not Overlapping and Inside the File
+        uint64_t end = 0;
+        for (const Protocol::Extent& extent : map.extents) {
+            if (extent.length == 0 || extent.offset < end || extent.offset > file_size ||
+                extent.length > file_size - extent.offset) {
+                std::cerr << "Sparse: Invalid extent at offset " << extent.offset << "\n";
+                return false;
+            }
+            end = extent.offset + extent.length;
+        }
+
+        // Truncate Up Front so Unwritten Ranges Stay Holes
+        if (ftruncate(file_fd, 0) != 0 || ftruncate(file_fd, static_cast<off_t>(file_size)) != 0) {
+            std::cerr << "Sparse: Failed to size destination file\n";
+            return false;
+        }
+
+        std::vector<char> chunk(CHUNK_SIZE);
+        for (const Protocol::Extent& extent : map.extents) {
+            uint64_t done = 0;
+            while (done < extent.length) {
+                // Take Buffered Bytes First, Then Read from the Socket
+                const char* data;
+                size_t len;
+                bool from_pending = !pending.empty();
+                if (from_pending) {
+                    data = pending.data();
+                    len = static_cast<size_t>(std::min<uint64_t>(pending.size(), extent.length - done));
+                } else {
+                    size_t want = static_cast<size_t>(std::min<uint64_t>(chunk.size(), extent.length - done));
+                    ssize_t n = recv(socket_fd, chunk.data(), want, 0);
+                    if (n <= 0) {
+                        std::cerr << "Sparse: Connection lost during transfer\n";
+                        return false;
+                    }
+                    data = chunk.data();
+                    len = static_cast<size_t>(n);
+                }
+
+                // Write at the Extent's Offset
+                size_t written = 0;
+                while (written < len) {
+                    ssize_t w = pwrite(file_fd, data + written, len - written,
+                                       static_cast<off_t>(extent.offset + done + written));
+                    if (w <= 0) {
+                        std::cerr << "Sparse: Failed to write extent data\n";
+                        return false;
+                    }
+                    written += w;
+                }
+
+                if (from_pending) pending.erase(pending.begin(), pending.begin() + len);
+                done += len;
+            }
+        }
+        return true;
+    }
+
+} // namespace SparseFile
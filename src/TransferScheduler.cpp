@@ -0,0 +1,172 @@
+#include <algorithm>
+
+#include "TransferScheduler.hpp"
+
+
+TransferScheduler::TransferScheduler(const Config& config)
+    : config{config} {
+    this->config.quantum = std::max<size_t>(this->config.quantum, 1);
+    this->config.max_concurrent = std::max<size_t>(this->config.max_concurrent, 1);
+    global_bucket.rate = this->config.global_rate;
+    global_bucket.tokens = static_cast<double>(this->config.global_rate) / 10;
+}
+
+
+TransferScheduler::FlowID TransferScheduler::addClient(unsigned weight) {
+    std::lock_guard<std::mutex> lock(mutex);
+    FlowID id = next_flow++;
+    Flow& flow = flows[id];
+    flow.weight = std::max(weight, 1u);
+    flow.bucket.rate = config.client_rate;
+    flow.bucket.tokens = static_cast<double>(config.client_rate) / 10;
+    return id;
+}
+
+
+void TransferScheduler::removeClient(FlowID flow) {
+    std::lock_guard<std::mutex> lock(mutex);
+    active.erase(std::remove(active.begin(), active.end(), flow), active.end());
+    flows.erase(flow);
+    cv.notify_all();
+}
+
+
+void TransferScheduler::setWeight(FlowID flow, unsigned weight) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = flows.find(flow);
+    if (it != flows.end()) it->second.weight = std::max(weight, 1u);
+}
+
+
+void TransferScheduler::setWeight(FlowID flow, const std::string& client_id) {
+    auto it = config.weights.find(client_id);
+    if (it != config.weights.end()) setWeight(flow, it->second);
+}
+
+
+size_t TransferScheduler::quantumFor(FlowID flow) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = flows.find(flow);
+    if (it == flows.end()) return config.quantum;
+    return it->second.chunk ? it->second.chunk : config.quantum * it->second.weight;
+}
+
+
+void TransferScheduler::setChunkSize(FlowID flow, size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = flows.find(flow);
+    if (it != flows.end()) it->second.chunk = bytes;
+}
+
+
+void TransferScheduler::acquire(FlowID flow_id, size_t bytes) {
+    std::unique_lock<std::mutex> lock(mutex);
+    Flow& flow = flows.at(flow_id);
+
+    // Streams of a Multiplexed Session Share Its Flow, Their Requests Take Turns
+    cv.wait(lock, [&] { return flow.pending == 0; });
+    flow.pending = std::max<size_t>(bytes, 1);
+    flow.granted = false;
+    active.push_back(flow_id);
+
+    // Wait for Our Turn, Whoever Wakes Up Runs the Round Robin
+    while (true) {
+        Clock::time_point ready = dispatch();
+        if (flow.granted) break;
+        if (ready == Clock::time_point::max()) {
+            cv.wait(lock);
+        } else {
+            cv.wait_until(lock, ready);
+        }
+    }
+
+    flow.pending = 0;
+    flow.granted = false;
+    cv.notify_all();
+}
+
+
+void TransferScheduler::release(FlowID flow) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (in_flight > 0) in_flight--;
+    cv.notify_all();
+}
+
+
+TransferScheduler::Clock::time_point TransferScheduler::dispatch() {
+    Clock::time_point now = Clock::now();
+    Clock::time_point ready = Clock::time_point::max();
+    bool granted_any = false;
+
+    global_bucket.refill(now);
+
+    // A Round That Granted Nothing Ends the Pass Only if It Credited Nothing Either,
+    // a Request Larger Than One Quantum Takes Several Rounds of Credit
+    size_t rotations = 0;
+    bool credited = false;
+    while (in_flight < config.max_concurrent && !active.empty()) {
+        if (rotations >= active.size()) {
+            if (!credited) break;
+            rotations = 0;
+            credited = false;
+        }
+
+        // Global Cap Holds Everyone Back
+        if (global_bucket.rate != 0 && global_bucket.tokens <= 0) {
+            ready = std::min(ready, global_bucket.readyAt());
+            break;
+        }
+
+        FlowID id = active.front();
+        Flow& flow = flows.at(id);
+
+        // Credit the Flow Once per Visit
+        size_t flow_quantum = config.quantum * flow.weight;
+        if (flow.deficit < flow.pending) {
+            flow.deficit = std::min(flow.deficit + flow_quantum, std::max(flow_quantum, flow.pending));
+            credited = true;
+        }
+
+        // Not Enough Credit or Over Its Rate: Move to the Back of the Round
+        flow.bucket.refill(now);
+        bool rate_limited = flow.bucket.rate != 0 && flow.bucket.tokens <= 0;
+        if (flow.deficit < flow.pending || rate_limited) {
+            if (rate_limited) ready = std::min(ready, flow.bucket.readyAt());
+            active.pop_front();
+            active.push_back(id);
+            rotations++;
+            continue;
+        }
+
+        // Grant the Quantum
+        flow.deficit -= flow.pending;
+        flow.bucket.tokens -= static_cast<double>(flow.pending);
+        global_bucket.tokens -= static_cast<double>(flow.pending);
+        flow.granted = true;
+        in_flight++;
+        active.pop_front();
+        rotations = 0;
+        granted_any = true;
+    }
+
+    if (granted_any) cv.notify_all();
+    return ready;
+}
+
+
+void TransferScheduler::Bucket::refill(Clock::time_point now) {
+    if (rate == 0) return;
+
+    // Burst Up to 100ms Worth of Data
+    double burst = static_cast<double>(rate) / 10;
+    double elapsed = std::chrono::duration<double>(now - last).count();
+    tokens = std::min(burst, tokens + elapsed * static_cast<double>(rate));
+    last = now;
+}
+
+
+TransferScheduler::Clock::time_point TransferScheduler::Bucket::readyAt() const {
+    if (rate == 0 || tokens > 0) return Clock::now();
+    auto wait = std::chrono::duration<double>(-tokens / static_cast<double>(rate));
+    return last + std::chrono::duration_cast<Clock::duration>(wait) + std::chrono::microseconds(100);
+}
@@ -0,0 +1,110 @@
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+#include "LocalSocket.hpp"
+#include "MessageSchema.hpp"
+#include "NetworkUtils.hpp"
+#include "Protocol.hpp"
+#include "SharedRingSession.hpp"
+#include "TransportBench.hpp"
+
+namespace TransportBench {
+
+    namespace {
+        using Fetch = std::function<bool(uint64_t& bytes)>;
+
+        // v1 GET_FILE over a socket, the data is read and dropped
+        bool socketGet(int socket_fd, const std::string& file_name, uint64_t& bytes) {
+            std::vector<char> command(Protocol::Schema::PathCommand::size(Protocol::CommandID::GET_FILE, file_name));
+            Protocol::Schema::PathCommand::write(command.data(), Protocol::CommandID::GET_FILE, file_name);
+            if (!NetworkUtils::sendData(socket_fd, command.data(), command.size())) return false;
+
+            uint8_t reply;
+            if (recv(socket_fd, &reply, 1, MSG_WAITALL) != 1 || reply != static_cast<uint8_t>(Protocol::ReplyStatus::ACK)) return false;
+
+            // FileHeader, Then Data
+            static std::vector<char> chunk(1024 * 1024);
+            std::vector<char> buffer;
+            Protocol::FileHeader header;
+            size_t next_offset;
+            while (!Protocol::FileHeader::parse(buffer, 0, header, next_offset)) {
+                ssize_t n = recv(socket_fd, chunk.data(), 4096, 0);
+                if (n <= 0) return false;
+                buffer.insert(buffer.end(), chunk.data(), chunk.data() + n);
+            }
+
+            bytes = buffer.size() - next_offset;
+            while (bytes < header.file_size) {
+                ssize_t n = recv(socket_fd, chunk.data(), std::min<uint64_t>(chunk.size(), header.file_size - bytes), 0);
+                if (n <= 0) return false;
+                bytes += n;
+            }
+            return true;
+        }
+
+        void measure(const std::string& name, int rounds, const Fetch& fetch) {
+            using Clock = std::chrono::steady_clock;
+
+            uint64_t bytes = 0;
+            if (!fetch(bytes)) {
+                std::cout << std::left << std::setw(12) << name << "failed\n";
+                return;
+            }
+
+            uint64_t total = 0;
+            Clock::time_point start = Clock::now();
+            for (int i = 0; i < rounds; i++) {
+                if (!fetch(bytes)) {
+                    std::cout << std::left << std::setw(12) << name << "failed\n";
+                    return;
+                }
+                total += bytes;
+            }
+            double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+            std::cout << std::left << std::setw(12) << name << std::fixed << std::setprecision(1)
+                      << static_cast<double>(total) / seconds / 1e6 << " MB/s  ("
+                      << rounds << " x " << bytes << " bytes in " << std::setprecision(3) << seconds << " s)\n";
+        }
+    }
+
+
+    int run(int port, const std::string& socket_path, const std::string& file_name, int rounds) {
+        std::cout << "GET_FILE '" << file_name << "', " << rounds << " rounds per transport\n";
+
+        // TCP Loopback
+        int tcp_fd = NetworkUtils::connectToHost("127.0.0.1", port);
+        if (tcp_fd >= 0) {
+            measure("tcp", rounds, [&](uint64_t& bytes) { return socketGet(tcp_fd, file_name, bytes); });
+            close(tcp_fd);
+        }
+
+        // Unix Domain Socket
+        int unix_fd = LocalSocket::connect(socket_path);
+        if (unix_fd >= 0) {
+            measure("unix", rounds, [&](uint64_t& bytes) { return socketGet(unix_fd, file_name, bytes); });
+            close(unix_fd);
+        }
+
+        // Shared-Memory Rings, Set Up over a Second Unix Connection
+        int ring_fd = LocalSocket::connect(socket_path);
+        std::unique_ptr<SharedRingClient> ring = ring_fd >= 0 ? SharedRingClient::upgrade(ring_fd) : nullptr;
+        if (ring) {
+            measure("shm-ring", rounds, [&](uint64_t& bytes) {
+                return ring->get(file_name, -1, bytes) == Protocol::ReplyStatus::ACK;
+            });
+        } else {
+            std::cout << std::left << std::setw(12) << "shm-ring" << "not available\n";
+        }
+        ring.reset();
+        if (ring_fd >= 0) close(ring_fd);
+
+        return tcp_fd >= 0 && unix_fd >= 0 ? 0 : 1;
+    }
+
+} // namespace TransportBench
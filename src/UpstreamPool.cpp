@@ -0,0 +1,211 @@
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#include "UpstreamPool.hpp"
+
+
+UpstreamPool::UpstreamPool(const Config& config)
+    : config{config} {
+    if (config.warm > 0) maintainer = std::thread(&UpstreamPool::maintain, this);
+}
+
+
+UpstreamPool::~UpstreamPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    if (maintainer.joinable()) maintainer.join();
+
+    for (auto& [id, destination] : destinations) {
+        for (const Idle& idle : destination.idle) close(idle.fd);
+    }
+}
+
+
+int UpstreamPool::acquire(const sockaddr_in& dest, bool& warm) {
+    warm = false;
+    if (config.warm > 0) {
+        std::unique_lock<std::mutex> lock(mutex);
+        Destination& destination = destinations[key(dest)];
+        destination.addr = dest;
+        destination.last_used = Clock::now();
+
+        // Newest First, It Is the Least Likely to Have Been Dropped Along the Way
+        int fd = -1;
+        while (fd < 0 && !destination.idle.empty()) {
+            Idle idle = destination.idle.back();
+            destination.idle.pop_back();
+            if (healthy(idle.fd)) fd = idle.fd;
+            else close(idle.fd);
+        }
+        lock.unlock();
+        cv.notify_all(); // Top the destination back up
+
+        if (fd >= 0) {
+            warm = true;
+            return fd;
+        }
+    }
+    return connectTo(dest);
+}
+
+
+void UpstreamPool::release(const sockaddr_in& dest, int fd) {
+    if (config.warm > 0) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = destinations.find(key(dest));
+        if (!stopping && it != destinations.end() && it->second.idle.size() < config.warm) {
+            it->second.idle.push_back({fd, Clock::now()});
+            return;
+        }
+    }
+    close(fd);
+}
+
+
+void UpstreamPool::maintain() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        cv.wait_for(lock, std::chrono::seconds(1));
+        if (stopping) break;
+        Clock::time_point now = Clock::now();
+
+        // Drop Stale Destinations and Dead or Old Idle Connections, Then See What Is Missing
+        std::vector<uint64_t> wanted;
+        std::vector<sockaddr_in> addrs;
+        for (auto it = destinations.begin(); it != destinations.end();) {
+            Destination& destination = it->second;
+            bool forgotten = now - destination.last_used > config.forget_after;
+
+            std::deque<Idle> kept;
+            for (const Idle& idle : destination.idle) {
+                if (!forgotten && now - idle.since < config.max_idle && healthy(idle.fd)) kept.push_back(idle);
+                else close(idle.fd);
+            }
+            destination.idle.swap(kept);
+
+            if (forgotten && destination.connecting == 0) {
+                it = destinations.erase(it);
+                continue;
+            }
+            if (!forgotten && now >= destination.retry_at) {
+                for (size_t have = destination.idle.size() + destination.connecting;
+                     have < config.warm && wanted.size() < config.max_connecting; have++) {
+                    wanted.push_back(it->first);
+                    addrs.push_back(destination.addr);
+                    destination.connecting++;
+                }
+            }
+            ++it;
+        }
+
+        // Connect Without the Lock, Sessions Keep Taking Connections Meanwhile
+        lock.unlock();
+        std::vector<int> connected = connectAll(addrs, config.connect_timeout);
+        lock.lock();
+
+        for (size_t i = 0; i < wanted.size(); i++) {
+            int fd = connected[i];
+            Destination& destination = destinations[wanted[i]];
+            destination.connecting--;
+            if (fd < 0) {
+                destination.retry_at = Clock::now() + config.retry_after;
+            } else if (stopping) {
+                close(fd);
+            } else {
+                destination.idle.push_back({fd, Clock::now()});
+            }
+        }
+    }
+}
+
+
+uint64_t UpstreamPool::key(const sockaddr_in& dest) {
+    return (static_cast<uint64_t>(dest.sin_addr.s_addr) << 16) | dest.sin_port;
+}
+
+
+int UpstreamPool::connectTo(const sockaddr_in& dest) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, reinterpret_cast<const sockaddr*>(&dest), sizeof(dest)) < 0) {
+        close(fd);
+        return -1;
+    }
+    keepAlive(fd);
+    return fd;
+}
+
+
+std::vector<int> UpstreamPool::connectAll(const std::vector<sockaddr_in>& dests, std::chrono::milliseconds timeout) {
+    // Start Every Connect at Once, One Unreachable Destination Then Costs the Timeout Only Once
+    std::vector<int> fds(dests.size(), -1);
+    std::vector<pollfd> pending;
+    std::vector<size_t> which;
+    for (size_t i = 0; i < dests.size(); i++) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) continue;
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        if (connect(fd, reinterpret_cast<const sockaddr*>(&dests[i]), sizeof(dests[i])) == 0) {
+            fds[i] = fd;
+        } else if (errno == EINPROGRESS) {
+            pending.push_back({fd, POLLOUT, 0});
+            which.push_back(i);
+        } else {
+            close(fd);
+        }
+    }
+
+    // Collect Them as They Finish Until the Deadline, What Is Left Then Failed
+    Clock::time_point deadline = Clock::now() + timeout;
+    while (!pending.empty()) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now());
+        if (left.count() <= 0) break;
+        if (poll(pending.data(), pending.size(), static_cast<int>(left.count())) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (size_t j = pending.size(); j-- > 0;) {
+            if (pending[j].revents == 0) continue;
+            int error = 0;
+            socklen_t length = sizeof(error);
+            if (getsockopt(pending[j].fd, SOL_SOCKET, SO_ERROR, &error, &length) == 0 && error == 0) {
+                fds[which[j]] = pending[j].fd;
+            } else {
+                close(pending[j].fd);
+            }
+            pending.erase(pending.begin() + j);
+            which.erase(which.begin() + j);
+        }
+    }
+    for (const pollfd& p : pending) close(p.fd);
+
+    for (int fd : fds) {
+        if (fd < 0) continue;
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+        keepAlive(fd);
+    }
+    return fds;
+}
+
+
+void UpstreamPool::keepAlive(int fd) {
+    // Keepalive Notices a Silently Vanished Peer While the Connection Sits Idle
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on));
+}
+
+
+bool UpstreamPool::healthy(int fd) {
+    // End of Stream or an Error Means the Far End Gave Up, a Greeting It Sent Is Left for the Client
+    char byte;
+    ssize_t n = recv(fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+    return n > 0 || (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+}
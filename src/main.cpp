@@ -1,26 +1,73 @@
 #include <iostream>
+#include <csignal>
 #include <cstring>
+#include "AsyncFileClient.hpp"
 #include "FileClient.hpp"
 #include "FileServer.hpp"
 #include "ProxyServer.hpp"
 #include "HTTPProxyServer.hpp"
+#include "TransportBench.hpp"
 
 
 int main(int argc, char* argv[]) {
     // Basic Argument Parsing
     if (argc < 2) {
         std::cerr << "Usage:\n";
-        std::cerr << "  " << argv[0] << " server <port>\n";
+        std::cerr << "  " << argv[0] << " server <port> [rate-limit] [client-rate-limit] [--unix <socket-path>]\n"
+                  << "        [--weight <client-id>=<weight>]...\n";
         std::cerr << "  " << argv[0] << " client <host> <port> [proxy-host] [proxy-port]\n";
-        std::cerr << "  " << argv[0] << " proxy <port>\n";
-        std::cerr << "  " << argv[0] << " http-proxy <port>\n";
+        std::cerr << "  " << argv[0] << " batch <host> <port> get|put <file>...\n";
+        std::cerr << "  " << argv[0] << " bench <port> <socket-path> <file> [rounds]\n";
+        std::cerr << "  " << argv[0] << " proxy <port> [warm connections per destination] [--cache <dir>]\n"
+                  << "        [--backends <address:port,...>] [--balance least|hash]\n";
+        std::cerr << "  " << argv[0] << " http-proxy <port> [--cache-dir <dir>]\n";
         return 1;
     }
 
     // Server Mode
     if (strcmp(argv[1], "server") == 0) {
+        TransferScheduler::Config scheduler_config;
+
+        // Options, Anywhere After the Mode; What Is Left Is Positional
+        std::string local_path;
+        int positional = 2;
+        for (int i = 2; i < argc; i++) {
+            // Optional Unix Domain Socket for Same-Host Clients, Next to TCP
+            if (strcmp(argv[i], "--unix") == 0 && i + 1 < argc) {
+                local_path = argv[++i];
+            }
+            // Scheduler Weight for a Client, by the ID It Sends in IDENTIFY
+            else if (strcmp(argv[i], "--weight") == 0 && i + 1 < argc) {
+                std::string spec = argv[++i];
+                size_t equals = spec.rfind('=');
+                unsigned long weight = 0;
+                try {
+                    if (equals != std::string::npos && equals > 0) weight = std::stoul(spec.substr(equals + 1));
+                } catch (const std::exception&) {}
+                if (weight == 0 || weight > 1000) {
+                    std::cerr << "Invalid weight: " << spec << " (expected <client-id>=<1-1000>)\n";
+                    return 1;
+                }
+                scheduler_config.weights[spec.substr(0, equals)] = static_cast<unsigned>(weight);
+            } else {
+                argv[positional++] = argv[i];
+            }
+        }
+        argc = positional;
+
         int port = (argc >= 3) ? std::stoi(argv[2]) : 5000;
-        FileServer server(port);
+
+        // Optional Rate Caps in Bytes per Second (0 = Unlimited)
+        try {
+            if (argc >= 4) scheduler_config.global_rate = std::stoull(argv[3]);
+            if (argc >= 5) scheduler_config.client_rate = std::stoull(argv[4]);
+        } catch (const std::exception&) {
+            std::cerr << "Invalid rate limit\n";
+            return 1;
+        }
+
+        FileServer server(port, scheduler_config);
+        if (!local_path.empty()) server.listenLocal(local_path);
         server.start();
     }
     
@@ -65,17 +112,117 @@ int main(int argc, char* argv[]) {
         
     }
 
+    // Batch Mode: Non-Interactive Transfers Through the Client Library
+    else if (strcmp(argv[1], "batch") == 0) {
+        if (argc < 6 || (strcmp(argv[4], "get") != 0 && strcmp(argv[4], "put") != 0)) {
+            std::cerr << "Usage: " << argv[0] << " batch <host> <port> get|put <file>...\n";
+            return 1;
+        }
+
+        int port;
+        try {
+            port = std::stoi(argv[3]);
+        } catch (const std::invalid_argument&) {
+            std::cerr << "Invalid port number: " << argv[3] << "\n";
+            return 1;
+        }
+
+        signal(SIGPIPE, SIG_IGN); // A server that goes away fails its transfers, not the batch
+
+        // Same Name on Both Ends, Spread Over Up to 4 Connections
+        std::vector<AsyncFileClient::Transfer> transfers;
+        for (int i = 5; i < argc; i++) transfers.push_back({argv[i], argv[i]});
+        AsyncFileClient client(argv[2], port, std::min<size_t>(transfers.size(), 4));
+        if (!client.connect()) return 1;
+
+        bool get = strcmp(argv[4], "get") == 0;
+        auto futures = get ? client.getAll(transfers) : client.putAll(transfers);
+
+        int failed = 0;
+        for (size_t i = 0; i < futures.size(); i++) {
+            AsyncFileClient::Result result = futures[i].get();
+            if (result.status == Protocol::ReplyStatus::ACK) {
+                std::cout << transfers[i].remote_name << ": " << result.bytes << " bytes\n";
+            } else {
+                std::cerr << transfers[i].remote_name << ": failed\n";
+                failed++;
+            }
+        }
+        return failed == 0 ? 0 : 1;
+    }
+
+    // Benchmark Mode: Same-Host Transports Against a Running Server
+    else if (strcmp(argv[1], "bench") == 0) {
+        if (argc < 5) {
+            std::cerr << "Usage: " << argv[0] << " bench <port> <socket-path> <file> [rounds]\n";
+            return 1;
+        }
+        try {
+            int rounds = argc >= 6 ? std::max(std::stoi(argv[5]), 1) : 10;
+            return TransportBench::run(std::stoi(argv[2]), argv[3], argv[4], rounds);
+        } catch (const std::exception&) {
+            std::cerr << "Invalid port or rounds\n";
+            return 1;
+        }
+    }
+
     // Proxy Server Mode
     else if (strcmp(argv[1], "proxy") == 0) {
         int port = (argc >= 3) ? std::stoi(argv[2]) : 5000;
-        ProxyServer server(port);
+        size_t warm = 0;
+        ProxyCache::Config cache_config;
+        BackendPool::Config backend_config;
+
+        // Optional Warm Count, Then Options
+        for (int i = 3; i < argc; i++) {
+            bool has_value = i + 1 < argc;
+            if (strcmp(argv[i], "--cache") == 0 && has_value) {
+                // GET_FILE Cache, Answered by the Proxy Itself
+                cache_config.dir = argv[++i];
+            } else if (strcmp(argv[i], "--backends") == 0 && has_value) {
+                // Replicated Servers, Used Instead of the Destination Clients Name
+                if (!BackendPool::parseList(argv[++i], backend_config.backends)) {
+                    std::cerr << "Invalid backend list, expected address:port[,address:port...]\n";
+                    return 1;
+                }
+            } else if (strcmp(argv[i], "--balance") == 0 && has_value) {
+                std::string policy = argv[++i];
+                if (policy == "least") backend_config.policy = BackendPool::Policy::LEAST_OUTSTANDING;
+                else if (policy == "hash") backend_config.policy = BackendPool::Policy::PATH_HASH;
+                else {
+                    std::cerr << "Invalid balance policy, expected least or hash\n";
+                    return 1;
+                }
+            } else if (i == 3 && argv[i][0] != '-') {
+                warm = std::stoul(argv[i]);
+            } else {
+                std::cerr << "Unknown proxy option: " << argv[i] << "\n";
+                return 1;
+            }
+        }
+
+        signal(SIGPIPE, SIG_IGN); // A peer that goes away mid-relay fails that relay, not the proxy
+        ProxyServer server(port, warm, cache_config, backend_config);
         server.start();
     }
 
     // HTTP Proxy Server Mode
     else if (strcmp(argv[1], "http-proxy") == 0) {
         int port = (argc >= 3) ? std::stoi(argv[2]) : 8080;
-        HTTPProxyServer server(port);
+        std::string cache_dir;
+
+        for (int i = 3; i < argc; i++) {
+            if (strcmp(argv[i], "--cache-dir") == 0 && i + 1 < argc) {
+                // Persistent Second Cache Tier, Kept Across Restarts
+                cache_dir = argv[++i];
+            } else {
+                std::cerr << "Unknown http-proxy option: " << argv[i] << "\n";
+                return 1;
+            }
+        }
+
+        signal(SIGPIPE, SIG_IGN); // A client that goes away mid-response fails that response, not the proxy
+        HTTPProxyServer server(port, "forbidden.txt", cache_dir);
         server.start();
     }
 